@@ -0,0 +1,325 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <assert.h>
+#include <ecpoint.h>
+#include <ecurve.h>
+#include <field.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ecc-tune : measure scalar multiplication strategies for the standard curves
+// on this host and write the tuning file read by libecc (see mpECP_tune_load
+// in ecpoint.h). For each curve the group law formula sets (secret and
+// public), the mpECP_scalar_mul window (1 is the co-Z ladder) and the window
+// of the generator table are timed, and the field backend is chosen across
+// all curves. A candidate only replaces the built in default if it is
+// clearly faster, so timing noise does not churn the file. Curves where
+// mpECP_scalar_mul runs a compile time engine (--enable-cxx-engines) get no
+// window or secret entry, as neither would change what it runs
+//
+// usage: ecc-tune [-o file] [-n iterations] [curve ...]
+
+#define TUNE_SZ         (16)
+#define TUNE_MAX_SETS   (16)
+#define TUNE_MARGIN     (0.97)
+
+static int tune_iter = 5;
+
+typedef struct {
+    mpECurve_ptr cv;
+    mpECP_t pt[TUNE_SZ];
+    mpECP_t G;
+    mpECP_t r;
+    mpFp_t sc[TUNE_SZ];
+} tune_data_t;
+
+enum {
+    TUNE_SECRET,
+    TUNE_PUBLIC,
+    TUNE_BASE
+};
+
+// best time (of tune_iter runs) for TUNE_SZ multiplications
+static double tune_time(tune_data_t *d, int op, int w) {
+    int i, j;
+    clock_t start_time;
+    double t, best;
+
+    best = 0.0;
+    for (i = 0; i < tune_iter; i++) {
+        start_time = clock();
+        for (j = 0; j < TUNE_SZ; j++) {
+            switch (op) {
+                case TUNE_SECRET:
+                    if (d->cv->glv.enabled != 0) {
+                        mpECP_scalar_mul_glv(d->r, d->pt[j], d->sc[j], w);
+                    } else {
+                        mpECP_scalar_mul_window(d->r, d->pt[j], d->sc[j], w);
+                    }
+                    break;
+                case TUNE_PUBLIC:
+                    mpECP_scalar_mul_vartime(d->r, d->pt[j], d->sc[j]);
+                    break;
+                default:
+                    mpECP_scalar_base_mul(d->r, d->G, d->sc[j]);
+            }
+        }
+        t = (double)(clock() - start_time) / ((double)CLOCKS_PER_SEC);
+        if ((i == 0) || (t < best)) best = t;
+    }
+    return best;
+}
+
+static void tune_data_init(tune_data_t *d, mpECurve_t cv) {
+    int j;
+    d->cv = cv;
+    mpECP_init(d->r, cv);
+    mpECP_init(d->G, cv);
+    mpECP_set_mpz(d->G, cv->G[0], cv->G[1], cv);
+    for (j = 0; j < TUNE_SZ; j++) {
+        mpECP_init(d->pt[j], cv);
+        mpECP_urandom(d->pt[j], cv);
+        mpFp_init(d->sc[j], cv->n);
+        mpFp_urandom(d->sc[j], cv->n);
+    }
+    return;
+}
+
+static void tune_data_clear(tune_data_t *d) {
+    int j;
+    for (j = 0; j < TUNE_SZ; j++) {
+        mpFp_clear(d->sc[j]);
+        mpECP_clear(d->pt[j]);
+    }
+    mpECP_clear(d->G);
+    mpECP_clear(d->r);
+    return;
+}
+
+// fastest formula set for opclass (left selected on cv)
+static const char *tune_formulas(tune_data_t *d, int opclass, int w) {
+    int f, nf, status;
+    const char *names[TUNE_MAX_SETS];
+    const char *best;
+    double t, best_t;
+
+    best = mpECP_formulas_name(d->cv, opclass);
+    best_t = tune_time(d, (opclass == MPECP_FORMULAS_SECRET) ? TUNE_SECRET : TUNE_PUBLIC, w);
+    nf = mpECP_formulas_list(d->cv, opclass, names, TUNE_MAX_SETS);
+    for (f = 0; f < nf; f++) {
+        if (strcmp(names[f], best) == 0) continue;
+        if (mpECP_formulas_set(d->cv, opclass, names[f]) != 0) continue;
+        t = tune_time(d, (opclass == MPECP_FORMULAS_SECRET) ? TUNE_SECRET : TUNE_PUBLIC, w);
+        if (t < (best_t * TUNE_MARGIN)) {
+            best_t = t;
+            best = names[f];
+        }
+    }
+    status = mpECP_formulas_set(d->cv, opclass, best);
+    assert(status == 0);
+    (void)status;
+    return best;
+}
+
+static void tune_curve(FILE *out, char *name) {
+    int w, wmin, wmax, status;
+    int best_w, best_b;
+    const char *secret, *public;
+    double t, best_t;
+    mpECurve_t cv;
+    tune_data_t d;
+
+    // names are checked in main
+    mpECurve_init(cv);
+    status = mpECurve_set_named(cv, name);
+    assert(status == 0);
+    (void)status;
+    tune_data_init(&d, cv);
+
+    // formulas with the default window, then the window for those formulas
+    best_w = mpECP_scalar_mul_window_bits(cv);
+    secret = NULL;
+    if (cv->ops->scalar_mul == NULL) {
+        secret = tune_formulas(&d, MPECP_FORMULAS_SECRET, best_w);
+    }
+    public = tune_formulas(&d, MPECP_FORMULAS_PUBLIC, best_w);
+    if (secret != NULL) {
+        // the ladder has no GLV form
+        wmin = (cv->glv.enabled != 0) ? 2 : 1;
+        wmax = (cv->glv.enabled != 0) ? 6 : 7;
+        best_t = tune_time(&d, TUNE_SECRET, best_w);
+        for (w = wmin; w <= wmax; w++) {
+            if (w == best_w) continue;
+            t = tune_time(&d, TUNE_SECRET, w);
+            if (t < (best_t * TUNE_MARGIN)) {
+                best_t = t;
+                best_w = w;
+            }
+        }
+    }
+
+    // generator table windows, evaluation only (tables are built once)
+    mpECP_scalar_base_mul_setup(d.G);
+    best_b = d.G->base_bits;
+    best_t = tune_time(&d, TUNE_BASE, 0);
+    for (w = 2; w <= 8; w++) {
+        if (w == best_b) continue;
+        mpECP_clear(d.G);
+        mpECP_init(d.G, cv);
+        mpECP_set_mpz(d.G, cv->G[0], cv->G[1], cv);
+        if (mpECP_scalar_base_mul_setup_ex(d.G, w, 0) != 0) continue;
+        t = tune_time(&d, TUNE_BASE, 0);
+        if (t < (best_t * TUNE_MARGIN)) {
+            best_t = t;
+            best_b = w;
+        }
+    }
+
+    if (secret != NULL) {
+        fprintf(out, "%s window=%d base=%d secret=%s public=%s\n", name, best_w,
+            best_b, secret, public);
+    } else {
+        fprintf(out, "%s base=%d public=%s\n", name, best_b, public);
+    }
+    fflush(out);
+    tune_data_clear(&d);
+    mpECurve_clear(cv);
+    return;
+}
+
+// nonzero if any name in clist is not a known curve
+static int check_curves(char **clist) {
+    int i, status;
+    mpECurve_t cv;
+
+    status = 0;
+    mpECurve_init(cv);
+    for (i = 0; (clist[i] != NULL) && (status == 0); i++) {
+        status = mpECurve_set_named(cv, clist[i]);
+    }
+    mpECurve_clear(cv);
+    return status;
+}
+
+// field backend, summed over the default secret multiply of all curves
+static const char *tune_backend(char **clist) {
+    int i, b, status;
+    const char *backends[] = {NULL, "gmp", "adx", NULL};
+    const char *best;
+    double t, best_t;
+    mpECurve_t cv;
+    tune_data_t d;
+
+    // the current (cpu feature based) default is timed first
+    backends[0] = mpFp_backend_name();
+    best = NULL;
+    best_t = 0.0;
+    mpECurve_init(cv);
+    for (b = 0; backends[b] != NULL; b++) {
+        if ((b > 0) && (strcmp(backends[b], backends[0]) == 0)) continue;
+        if (mpFp_backend_set(backends[b]) != 0) continue;
+        t = 0.0;
+        for (i = 0; clist[i] != NULL; i++) {
+            status = mpECurve_set_named(cv, clist[i]);
+            assert(status == 0);
+            (void)status;
+            tune_data_init(&d, cv);
+            t += tune_time(&d, TUNE_SECRET, mpECP_scalar_mul_window_bits(cv));
+            tune_data_clear(&d);
+        }
+        if ((best == NULL) || (t < (best_t * TUNE_MARGIN))) {
+            best_t = t;
+            best = backends[b];
+        }
+    }
+    mpECurve_clear(cv);
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int i, opt;
+    char **clist;
+    const char *path;
+    const char *backend;
+    FILE *out;
+
+    path = NULL;
+    while ((opt = getopt(argc, argv, "o:n:")) != -1) {
+        switch (opt) {
+            case 'o':
+                path = optarg;
+                break;
+            case 'n':
+                tune_iter = atoi(optarg);
+                if (tune_iter > 0) break;
+                // fall through
+            default:
+                fprintf(stderr, "usage: %s [-o file] [-n iterations] [curve ...]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (path == NULL) path = mpECP_tune_path();
+    if (path == NULL) path = "ecc-tune.conf";
+
+    // measure from the built in defaults
+    mpECP_tune_reset();
+    if (optind < argc) {
+        clist = &argv[optind];
+    } else {
+        clist = _mpECurve_list_standard_curves();
+    }
+    if (check_curves(clist) != 0) {
+        fprintf(stderr, "%s: unknown curve\n", argv[0]);
+        return 1;
+    }
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], path);
+        return 1;
+    }
+    fprintf(out, "# written by ecc-tune, see mpECP_tune_load in ecpoint.h\n");
+    backend = tune_backend(clist);
+    mpFp_backend_set(backend);
+    fprintf(out, "backend=%s\n", backend);
+    for (i = 0; clist[i] != NULL; i++) {
+        fprintf(stderr, "tuning %s\n", clist[i]);
+        tune_curve(out, clist[i]);
+    }
+    fclose(out);
+    printf("wrote %s\n", path);
+    return 0;
+}
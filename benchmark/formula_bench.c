@@ -0,0 +1,127 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <assert.h>
+#include <ecpoint.h>
+#include <ecurve.h>
+#include <field.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// times every applicable formula set for each standard curve, separately
+// for secret scalar (constant time) and public scalar (vartime) use, and
+// reports the fastest of each class
+
+#define BENCH_SZ        (8)
+#define BENCH_MAX_SETS  (16)
+
+int main(int argc, char** argv) {
+    int i, j, k, c, f, nf;
+    char **clist;
+    const char *names[BENCH_MAX_SETS];
+    mpECurve_t cv;
+
+    printf("\"curve\", \"class\", \"formulas\", \"num_iter\", \"time\", \"rate\",\n");
+
+    mpECurve_init(cv);
+    clist = _mpECurve_list_standard_curves();
+    for (i = 0; clist[i] != NULL; i++) {
+        int status;
+        mpECP_t rpt;
+        mpECP_t pt[BENCH_SZ];
+        mpFp_t sc[BENCH_SZ];
+
+        status = mpECurve_set_named(cv, clist[i]);
+        assert(status == 0);
+
+        mpECP_init(rpt, cv);
+        for (j = 0; j < BENCH_SZ; j++) {
+            mpECP_init(pt[j], cv);
+            mpECP_urandom(pt[j], cv);
+            mpFp_init(sc[j], cv->n);
+            mpFp_urandom(sc[j], cv->n);
+        }
+
+        for (c = 0; c < 2; c++) {
+            const char *best = NULL;
+            const char *dflt;
+            double best_rate = 0.0;
+
+            dflt = mpECP_formulas_name(cv, c);
+            nf = mpECP_formulas_list(cv, c, names, BENCH_MAX_SETS);
+            for (f = 0; f < nf; f++) {
+                clock_t start_time, stop_time;
+                double cpu_time, mul_rate;
+
+                status = mpECP_formulas_set(cv, c, names[f]);
+                assert(status == 0);
+
+                start_time = clock();
+                for (j = 0; j < BENCH_SZ; j++) {
+                    for (k = 0; k < BENCH_SZ; k++) {
+                        if (c == MPECP_FORMULAS_SECRET) {
+                            mpECP_scalar_mul(rpt, pt[j], sc[k]);
+                        } else {
+                            mpECP_scalar_mul_vartime(rpt, pt[j], sc[k]);
+                        }
+                    }
+                }
+                stop_time = clock();
+
+                cpu_time = (double)(stop_time - start_time) / ((double)CLOCKS_PER_SEC);
+                mul_rate = (double)(BENCH_SZ * BENCH_SZ) / cpu_time;
+                printf("\"%s\", \"%s\", \"%s\", %d, %lf, %lf,\n", clist[i],
+                    (c == MPECP_FORMULAS_SECRET) ? "secret" : "public",
+                    names[f], (int)(BENCH_SZ * BENCH_SZ), cpu_time, mul_rate);
+                if (mul_rate > best_rate) {
+                    best_rate = mul_rate;
+                    best = names[f];
+                }
+            }
+            printf("# %s %s: fastest \"%s\", default \"%s\"\n", clist[i],
+                (c == MPECP_FORMULAS_SECRET) ? "secret" : "public", best, dflt);
+            status = mpECP_formulas_set(cv, c, dflt);
+            assert(status == 0);
+        }
+
+        for (j = 0; j < BENCH_SZ; j++) {
+            mpFp_clear(sc[j]);
+            mpECP_clear(pt[j]);
+        }
+        mpECP_clear(rpt);
+    }
+
+    mpECurve_clear(cv);
+    return 0;
+}
@@ -0,0 +1,129 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecpoint.h>
+#include <ecurve.h>
+#include <field.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+// multi scalar multiplication throughput vs number of points and threads
+// (wall clock time, as the Pippenger method runs on several threads)
+
+#define BENCH_MAX_PTS   (100000)
+
+static double _wall_time(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
+}
+
+int main(int argc, char** argv) {
+    int i, j, t, ncpu;
+    int npts[] = {16, 256, 4096, 32768, BENCH_MAX_PTS};
+    int nthreads[] = {1, 2, 4, 8};
+    char *clist[] = {"secp256k1", "Ed25519", NULL};
+    mpECurve_t cv;
+
+    ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    mpECurve_init(cv);
+
+    printf("\"curve\", \"method\", \"points\", \"threads\", \"time\", \"points_per_sec\",\n");
+
+    for (i = 0; clist[i] != NULL; i++) {
+        int status;
+        mpECP_t *pts;
+        mpFp_t *sc;
+        mpECP_t a, r, rr;
+
+        status = mpECurve_set_named(cv, clist[i]);
+        assert(status == 0);
+
+        pts = (mpECP_t *)malloc(BENCH_MAX_PTS * sizeof(mpECP_t));
+        sc = (mpFp_t *)malloc(BENCH_MAX_PTS * sizeof(mpFp_t));
+        assert((pts != NULL) && (sc != NULL));
+        mpECP_init(a, cv);
+        mpECP_init(r, cv);
+        mpECP_init(rr, cv);
+        // P[j] = P[j-1] + P[0], much faster than urandom for many points
+        mpECP_urandom(a, cv);
+        for (j = 0; j < BENCH_MAX_PTS; j++) {
+            mpECP_init(pts[j], cv);
+            if (j == 0) {
+                mpECP_set(pts[j], a);
+            } else {
+                mpECP_add(pts[j], pts[j-1], a);
+            }
+            mpFp_init(sc[j], cv->n);
+            mpFp_urandom(sc[j], cv->n);
+        }
+
+        for (j = 0; j < (int)(sizeof(npts) / sizeof(npts[0])); j++) {
+            double start_time, cpu_time;
+
+            if (npts[j] <= 4096) {
+                start_time = _wall_time();
+                mpECP_multi_scalar_mul_vartime(rr, pts, sc, npts[j]);
+                cpu_time = _wall_time() - start_time;
+                printf("\"%s\", \"vartime\", %d, 1, %lf, %lf,\n", clist[i],
+                    npts[j], cpu_time, (double)npts[j] / cpu_time);
+            }
+            for (t = 0; t < (int)(sizeof(nthreads) / sizeof(nthreads[0])); t++) {
+                if ((t > 0) && (nthreads[t] > ncpu)) break;
+                start_time = _wall_time();
+                mpECP_multi_scalar_mul_pippenger(r, pts, sc, npts[j], nthreads[t]);
+                cpu_time = _wall_time() - start_time;
+                printf("\"%s\", \"pippenger\", %d, %d, %lf, %lf,\n", clist[i],
+                    npts[j], nthreads[t], cpu_time, (double)npts[j] / cpu_time);
+                if (npts[j] <= 4096) {
+                    assert(mpECP_cmp(r, rr) == 0);
+                }
+            }
+        }
+
+        for (j = 0; j < BENCH_MAX_PTS; j++) {
+            mpFp_clear(sc[j]);
+            mpECP_clear(pts[j]);
+        }
+        free(sc);
+        free(pts);
+        mpECP_clear(rr);
+        mpECP_clear(r);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+    return 0;
+}
@@ -0,0 +1,89 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef _EC_ECC_CURVE_HPP_INCLUDED_
+#define _EC_ECC_CURVE_HPP_INCLUDED_
+
+// Compile time curve descriptions for the fixed size engines (engine.hpp).
+// A curve supplies its limb count N, modulus p, curve model and the model
+// coefficients in the same form as the C library (ecurve.c) so that points
+// can be passed between the two without any change of coordinates
+
+#include <ecc/fp.hpp>
+
+namespace ecc {
+
+// curve models, matching _mpECurve_eq_type
+struct short_weierstrass {};    // y**2 = x**3 + a*x + b
+struct short_weierstrass_a0 {}; // y**2 = x**3 + b
+struct edwards {};              // x**2 + y**2 = 1 + d * x**2 * y**2 (c = 1)
+struct twisted_edwards {};      // a * x**2 + y**2 = 1 + d * x**2 * y**2
+
+struct p256 {
+    using model = short_weierstrass;
+    static constexpr std::size_t N = 4;
+    static constexpr const char *name = "P256";
+    static constexpr limbs<N> p = from_hex<N>("FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF");
+    static constexpr limbs<N> a = from_hex<N>("FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFC");
+    static constexpr limbs<N> b = from_hex<N>("5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B");
+};
+
+struct secp256k1 {
+    using model = short_weierstrass_a0;
+    static constexpr std::size_t N = 4;
+    static constexpr const char *name = "secp256k1";
+    static constexpr limbs<N> p = from_hex<N>("FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F");
+    static constexpr limbs<N> a = from_hex<N>("0");
+    static constexpr limbs<N> b = from_hex<N>("7");
+};
+
+struct ed25519 {
+    using model = twisted_edwards;
+    static constexpr std::size_t N = 4;
+    static constexpr const char *name = "Ed25519";
+    static constexpr limbs<N> p = from_hex<N>("7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFED");
+    static constexpr limbs<N> a = from_hex<N>("7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEC");
+    static constexpr limbs<N> d = from_hex<N>("52036CEE2B6FFE738CC740797779E89800700A4D4141D8AB75EB4DCA135978A3");
+};
+
+struct ed448 {
+    using model = edwards;
+    static constexpr std::size_t N = 7;
+    static constexpr const char *name = "Ed448-Goldilocks";
+    static constexpr limbs<N> p = from_hex<N>("fffffffffffffffffffffffffffffffffffffffffffffffffffffffeffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+    static constexpr limbs<N> c = from_hex<N>("1");
+    // p - 39081
+    static constexpr limbs<N> d = from_hex<N>("fffffffffffffffffffffffffffffffffffffffffffffffffffffffeffffffffffffffffffffffffffffffffffffffffffffffffffff6756");
+};
+
+} // namespace ecc
+
+#endif // _EC_ECC_CURVE_HPP_INCLUDED_
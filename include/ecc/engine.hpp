@@ -0,0 +1,271 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef _EC_ECC_ENGINE_HPP_INCLUDED_
+#define _EC_ECC_ENGINE_HPP_INCLUDED_
+
+// Fixed size point arithmetic for C++17, specialized at compile time on the
+// curve (limb count, model and constants, see curve.hpp). Points are in the
+// same projective coordinates the C library uses for the curve model, with
+// the field elements in Montgomery form. All formulas are complete, so
+// scalar multiplication has no data dependent branches
+
+#include <ecc/curve.hpp>
+#include <type_traits>
+
+namespace ecc {
+
+namespace detail {
+
+template <class Curve>
+constexpr bool is_ws_model() {
+    return std::is_same<typename Curve::model, short_weierstrass>::value ||
+           std::is_same<typename Curve::model, short_weierstrass_a0>::value;
+}
+
+template <class Curve, class F>
+constexpr F coeff_a() {
+    if constexpr (std::is_same<typename Curve::model, edwards>::value) {
+        return F::one();
+    } else {
+        return F::from_limbs(Curve::a);
+    }
+}
+
+template <class Curve, class F>
+constexpr F coeff_b3() {
+    if constexpr (is_ws_model<Curve>()) {
+        F b = F::from_limbs(Curve::b);
+        return b.dbl() + b;
+    } else {
+        return F::zero();
+    }
+}
+
+template <class Curve, class F>
+constexpr F coeff_d() {
+    if constexpr (is_ws_model<Curve>()) {
+        return F::zero();
+    } else {
+        if constexpr (std::is_same<typename Curve::model, edwards>::value) {
+            static_assert(Curve::c[0] == 1, "Edwards engine requires c = 1");
+        }
+        return F::from_limbs(Curve::d);
+    }
+}
+
+} // namespace detail
+
+template <class Curve>
+class engine {
+public:
+    using model = typename Curve::model;
+    static constexpr std::size_t N = Curve::N;
+    using field = fp<N, Curve>;
+
+    struct point {
+        field X, Y, Z;
+    };
+
+    // curve coefficients in Montgomery form
+    static constexpr field ca = detail::coeff_a<Curve, field>();
+    static constexpr field cb3 = detail::coeff_b3<Curve, field>();
+    static constexpr field cd = detail::coeff_d<Curve, field>();
+
+    static constexpr bool is_ws = detail::is_ws_model<Curve>();
+
+    static constexpr point neutral() {
+        point r;
+        if constexpr (is_ws) {
+            r.X = field::zero();
+            r.Y = field::one();
+            r.Z = field::zero();
+        } else {
+            r.X = field::zero();
+            r.Y = field::one();
+            r.Z = field::one();
+        }
+        return r;
+    }
+
+    // 2015 Renes-Costello-Batina complete formulas for short Weierstrass
+    // curves (Algorithm 1/3, and 7/9 for a = 0), Bernstein-Lange (Edwards)
+    // and Bernstein-Birkner-Joye-Lange-Peters (twisted Edwards)
+    static constexpr point add(const point &P, const point &Q) {
+        point R;
+        if constexpr (std::is_same<model, short_weierstrass>::value) {
+            field t0 = P.X * Q.X;
+            field t1 = P.Y * Q.Y;
+            field t2 = P.Z * Q.Z;
+            field t3 = (P.X + P.Y) * (Q.X + Q.Y) - (t0 + t1);
+            field t4 = (P.X + P.Z) * (Q.X + Q.Z) - (t0 + t2);
+            field t5 = (P.Y + P.Z) * (Q.Y + Q.Z) - (t1 + t2);
+            R.Z = ca * t4 + cb3 * t2;
+            R.X = t1 - R.Z;
+            R.Z = t1 + R.Z;
+            R.Y = R.X * R.Z;
+            t1 = t0.dbl() + t0;
+            t2 = ca * t2;
+            t4 = cb3 * t4;
+            t1 = t1 + t2;
+            t2 = ca * (t0 - t2);
+            t4 = t4 + t2;
+            R.Y = R.Y + t1 * t4;
+            R.X = t3 * R.X - t5 * t4;
+            R.Z = t5 * R.Z + t3 * t1;
+        } else if constexpr (std::is_same<model, short_weierstrass_a0>::value) {
+            field t0 = P.X * Q.X;
+            field t1 = P.Y * Q.Y;
+            field t2 = P.Z * Q.Z;
+            field t3 = (P.X + P.Y) * (Q.X + Q.Y) - (t0 + t1);
+            field t4 = (P.Y + P.Z) * (Q.Y + Q.Z) - (t1 + t2);
+            field t5 = (P.X + P.Z) * (Q.X + Q.Z) - (t0 + t2);
+            t0 = t0.dbl() + t0;
+            t2 = cb3 * t2;
+            R.Z = t1 + t2;
+            t1 = t1 - t2;
+            t5 = cb3 * t5;
+            R.X = t3 * t1 - t4 * t5;
+            R.Y = t1 * R.Z + t5 * t0;
+            R.Z = R.Z * t4 + t0 * t3;
+        } else {
+            field A = P.Z * Q.Z;
+            field B = A.sqr();
+            field C = P.X * Q.X;
+            field D = P.Y * Q.Y;
+            field E = cd * C * D;
+            field F = B - E;
+            field G = B + E;
+            R.X = A * F * ((P.X + P.Y) * (Q.X + Q.Y) - C - D);
+            if constexpr (std::is_same<model, twisted_edwards>::value) {
+                R.Y = A * G * (D - ca * C);
+            } else {
+                R.Y = A * G * (D - C);
+            }
+            R.Z = F * G;
+        }
+        return R;
+    }
+
+    static constexpr point dbl(const point &P) {
+        point R;
+        if constexpr (std::is_same<model, short_weierstrass>::value) {
+            field t0 = P.X.sqr();
+            field t1 = P.Y.sqr();
+            field t2 = P.Z.sqr();
+            field t3 = (P.X * P.Y).dbl();
+            R.Z = (P.X * P.Z).dbl();
+            R.X = ca * R.Z;
+            R.Y = cb3 * t2 + R.X;
+            R.X = t1 - R.Y;
+            R.Y = t1 + R.Y;
+            R.Y = R.X * R.Y;
+            R.X = t3 * R.X;
+            R.Z = cb3 * R.Z;
+            t2 = ca * t2;
+            t3 = ca * (t0 - t2) + R.Z;
+            t0 = t0.dbl() + t0 + t2;
+            R.Y = R.Y + t0 * t3;
+            t2 = (P.Y * P.Z).dbl();
+            R.X = R.X - t2 * t3;
+            R.Z = (t2 * t1).dbl().dbl();
+        } else if constexpr (std::is_same<model, short_weierstrass_a0>::value) {
+            field t0 = P.Y.sqr();
+            field t3 = t0.dbl().dbl().dbl();
+            field t1 = P.Y * P.Z;
+            field t4 = P.X * P.Y;
+            field t2 = cb3 * P.Z.sqr();
+            R.X = t2 * t3;
+            R.Y = t0 + t2;
+            R.Z = t1 * t3;
+            t0 = t0 - (t2.dbl() + t2);
+            R.Y = t0 * R.Y + R.X;
+            R.X = (t0 * t4).dbl();
+        } else if constexpr (std::is_same<model, twisted_edwards>::value) {
+            // dbl-2008-bbjlp
+            field B = (P.X + P.Y).sqr();
+            field C = P.X.sqr();
+            field D = P.Y.sqr();
+            field E = ca * C;
+            field F = E + D;
+            field J = F - P.Z.sqr().dbl();
+            R.X = (B - C - D) * J;
+            R.Y = F * (E - D);
+            R.Z = F * J;
+        } else {
+            // dbl-2007-bl (c = 1)
+            field B = (P.X + P.Y).sqr();
+            field C = P.X.sqr();
+            field D = P.Y.sqr();
+            field E = C + D;
+            field J = E - P.Z.sqr().dbl();
+            R.X = (B - E) * J;
+            R.Y = E * (C - D);
+            R.Z = E * J;
+        }
+        return R;
+    }
+
+    static constexpr void cmov(point &R, const point &P, uint64_t move) {
+        field::cmov(R.X, P.X, move);
+        field::cmov(R.Y, P.Y, move);
+        field::cmov(R.Z, P.Z, move);
+    }
+
+    // R = k * P for the scalar k (little endian limbs, bits significant
+    // bits). Fixed 4 bit window, every table entry is read for each digit
+    static point scalar_mul(const point &P, const uint64_t *k, int bits) {
+        point T[16];
+        T[0] = neutral();
+        T[1] = P;
+        for (int i = 2; i < 16; i += 2) {
+            T[i] = dbl(T[i / 2]);
+            T[i + 1] = add(T[i], P);
+        }
+        point R = neutral();
+        int windows = (bits + 3) / 4;
+        for (int w = windows - 1; w >= 0; w--) {
+            int pos = 4 * w;
+            uint64_t digit = (k[pos / 64] >> (pos % 64)) & 0xF;
+            point S = T[0];
+            R = dbl(dbl(dbl(dbl(R))));
+            for (uint64_t j = 1; j < 16; j++) {
+                cmov(S, T[j], j == digit);
+            }
+            R = add(R, S);
+        }
+        return R;
+    }
+};
+
+} // namespace ecc
+
+#endif // _EC_ECC_ENGINE_HPP_INCLUDED_
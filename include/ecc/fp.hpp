@@ -0,0 +1,276 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef _EC_ECC_FP_HPP_INCLUDED_
+#define _EC_ECC_FP_HPP_INCLUDED_
+
+// Fixed size prime field arithmetic for C++17. The limb count and modulus
+// are template parameters, so every loop has a constant trip count and the
+// compiler is free to unroll it completely. Elements are kept in Montgomery
+// form (a * R mod p, R = 2**(64 * N)) and all operations are constant time.
+// The Montgomery constants are computed at compile time from the modulus
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace ecc {
+
+__extension__ typedef unsigned __int128 _u128;
+
+// the limb loops have constant trip counts, ask for them to be unrolled
+// even when the optimization level would not do so on its own
+#if defined(__GNUC__)
+#define _ECC_UNROLL _Pragma("GCC unroll 16")
+#else
+#define _ECC_UNROLL
+#endif
+
+template <std::size_t N>
+using limbs = std::array<uint64_t, N>;
+
+// parse a big endian hex string (with or without 0x) into N little endian
+// 64-bit limbs, for writing curve constants in the familiar form
+template <std::size_t N>
+constexpr limbs<N> from_hex(const char *s) {
+    limbs<N> r{};
+    std::size_t len = 0;
+    if ((s[0] == '0') && ((s[1] == 'x') || (s[1] == 'X'))) s += 2;
+    while (s[len] != 0) len++;
+    for (std::size_t i = 0; i < len; i++) {
+        char c = s[len - 1 - i];
+        uint64_t v = 0;
+        if ((c >= '0') && (c <= '9')) v = c - '0';
+        else if ((c >= 'a') && (c <= 'f')) v = c - 'a' + 10;
+        else if ((c >= 'A') && (c <= 'F')) v = c - 'A' + 10;
+        if ((i / 16) < N) r[i / 16] |= v << (4 * (i % 16));
+    }
+    return r;
+}
+
+namespace detail {
+
+// constant time helpers on raw limbs, values are < p
+
+// r = a + b mod p
+template <std::size_t N>
+constexpr void add_mod(limbs<N> &r, const limbs<N> &a, const limbs<N> &b,
+                       const limbs<N> &p) {
+    limbs<N> s{}, d{};
+    uint64_t c = 0, br = 0;
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        _u128 t = (_u128)a[i] + b[i] + c;
+        s[i] = (uint64_t)t;
+        c = (uint64_t)(t >> 64);
+    }
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        _u128 t = (_u128)s[i] - p[i] - br;
+        d[i] = (uint64_t)t;
+        br = (uint64_t)(t >> 64) & 1;
+    }
+    // keep s only if there was no carry out and s - p borrowed
+    uint64_t keep = (uint64_t)0 - ((c ^ 1) & br);
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) r[i] = (s[i] & keep) | (d[i] & ~keep);
+}
+
+// r = a - b mod p
+template <std::size_t N>
+constexpr void sub_mod(limbs<N> &r, const limbs<N> &a, const limbs<N> &b,
+                       const limbs<N> &p) {
+    limbs<N> d{};
+    uint64_t br = 0, c = 0;
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        _u128 t = (_u128)a[i] - b[i] - br;
+        d[i] = (uint64_t)t;
+        br = (uint64_t)(t >> 64) & 1;
+    }
+    uint64_t mask = (uint64_t)0 - br;
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        _u128 t = (_u128)d[i] + (p[i] & mask) + c;
+        r[i] = (uint64_t)t;
+        c = (uint64_t)(t >> 64);
+    }
+}
+
+// Montgomery multiplication (CIOS), r = a * b / R mod p
+template <std::size_t N>
+constexpr void mont_mul(limbs<N> &r, const limbs<N> &a, const limbs<N> &b,
+                        const limbs<N> &p, uint64_t pinv) {
+    uint64_t t[N + 2] = {};
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        uint64_t c = 0;
+        _ECC_UNROLL
+        for (std::size_t j = 0; j < N; j++) {
+            _u128 u = (_u128)a[j] * b[i] + t[j] + c;
+            t[j] = (uint64_t)u;
+            c = (uint64_t)(u >> 64);
+        }
+        _u128 u = (_u128)t[N] + c;
+        t[N] = (uint64_t)u;
+        t[N + 1] = (uint64_t)(u >> 64);
+        uint64_t m = t[0] * pinv;
+        u = (_u128)m * p[0] + t[0];
+        c = (uint64_t)(u >> 64);
+        _ECC_UNROLL
+        for (std::size_t j = 1; j < N; j++) {
+            u = (_u128)m * p[j] + t[j] + c;
+            t[j - 1] = (uint64_t)u;
+            c = (uint64_t)(u >> 64);
+        }
+        u = (_u128)t[N] + c;
+        t[N - 1] = (uint64_t)u;
+        t[N] = t[N + 1] + (uint64_t)(u >> 64);
+    }
+    // t < 2p, subtract p once if t >= p
+    limbs<N> d{};
+    uint64_t br = 0;
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) {
+        _u128 u = (_u128)t[i] - p[i] - br;
+        d[i] = (uint64_t)u;
+        br = (uint64_t)(u >> 64) & 1;
+    }
+    uint64_t keep = (uint64_t)0 - ((t[N] ^ 1) & br);
+    _ECC_UNROLL
+    for (std::size_t i = 0; i < N; i++) r[i] = (t[i] & keep) | (d[i] & ~keep);
+}
+
+// -p**-1 mod 2**64 (p odd)
+template <std::size_t N>
+constexpr uint64_t mont_pinv(const limbs<N> &p) {
+    uint64_t inv = 1;
+    for (int i = 0; i < 6; i++) inv *= 2 - p[0] * inv;
+    return (uint64_t)0 - inv;
+}
+
+// R**2 mod p, by doubling 1 (2 * 64 * N) times
+template <std::size_t N>
+constexpr limbs<N> mont_r2(const limbs<N> &p) {
+    limbs<N> r{};
+    r[0] = 1;
+    for (std::size_t i = 0; i < 128 * N; i++) add_mod(r, r, r, p);
+    return r;
+}
+
+} // namespace detail
+
+// element of the field defined by Params, which supplies the (odd) modulus
+// as "static constexpr limbs<N> p"
+template <std::size_t N, class Params>
+class fp {
+public:
+    static constexpr std::size_t nlimbs = N;
+    static constexpr limbs<N> p = Params::p;
+    static constexpr uint64_t pinv = detail::mont_pinv<N>(Params::p);
+    static constexpr limbs<N> r2 = detail::mont_r2<N>(Params::p);
+
+    limbs<N> v; // Montgomery form
+
+    constexpr fp() : v{} {}
+
+    // from standard (not Montgomery) form limbs, value < p
+    static constexpr fp from_limbs(const limbs<N> &a) {
+        fp r;
+        detail::mont_mul<N>(r.v, a, r2, p, pinv);
+        return r;
+    }
+    static constexpr fp from_hex(const char *s) {
+        return from_limbs(ecc::from_hex<N>(s));
+    }
+    static constexpr fp from_ui(uint64_t a) {
+        limbs<N> t{};
+        t[0] = a;
+        return from_limbs(t);
+    }
+    static constexpr fp zero() {
+        return fp();
+    }
+    static constexpr fp one() {
+        return from_ui(1);
+    }
+
+    // to standard form limbs
+    constexpr limbs<N> to_limbs() const {
+        limbs<N> one{}, r{};
+        one[0] = 1;
+        detail::mont_mul<N>(r, v, one, p, pinv);
+        return r;
+    }
+
+    constexpr bool is_zero() const {
+        uint64_t acc = 0;
+        _ECC_UNROLL
+        for (std::size_t i = 0; i < N; i++) acc |= v[i];
+        return acc == 0;
+    }
+
+    friend constexpr fp operator+(const fp &a, const fp &b) {
+        fp r;
+        detail::add_mod<N>(r.v, a.v, b.v, p);
+        return r;
+    }
+    friend constexpr fp operator-(const fp &a, const fp &b) {
+        fp r;
+        detail::sub_mod<N>(r.v, a.v, b.v, p);
+        return r;
+    }
+    friend constexpr fp operator*(const fp &a, const fp &b) {
+        fp r;
+        detail::mont_mul<N>(r.v, a.v, b.v, p, pinv);
+        return r;
+    }
+    constexpr fp operator-() const {
+        return zero() - *this;
+    }
+    constexpr fp sqr() const {
+        return *this * *this;
+    }
+    constexpr fp dbl() const {
+        return *this + *this;
+    }
+
+    // r = a if move != 0 (constant time)
+    static constexpr void cmov(fp &r, const fp &a, uint64_t move) {
+        uint64_t mask = (uint64_t)0 - (uint64_t)(move != 0);
+        _ECC_UNROLL
+        for (std::size_t i = 0; i < N; i++) r.v[i] ^= mask & (r.v[i] ^ a.v[i]);
+    }
+};
+
+} // namespace ecc
+
+#endif // _EC_ECC_FP_HPP_INCLUDED_
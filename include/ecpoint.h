@@ -31,12 +31,11 @@
 #ifndef _EC_POINT_H_INCLUDED_
 #define _EC_POINT_H_INCLUDED_
 
-// use Renes-Costello-Batina Complete Addition for short-WS curves
-#define _MPECP_USE_RCB (1)
-
 #include <gmp.h>
 #include <field.h>
 #include <ecurve.h>
+#include <pthread.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,18 +44,81 @@ extern "C" {
 /* Implementation of Elliptic Curve math loosely following GNU GMP sytle */ 
 /* internal representation supports projective (e.g. Jacobian) coords */
 
+// fixed base table, signed odd digit window (no doublings at evaluation).
+// level i holds (2j + 1) * 2**(i * window_bits) * P for j < level_size in
+// affine coordinates. Coordinates are stored as psize limbs (x then y) for
+// every entry in a single cache line aligned arena
+typedef struct _p_mpECP_base_table_t {
+    int window_bits;
+    int levels;
+    int level_size; // 2**(window_bits - 1)
+    mp_size_t psize;
+    mp_limb_t *limbs;
+    size_t bytes; // size of limb arena
+    int refcount; // tables may be shared between points and curve (for G)
+    int is_static; // limbs are read only data compiled into libecc
+    void *map; // limbs are mmap'ed from a file (scalar_base_mul_table_load)
+    size_t map_bytes;
+} _mpECP_base_table_t;
+
 typedef struct _p_mpECP_t {
     mpFp_t x;
     mpFp_t y;
     mpFp_t z;
     int is_neutral;
     mpECurve_ptr cvp;
-    int base_bits;
-    struct _p_mpECP_t *base_pt;
+    int base_bits; // window_bits of base_tbl, 0 if no table
+    _mpECP_base_table_t *base_tbl;
 } _mpECP_t;
 
 typedef _mpECP_t mpECP_t[1];
 
+// bounded LRU cache of decoded and validated points, keyed by curve and
+// encoding, for keys which are received over and over (thread safe)
+typedef struct _p_mpECP_cache_entry_t {
+    uint64_t curve_hash;
+    uint64_t key_hash;
+    unsigned char *key;
+    int keylen;
+    mpz_t x;
+    mpz_t y;
+    mpz_t z;
+    int is_neutral;
+    struct _p_mpECP_cache_entry_t *hnext; // hash chain
+    struct _p_mpECP_cache_entry_t *prev; // LRU list, head is most recent
+    struct _p_mpECP_cache_entry_t *next;
+} _mpECP_cache_entry_t;
+
+typedef struct _p_mpECP_cache_t {
+    int capacity;
+    int count;
+    int nbuckets; // power of 2
+    _mpECP_cache_entry_t **buckets;
+    _mpECP_cache_entry_t *head;
+    _mpECP_cache_entry_t *tail;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t key[2]; // bucket hash key, random per cache
+    pthread_mutex_t lock;
+} _mpECP_cache_t;
+
+typedef _mpECP_cache_t mpECP_cache_t[1];
+
+// variable base precomputation for a point used with many scalars: odd
+// multiples {P, 3P, ...} (and phi(P) multiples with GLV) normalized to
+// affine, i.e. 2**(window_bits-1) points instead of a full base table
+typedef struct _p_mpECP_precomp_t {
+    int window_bits;
+    int tsz;
+    int ntables; // 2 with GLV
+    int affine; // all entries are affine (mixed additions)
+    int is_neutral;
+    mpECurve_ptr cvp;
+    struct _p_mpECP_t *T[2];
+} _mpECP_precomp_t;
+
+typedef _mpECP_precomp_t mpECP_precomp_t[1];
+
 void mpECP_init(mpECP_t pt, mpECurve_t cv);
 void mpECP_clear(mpECP_t pt);
 
@@ -78,6 +140,29 @@ int  mpECP_set_bytes(mpECP_t rpt, unsigned char *s, int length, mpECurve_t cv);
 int  mpECP_out_bytelen(mpECP_t pt, int compress);
 void mpECP_out_bytes(unsigned char *s, mpECP_t pt, int compress);
 
+// normalize n points to affine with a single field inversion (simultaneous
+// inversion). mpECP_batch_out_bytes writes point i to buf + (i * stride)
+// (stride >= mpECP_out_bytelen), normalizing all points at once
+void mpECP_batch_to_affine(mpECP_t *pts, int n);
+void mpECP_batch_out_bytes(unsigned char *buf, size_t stride, mpECP_t *pts, int n, int compress);
+// decode n points of blen bytes each from buf + (i * stride) into rpts[i],
+// decompressing with one field inversion per batch (Edwards curves) and
+// checking that uncompressed points are on the curve. Coordinates >= p are
+// rejected. status[i] is 0 for success, the return value is the number of
+// points which failed. nthreads <= 0 uses one thread per online cpu
+int  mpECP_batch_set_bytes(mpECP_t *rpts, int *status, unsigned char *buf,
+    size_t stride, int blen, int n, mpECurve_t cv, int nthreads);
+
+// decode a point through an LRU cache of at most capacity points. Misses
+// are decoded and validated as in mpECP_batch_set_bytes, which is stricter
+// than mpECP_set_bytes (coordinates >= p and uncompressed points not on the
+// curve are rejected). Failures are not cached. Returns nonzero if the
+// encoding is invalid
+void mpECP_cache_init(mpECP_cache_t c, int capacity);
+void mpECP_cache_clear(mpECP_cache_t c);
+int  mpECP_cache_set_bytes(mpECP_t rpt, mpECP_cache_t c, unsigned char *b, int blen, mpECurve_t cv);
+void mpECP_cache_stats(mpECP_cache_t c, uint64_t *hits, uint64_t *misses);
+
 void mpECP_swap(mpECP_t rop, mpECP_t op);
 void mpECP_cswap(mpECP_t rop, mpECP_t op, int swap);
 
@@ -88,15 +173,125 @@ void mpECP_sub(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2);
 void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
 void mpECP_scalar_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc);
 
+// constant time scalar multiplication engines. mpECP_scalar_mul uses a fixed
+// window with window_bits selected per curve, window_bits < 2 is the ladder
+// (co-Z for short Weierstrass curves, x-only for Montgomery curves)
+void mpECP_scalar_mul_ladder(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
+// co-Z ladder for short Weierstrass curves, x-only ladder with y recovery for
+// Montgomery curves, other curve types use mpECP_scalar_mul_ladder
+void mpECP_scalar_mul_coz(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
+// x-only ladder for short Weierstrass and Montgomery curves, rx = x(sc * P)
+// from x(P). The _bytes form reads x from a point encoding (02/03/04, no
+// sqrt) and writes x of the result as (bits + 7) / 8 big endian bytes.
+// Nonzero on error
+int  mpECP_scalar_mul_x(mpFp_t rx, mpFp_t x, mpFp_t sc, mpECurve_t cv);
+int  mpECP_scalar_mul_x_bytes(unsigned char *rx, unsigned char *b, int blen, mpFp_t sc, mpECurve_t cv);
+void mpECP_scalar_mul_window(mpECP_t rpt, mpECP_t pt, mpFp_t sc, int window_bits);
+// GLV endomorphism (if cv->glv.enabled, else same as _window)
+void mpECP_scalar_mul_glv(mpECP_t rpt, mpECP_t pt, mpFp_t sc, int window_bits);
+int  mpECP_scalar_mul_window_bits(mpECurve_t cv);
+
+// precompute for repeated (constant time) multiplication of pt, window_bits
+// 0 selects the default. The handle does not reference pt
+void mpECP_precomp_init(mpECP_precomp_t pc, mpECP_t pt, int window_bits);
+void mpECP_precomp_clear(mpECP_precomp_t pc);
+void mpECP_scalar_mul_precomp(mpECP_t rpt, mpECP_precomp_t pc, mpFp_t sc);
+
+// variable time (wNAF) scalar multiplication, ONLY for public scalars, i.e.
+// signature verification, cofactor and subgroup checks. Time depends on sc.
+// The mpz scalar is not reduced modulo n (so n * P checks subgroup membership)
+void mpECP_scalar_mul_vartime(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
+void mpECP_scalar_mul_vartime_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc);
+
+// multi scalar multiplication rpt = sum(sc[j] * pts[j]) for j < n, with a
+// single shared doubling chain. Constant time (for secret scalars) and
+// variable time (for public scalars, e.g. aG + bQ in verification) forms
+void mpECP_multi_scalar_mul(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n);
+void mpECP_multi_scalar_mul_vartime(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n);
+// variable time bucket method (Pippenger) for large n (public scalars only).
+// Windows (and parts of the point set) are spread across nthreads threads,
+// nthreads <= 0 uses one thread per online cpu
+void mpECP_multi_scalar_mul_pippenger(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n, int nthreads);
+
+// group law formula sets, selected per curve for each class of operation.
+// MPECP_FORMULAS_SECRET (constant time paths) only accepts complete sets,
+// MPECP_FORMULAS_PUBLIC is used by the variable time (wNAF) paths. Sets are
+// "rcb", "rcb-a0", "rcb-a3", "jacobian", "jacobian-a0", "jacobian-a3",
+// "montgomery", "edwards" and "twisted-edwards". _set returns nonzero if the
+// set is unknown or does not apply to cv (e.g. -a3 needs a == -3). _list
+// stores up to max names of the sets which apply and returns how many there
+// are
+#define MPECP_FORMULAS_SECRET   (0)
+#define MPECP_FORMULAS_PUBLIC   (1)
+int  mpECP_formulas_set(mpECurve_t cv, int opclass, const char *name);
+const char *mpECP_formulas_name(mpECurve_t cv, int opclass);
+int  mpECP_formulas_list(mpECurve_t cv, int opclass, const char **names, int max);
+
+// measured per host tuning, as written by ecc-tune (benchmark/ecc_tune.c).
+// The file has one line per standard curve name followed by key=value
+// settings (window, base, secret, public) and optionally a "backend=<name>"
+// line for the field kernels ('#' starts a comment, unknown keys are
+// ignored). The file named by $ECC_TUNE_FILE (empty disables tuning) or
+// else the built in path is loaded when the first curve is set by name, and
+// settings apply to curves set with mpECurve_set_named. The backend line is
+// only read when the library is loaded ($ECC_FIELD_BACKEND takes precedence),
+// mpECP_tune_load does not change the backend. _load replaces all entries
+// and returns nonzero if the file cannot be read or is malformed (leaving no
+// entries), _reset drops them. Curves already set keep their settings
+int  mpECP_tune_load(const char *path);
+void mpECP_tune_reset(void);
+// path of the tuning file read at init (NULL if disabled)
+const char *mpECP_tune_path(void);
+
 void mpECP_neg(mpECP_t rpt, mpECP_t pt);
 int  mpECP_cmp(mpECP_t pt1, mpECP_t pt2);
 
 void mpECP_scalar_base_mul_setup(mpECP_t pt);
+// setup with explicit window (0 = default). If max_bytes != 0 the window is
+// reduced until the table fits. Returns nonzero if no table can be built.
+// Each level of the table has 2**(window_bits - 1) points, evaluation costs
+// ceil(bits(n) / window_bits) additions
+int  mpECP_scalar_base_mul_setup_ex(mpECP_t pt, int window_bits, size_t max_bytes);
+// memory footprint of the table for pt (0 if none), or for a curve + window
+size_t mpECP_scalar_base_mul_table_bytes(mpECP_t pt);
+size_t mpECP_scalar_base_mul_table_size(mpECurve_t cv, int window_bits);
+// persist the table of pt (after setup) to path, or map a saved table for pt
+// read only (shared between processes via the page cache). The file records
+// limb size, window, curve and point fingerprints and a checksum, load fails
+// (nonzero) if any of these do not match pt. Files must be trusted, the
+// checksum only detects accidental corruption.
+int  mpECP_scalar_base_mul_table_save(mpECP_t pt, char *path);
+int  mpECP_scalar_base_mul_table_load(mpECP_t pt, char *path);
+// if pt is the curve generator G, the default table is shared via the curve
+// (built once, thread safe) instead of being built per point
 void mpECP_scalar_base_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc);
 void mpECP_scalar_base_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc);
 
 void mpECP_urandom(mpECP_t rpt, mpECurve_t cv);
 
+// random keypair, priv uniform in [1, n-1] (priv initialized modulo cv->n)
+// and pub = priv * G using the shared generator table of the curve (built
+// on first use). The batch form returns the public keys in affine form
+void mpECP_keypair_generate(mpFp_t priv, mpECP_t pub, mpECurve_t cv);
+void mpECP_keypair_generate_batch(mpFp_t *priv, mpECP_t *pub, int n, mpECurve_t cv);
+
+// drop a reference to a (shared) base table, used by mpECurve_clear
+void _mpECP_base_table_release(struct _p_mpECP_base_table_t *tbl);
+
+// select point arithmetic (cv->ops) for the curve type and coefficients
+void _mpECP_curve_ops_select(mpECurve_t cv);
+// apply tuning (if any) for cv->name, used by mpECurve_set_named
+void _mpECP_tune_apply(mpECurve_t cv);
+
+// if a compile time specialized engine (include/ecc, configure
+// --enable-cxx-engines) matches the curve, return ops which use it for
+// scalar multiplication, otherwise return base
+const _mpECurve_ops_t *_mpECP_engine_ops_select(mpECurve_t cv, const _mpECurve_ops_t *base);
+
+// precomputed generator table for a named curve, generated at build time
+// (see gen_static_tables.c and configure --with-static-tables), or NULL
+_mpECP_base_table_t *_mpECP_static_base_table(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,11 +33,16 @@
 
 #include <field.h>
 #include <gmp.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct _p_mpECP_base_table_t;
+struct _p_mpECP_t;
+struct _p_mpECurve_t;
+
 // Implementation of Elliptic Curve math following GNU GMP sytle
 // internal representation supports projective (e.g. Jacobian) coords
 
@@ -48,6 +53,7 @@ typedef enum {EQTypeNone, EQTypeUninitialized, EQTypeShortWeierstrass, EQTypeEdw
 typedef struct {
     mpFp_t a; // coefficient of equation
     mpFp_t b; // coefficient of equation
+    mpFp_t b3; // 3 * b, used by the complete addition formulas
 } _mpECurve_ws_curve_coeff_t;
 
 // Edwards curve defined as x**2 + y**2 = c**2 * (1 + (d * x**2 * y**2))
@@ -62,19 +68,16 @@ typedef struct {
 typedef struct {
     mpFp_t B; // coefficient of equation
     mpFp_t A; // coefficient of equation
-    // internal representation of Montgomery curve points is ws
-    // to facilitate add/double (not differential)
-    // transform is :
+    // points are represented in Montgomery coordinates (see ecpoint.c), the
+    // equivalent short Weierstrass curve is kept for reference :
     // x = Bu-A/3, y = Bv
     // ws_a = (3-A^2)/(3B^2) and ws_b = (2A^3-9A)/(27B^3)
     // resulting equation:
     // v^2 = u^3 + ws_a * u + ws_b
-    // reverse transform:
-    // u = Binv * x + A/3, v = Binv * y
     mpFp_t ws_a; // coefficient of transformed equation
     mpFp_t ws_b; // coefficient of transformed equation
-    mpFp_t Binv; // coefficient of transform
-    mpFp_t Adiv3; // coefficient of transform
+    mpFp_t Binv; // 1 / B
+    mpFp_t a24; // (A - 2) / 4, for the x-only ladder
 } _mpECurve_mo_curve_coeff_t;
 
 // Twisted Edwards : a * x**2 + y**2 = 1 + (d * x**2 * y**2)
@@ -91,7 +94,54 @@ typedef union {
     _mpECurve_te_curve_coeff_t te;
 } _mpECurve_coeff_t;
 
+// GLV endomorphism for short Weierstrass curves with a = 0 (j-invariant 0,
+// e.g. secp256k1). phi(x, y) = (beta * x, y) acts as phi(P) = lambda * P on
+// the group of order n, so k * P = k1 * P + k2 * phi(P) where
+// k = k1 + k2 * lambda mod n and |k1|, |k2| ~ sqrt(n)
+
 typedef struct {
+    int enabled; // nonzero if the endomorphism is available for this curve
+    mpFp_t beta; // cube root of unity in Fp
+    mpz_t lambda; // cube root of unity mod n, eigenvalue of phi
+    mpz_t a1, b1, a2, b2; // short basis of {(x, y) : x + y * lambda = 0 mod n}
+    unsigned int bits; // bound on bit size of |k1|, |k2|
+} _mpECurve_glv_t;
+
+// point group law formulas. Points are stored in projective coordinates
+// (x = X/Z, y = Y/Z), sets which work in other coordinates (e.g. Jacobian)
+// are entered and left with from_proj/to_proj (NULL if not needed). Complete
+// sets have no exceptional cases and are the only ones allowed for secret
+// data. Each curve selects one set per class of operation, see
+// mpECP_formulas_set in ecpoint.h. Points passed to these are never the
+// neutral element
+
+typedef struct _p_mpECurve_formulas_t {
+    const char *name;
+    int complete; // nonzero if exception free (constant time)
+    void (*add)(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt1, struct _p_mpECP_t *pt2);
+    // pt2 has z == 1
+    void (*add_mixed)(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt1, struct _p_mpECP_t *pt2);
+    void (*dbl)(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt);
+    void (*from_proj)(struct _p_mpECP_t *pt);
+    void (*to_proj)(struct _p_mpECP_t *pt);
+} _mpECurve_formulas_t;
+
+// per coordinate model operations, selected when the curve parameters are
+// set (see _mpECP_curve_ops_select in ecpoint.c). Only the entries that
+// differ between models live here; the group law is in the formula sets and
+// the field arithmetic backend is selected in field.c.
+// Points passed to these are never the neutral element
+
+typedef struct _p_mpECurve_ops_t {
+    const char *name; // coordinate model, for diagnostics
+    void (*neg)(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt);
+    // solve the curve equation for y, nonzero if x is not on the curve
+    int (*solve_y)(mpFp_t y, mpFp_t x, struct _p_mpECurve_t *cvp);
+    // optional (may be NULL), replaces the generic mpECP_scalar_mul
+    void (*scalar_mul)(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt, mpFp_t sc);
+} _mpECurve_ops_t;
+
+typedef struct _p_mpECurve_t {
     _mpECurve_eq_type type; // curve type
     //mpz_t p; // prime field of curve
     mpFp_field_ptr fp;
@@ -100,6 +150,31 @@ typedef struct {
     mpz_t h; // cofactor of curve
     mpz_t G[2]; // x,y coordinates of Generator of EC Group
     unsigned int bits; // bit size of curve, i.e. ceil(log2(p))
+    // endomorphism data (if glv.enabled), derived once and copied from the
+    // canonical curve by later instances
+    _mpECurve_glv_t glv;
+    // shared fixed base table for G, built on first use and normally kept
+    // on the canonical curve (see _mpECP_curve_base_table in ecpoint.c)
+    struct _p_mpECP_base_table_t *base_tbl;
+    const char *name; // standard curve name if set with set_named, else NULL
+    // canonical (interned) copy of this curve, NULL until the curve is set.
+    // Equal curves share the same canonical object, see mpECurve_intern
+    struct _p_mpECurve_t *canon;
+    uint64_t hash; // parameter hash (canonical curves only)
+    int refcount; // references to a canonical curve
+    int interned; // nonzero for canonical curves, which are immutable
+    const _mpECurve_ops_t *ops; // point arithmetic for this curve
+    // group law formulas for secret (constant time) and public data
+    const _mpECurve_formulas_t *formulas[2];
+    // short Weierstrass coefficients used by the formulas (NULL for other
+    // curve types)
+    mpFp_ptr ws_a;
+    mpFp_ptr ws_b;
+    mpFp_ptr ws_b3;
+    // measured settings from the tuning file (see mpECP_tune_load in
+    // ecpoint.h), 0 selects the built in default
+    int window_bits; // mpECP_scalar_mul window, 1 is the co-Z ladder
+    int base_bits; // window of the shared generator table
 } _mpECurve_t;
 
 typedef _mpECurve_t mpECurve_t[1];
@@ -134,6 +209,22 @@ int mpECurve_point_check(mpECurve_t c, mpz_t Px, mpz_t Py);
 
 int mpECurve_cmp(mpECurve_t op1, mpECurve_t op2);
 
+// return the canonical (interned) curve equal to cv, with a new reference.
+// Canonical curves are immutable and shared, so two curves are equal exactly
+// when their canonical pointers are equal. Curves set with mpECurve_set_*
+// are interned automatically (cv->canon). Release with mpECurve_release
+mpECurve_ptr mpECurve_intern(mpECurve_t cv);
+void mpECurve_release(mpECurve_ptr cv);
+
+// FNV-1a hash of curve parameters (also used to tag saved tables)
+uint64_t _mpECurve_fnv1a(uint64_t h, const void *buf, size_t len);
+uint64_t _mpECurve_fnv1a_mpz(uint64_t h, mpz_t z);
+uint64_t _mpECurve_hash(mpECurve_t cv);
+
+// decompose k as k1 + k2 * lambda mod n (requires cv->glv.enabled), the
+// results may be negative
+void _mpECurve_glv_decompose(mpz_t k1, mpz_t k2, mpz_t k, mpECurve_t cv);
+
 /* note, _list_standard_curves allocates space for the list of curves and 
 the curve names. This call returns the list, it is the responsibility of the
 caller to free the individual names and then the list itself. The curve list
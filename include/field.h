@@ -67,6 +67,8 @@ typedef _mpFp_struct *mpFp_ptr;
 
 void mpFp_swap(mpFp_t rop, mpFp_t op);
 void mpFp_cswap(mpFp_t rop, mpFp_t op, int swap);
+// conditional move, rop = op if move != 0 (constant time)
+void mpFp_cmov(mpFp_t rop, mpFp_t op, int move);
 
 /* basic arithmetic */
 
@@ -125,6 +127,16 @@ int  mpFp_tstbit(mpFp_t op, int bit);
 
 void mpFp_urandom(mpFp_t rop, mpz_t p);
 
+/* multiplication kernels */
+
+// name of the kernels in use for mul/sqr ("gmp", or "adx" on x86-64 with
+// BMI2 and ADX). Chosen at load time, ECC_FIELD_BACKEND=name or the backend
+// line of the tuning file (see mpECP_tune_load) override
+const char *mpFp_backend_name(void);
+// select kernels by name, nonzero if unknown or not supported by the cpu.
+// Not thread safe, intended for startup and benchmarks
+int  mpFp_backend_set(const char *name);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,161 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef _EC_FIELD_INLINE_H_INCLUDED_
+#define _EC_FIELD_INLINE_H_INCLUDED_
+
+#include <assert.h>
+#include <field.h>
+#include <gmp.h>
+
+// static inline versions of the cheapest field operations. The point
+// formulas are long chains of add/sub between multiplications, so calling
+// across the library boundary for each one costs more than the operation.
+// field.c builds the exported functions from these (which keeps the ABI).
+// Define _EC_FIELD_H_INLINE_MATH before including this header to have
+// mpFp_add, mpFp_sub, mpFp_neg, mpFp_cmp_ui and mpFp_cswap use them
+
+// consistency checks for the inline operations. Like PARANOID_ASSERT in
+// field.c these are debug checks, compiled in only when _EC_FIELD_PARANOID
+// is defined before this header is included
+#ifdef _EC_FIELD_PARANOID
+#define _MPFP_PARANOID_ASSERT(X)  assert((X))
+#else
+#define _MPFP_PARANOID_ASSERT(X)
+#endif
+
+static inline void _mpFp_realloc_inline(mpFp_t c) {
+    if (__GMP_UNLIKELY(c->i->_mp_alloc < c->fp->p2size)) {
+        mpz_realloc(c->i, c->fp->p2size);
+    }
+}
+
+static inline void _mpFp_add_inline(mpFp_t c, mpFp_t a, mpFp_t b) {
+    mpFp_field_ptr fp;
+    mp_limb_t carry, borrow;
+    _MPFP_PARANOID_ASSERT(a->fp == b->fp);
+    c->fp = a->fp;
+    fp = a->fp;
+    _mpFp_realloc_inline(c);
+
+    carry = mpn_add_n(c->i->_mp_d, a->i->_mp_d, b->i->_mp_d, fp->psize);
+    if ((carry != 0) || (mpn_cmp(c->i->_mp_d, fp->p->_mp_d, fp->psize) >= 0)) {
+        borrow = mpn_sub_n(c->i->_mp_d, c->i->_mp_d, fp->p->_mp_d, fp->psize);
+        _MPFP_PARANOID_ASSERT(borrow == carry);
+        (void)borrow;
+    }
+
+    c->i->_mp_size = fp->psize;
+    return;
+}
+
+static inline void _mpFp_sub_inline(mpFp_t c, mpFp_t a, mpFp_t b) {
+    mpFp_field_ptr fp;
+    mp_limb_t carry, borrow;
+    _MPFP_PARANOID_ASSERT(a->fp == b->fp);
+    c->fp = a->fp;
+    fp = a->fp;
+    _mpFp_realloc_inline(c);
+
+    borrow = mpn_sub_n(c->i->_mp_d, a->i->_mp_d, b->i->_mp_d, fp->psize);
+    if (borrow != 0) {
+        carry = mpn_add_n(c->i->_mp_d, fp->p->_mp_d, c->i->_mp_d, fp->psize);
+        _MPFP_PARANOID_ASSERT(carry == 1);
+        (void)carry;
+    }
+
+    c->i->_mp_size = fp->psize;
+    return;
+}
+
+static inline void _mpFp_neg_inline(mpFp_t c, mpFp_t a) {
+    mpFp_field_ptr fp;
+    mp_limb_t nz;
+    mp_size_t i;
+    c->fp = a->fp;
+    fp = a->fp;
+    _mpFp_realloc_inline(c);
+
+    // -0 = 0, need to detect 0
+    nz = 0;
+    for (i = 0; i < fp->psize; i++) {
+        nz |= a->i->_mp_d[i];
+    }
+
+    if (__GMP_UNLIKELY(nz == 0)) {
+        for (i = 0; i < fp->psize; i++) {
+            c->i->_mp_d[i] = 0;
+        }
+    } else {
+        mpn_sub_n(c->i->_mp_d, fp->p->_mp_d, a->i->_mp_d, fp->psize);
+    }
+
+    c->i->_mp_size = fp->psize;
+    return;
+}
+
+static inline int _mpFp_cmp_ui_inline(mpFp_t a, unsigned long b) {
+    mp_limb_t b_limb;
+    mp_size_t i;
+    int cmp;
+    b_limb = b;
+
+    cmp = !(b_limb == a->i->_mp_d[0]);
+    for (i = 1; i < a->fp->psize; i++) {
+        cmp |= !(0 == a->i->_mp_d[i]);
+    }
+    return cmp;
+}
+
+static inline void _mpFp_cswap_inline(mpFp_t a, mpFp_t b, int swap) {
+    mp_limb_t mask, t;
+    mp_size_t i;
+    _MPFP_PARANOID_ASSERT(a->fp == b->fp);
+    // mask is all ones if swap, else zero
+    mask = ((mp_limb_t)0) - ((mp_limb_t)(swap != 0));
+
+    for (i = 0; i < a->fp->psize; i++) {
+        t = mask & (a->i->_mp_d[i] ^ b->i->_mp_d[i]);
+        a->i->_mp_d[i] ^= t;
+        b->i->_mp_d[i] ^= t;
+    }
+    return;
+}
+
+#ifdef _EC_FIELD_H_INLINE_MATH
+#define mpFp_add(c, a, b)       _mpFp_add_inline((c), (a), (b))
+#define mpFp_sub(c, a, b)       _mpFp_sub_inline((c), (a), (b))
+#define mpFp_neg(c, a)          _mpFp_neg_inline((c), (a))
+#define mpFp_cmp_ui(a, b)       _mpFp_cmp_ui_inline((a), (b))
+#define mpFp_cswap(a, b, swap)  _mpFp_cswap_inline((a), (b), (swap))
+#endif
+
+#endif // _EC_FIELD_INLINE_H_INCLUDED_
@@ -0,0 +1,153 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Bridge from the C point API to the compile time specialized engines in
+// include/ecc. A curve set with parameters matching one of the engines
+// gets ops (see _mpECP_curve_ops_select) which run scalar multiplication
+// entirely in fixed size Montgomery arithmetic, converting only the input
+// point and the result
+
+#include <assert.h>
+#include <ecc/engine.hpp>
+#include <ecpoint.h>
+#include <ecurve.h>
+#include <field.h>
+#include <gmp.h>
+
+namespace {
+
+#if GMP_NUMB_BITS == 64
+
+template <std::size_t N>
+int _mpz_cmp_limbs(mpz_t z, const ecc::limbs<N> &l) {
+    mp_size_t i, sz;
+    sz = mpz_size(z);
+    if (mpz_sgn(z) < 0) return -1;
+    if (sz > (mp_size_t)N) return 1;
+    for (i = 0; i < (mp_size_t)N; i++) {
+        mp_limb_t v = (i < sz) ? mpz_getlimbn(z, i) : 0;
+        if (v != l[i]) return 1;
+    }
+    return 0;
+}
+
+template <class Curve>
+int _engine_match(mpECurve_ptr cv) {
+    using model = typename Curve::model;
+    if (_mpz_cmp_limbs<Curve::N>(cv->fp->p, Curve::p) != 0) return 0;
+    if constexpr (ecc::detail::is_ws_model<Curve>()) {
+        if (cv->type != EQTypeShortWeierstrass) return 0;
+        return (_mpz_cmp_limbs<Curve::N>(cv->coeff.ws.a->i, Curve::a) == 0) &&
+               (_mpz_cmp_limbs<Curve::N>(cv->coeff.ws.b->i, Curve::b) == 0);
+    } else if constexpr (std::is_same<model, ecc::twisted_edwards>::value) {
+        if (cv->type != EQTypeTwistedEdwards) return 0;
+        return (_mpz_cmp_limbs<Curve::N>(cv->coeff.te.a->i, Curve::a) == 0) &&
+               (_mpz_cmp_limbs<Curve::N>(cv->coeff.te.d->i, Curve::d) == 0);
+    } else {
+        if (cv->type != EQTypeEdwards) return 0;
+        return (_mpz_cmp_limbs<Curve::N>(cv->coeff.ed.c->i, Curve::c) == 0) &&
+               (_mpz_cmp_limbs<Curve::N>(cv->coeff.ed.d->i, Curve::d) == 0);
+    }
+}
+
+// field elements hold psize limbs (see field.c), which is N for the engines
+template <class F>
+F _engine_import(mpFp_t a) {
+    ecc::limbs<F::nlimbs> l{};
+    std::size_t i;
+    assert(a->i->_mp_size == (mp_size_t)F::nlimbs);
+    for (i = 0; i < F::nlimbs; i++) l[i] = a->i->_mp_d[i];
+    return F::from_limbs(l);
+}
+
+template <class F>
+void _engine_export(mpFp_t r, const F &a) {
+    ecc::limbs<F::nlimbs> l = a.to_limbs();
+    std::size_t i;
+    assert(r->fp->psize == (mp_size_t)F::nlimbs);
+    for (i = 0; i < F::nlimbs; i++) r->i->_mp_d[i] = l[i];
+    r->i->_mp_size = F::nlimbs;
+}
+
+template <class Curve>
+void _engine_scalar_mul(struct _p_mpECP_t *rpt, struct _p_mpECP_t *pt, mpFp_t sc) {
+    using E = ecc::engine<Curve>;
+    typename E::point P, R;
+    uint64_t k[E::N] = {};
+    mp_size_t i, sz;
+    mpECP_t T;
+
+    P.X = _engine_import<typename E::field>(pt->x);
+    P.Y = _engine_import<typename E::field>(pt->y);
+    P.Z = _engine_import<typename E::field>(pt->z);
+    sz = sc->fp->psize;
+    assert(sz <= (mp_size_t)E::N);
+    for (i = 0; i < sz; i++) k[i] = sc->i->_mp_d[i];
+    R = E::scalar_mul(P, k, mpz_sizeinbase(pt->cvp->n, 2));
+
+    mpECP_init(T, pt->cvp);
+    if (E::is_ws && R.Z.is_zero()) {
+        mpECP_set_neutral(T, pt->cvp);
+    } else {
+        _engine_export(T->x, R.X);
+        _engine_export(T->y, R.Y);
+        _engine_export(T->z, R.Z);
+        T->is_neutral = 0;
+    }
+    mpECP_set(rpt, T);
+    mpECP_clear(T);
+}
+
+// engine ops are the generic ops for the curve with scalar_mul replaced
+template <class Curve>
+const _mpECurve_ops_t *_engine_ops(const _mpECurve_ops_t *base) {
+    static const _mpECurve_ops_t ops = [base]() {
+        _mpECurve_ops_t o = *base;
+        o.name = Curve::name;
+        o.scalar_mul = _engine_scalar_mul<Curve>;
+        return o;
+    }();
+    return &ops;
+}
+
+#endif // GMP_NUMB_BITS == 64
+
+} // namespace
+
+extern "C" const _mpECurve_ops_t *_mpECP_engine_ops_select(mpECurve_t cv, const _mpECurve_ops_t *base) {
+#if GMP_NUMB_BITS == 64
+    if (_engine_match<ecc::p256>(cv)) return _engine_ops<ecc::p256>(base);
+    if (_engine_match<ecc::secp256k1>(cv)) return _engine_ops<ecc::secp256k1>(base);
+    if (_engine_match<ecc::ed25519>(cv)) return _engine_ops<ecc::ed25519>(base);
+    if (_engine_match<ecc::ed448>(cv)) return _engine_ops<ecc::ed448>(base);
+#endif
+    return base;
+}
@@ -28,16 +28,43 @@
 //OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// point formulas use the inline add/sub/neg/cmp_ui/cswap (field_inline.h)
+#define _EC_FIELD_H_INLINE_MATH
+
 #include <assert.h>
 #include <ecpoint.h>
 #include <ecurve.h>
+#include <fcntl.h>
 #include <field.h>
+#include <field_inline.h>
 #include <gmp.h>
+#include <mpzurandom.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// window size for fixed base tables, entries per level = 2**(bits - 1)
+#ifndef _MPECP_BASE_BITS
+#define _MPECP_BASE_BITS    (6)
+#endif
+
+// window size used by mpECP_scalar_mul. 0 selects the per-curve default
+// (see _mpECP_default_window_bits), 1 forces the Brier-Joye ladder
+#ifndef _MPECP_WINDOW_BITS
+#define _MPECP_WINDOW_BITS  (0)
+#endif
+#define _MPECP_MAX_WINDOW_BITS  (8)
 
-#define _MPECP_BASE_BITS    (8)
+// mpECP_multi_scalar_mul_vartime switches from interleaved wNAF to the
+// bucket method (single thread) at this many points
+#ifndef _MPECP_PIPPENGER_MIN_POINTS
+#define _MPECP_PIPPENGER_MIN_POINTS (192)
+#endif
 
 // defining _MPECP_MPFP_NOMALLOC uses fixed structures for mpFp elements
 // it is of course critical that *_realloc is never called, so _mp_alloc
@@ -55,27 +82,38 @@ typedef mp_limb_t __local_limb_t[_MPFP_MAX_LIMBS];
 
 static char *_hexlut = "0123456789ABCDEF";
 
-static inline int _mpECP_n_base_pt_levels(mpECP_t pt) {
-    return (pt->cvp->bits + pt->base_bits - 1) / pt->base_bits;
+// guards lazy construction of the per curve generator tables
+static pthread_mutex_t _mpECP_base_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _mpECP_base_table_free(_mpECP_base_table_t *tbl) {
+    if (tbl->map != NULL) {
+        munmap(tbl->map, tbl->map_bytes);
+    } else {
+        free(tbl->limbs);
+    }
+    free(tbl);
+    return;
 }
 
-static inline int _mpECP_n_base_pt_level_size(mpECP_t pt) {
-    return (1 << pt->base_bits);
+static inline _mpECP_base_table_t *_mpECP_base_table_ref(_mpECP_base_table_t *tbl) {
+    if (tbl->is_static != 0) return tbl;
+    __atomic_add_fetch(&(tbl->refcount), 1, __ATOMIC_RELAXED);
+    return tbl;
 }
 
-static inline int _mpECP_n_base_pts(mpECP_t pt) {
-    return _mpECP_n_base_pt_levels(pt) * _mpECP_n_base_pt_level_size(pt);
+void _mpECP_base_table_release(_mpECP_base_table_t *tbl) {
+    if (tbl == NULL) return;
+    if (tbl->is_static != 0) return;
+    if (__atomic_sub_fetch(&(tbl->refcount), 1, __ATOMIC_ACQ_REL) == 0) {
+        _mpECP_base_table_free(tbl);
+    }
+    return;
 }
 
 static void _mpECP_base_pts_cleanup(mpECP_t pt) {
-    int i, npts;
-    assert(pt->base_pt != NULL);
-    npts = _mpECP_n_base_pts(pt);
-    for (i = 0; i < npts; i++) {
-        mpECP_clear(&(pt->base_pt[i]));
-    }
-    free(pt->base_pt);
-    pt->base_pt = NULL;
+    assert(pt->base_tbl != NULL);
+    _mpECP_base_table_release(pt->base_tbl);
+    pt->base_tbl = NULL;
     pt->base_bits = 0;
 }
 
@@ -86,13 +124,23 @@ static int _known_curve_type(mpECurve_t cv) {
         (cv->type == EQTypeTwistedEdwards);
 }
 
+// curves set through the mpECurve_set_* API are interned, so equal curves
+// have the same canonical pointer
+static inline int _mpECP_same_curve(mpECurve_ptr cv1, mpECurve_ptr cv2) {
+    if (cv1 == cv2) return 1;
+    if (__GMP_LIKELY((cv1->canon != NULL) && (cv2->canon != NULL))) {
+        return (cv1->canon == cv2->canon);
+    }
+    return (mpECurve_cmp(cv1, cv2) == 0);
+}
+
 void mpECP_init(mpECP_t pt, mpECurve_t cv) {
     pt->cvp = cv;
     mpFp_init_fp(pt->x, cv->fp);
     mpFp_init_fp(pt->y, cv->fp);
     mpFp_init_fp(pt->z, cv->fp);
     pt->base_bits = 0;
-    pt->base_pt = NULL;
+    pt->base_tbl = NULL;
     return;
 }
 
@@ -115,14 +163,6 @@ void mpECP_set(mpECP_t rpt, mpECP_t pt) {
     return;
 }
 
-static inline void _transform_mo_to_ws(mpECP_t pt) {
-    assert (pt->cvp->type == EQTypeMontgomery);
-    // u = x/B + A/3, v = y/B
-    mpFp_mul(pt->x, pt->x, pt->cvp->coeff.mo.Binv);
-    mpFp_add(pt->x, pt->x, pt->cvp->coeff.mo.Adiv3);
-    mpFp_mul(pt->y, pt->y, pt->cvp->coeff.mo.Binv);
-}
-
 void mpECP_set_mpz(mpECP_t rpt, mpz_t x, mpz_t y, mpECurve_t cv) {
     if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
     rpt->cvp = &cv[0];
@@ -130,7 +170,6 @@ void mpECP_set_mpz(mpECP_t rpt, mpz_t x, mpz_t y, mpECurve_t cv) {
     mpFp_set_mpz_fp(rpt->x, x, cv->fp);
     mpFp_set_mpz_fp(rpt->y, y, cv->fp);
     mpFp_set_ui_fp(rpt->z, 1, cv->fp);
-    if (cv->type == EQTypeMontgomery) _transform_mo_to_ws(rpt);
     return;
 }
 
@@ -143,7 +182,6 @@ void mpECP_set_mpFp(mpECP_t rpt, mpFp_t x, mpFp_t y, mpECurve_t cv) {
     mpFp_set(rpt->x, x);
     mpFp_set(rpt->y, y);
     mpFp_set_ui_fp(rpt->z, 1, cv->fp);
-    if (cv->type == EQTypeMontgomery) _transform_mo_to_ws(rpt);
     return;
 }
 
@@ -182,113 +220,155 @@ void mpECP_set_neutral(mpECP_t rpt, mpECurve_t cv) {
     }
 }
 
-void _mpECP_to_affine(mpECP_t pt) {
+// Projective x = X/Z y = Y/Z (all curve types, formula sets which use other
+// coordinates convert on entry and exit, see _mpECurve_formulas_t)
+static void _mpECP_set_zinv_proj(mpECP_t pt, mpFp_t zinv) {
+    mpFp_mul(pt->x, pt->x, zinv);
+    mpFp_mul(pt->y, pt->y, zinv);
+    mpFp_set_ui_fp(pt->z, 1, pt->cvp->fp);
+    return;
+}
+
+static void _mpECP_to_affine_proj(mpECP_t pt) {
     mpFp_t zinv;
+    mpFp_init_fp(zinv, pt->cvp->fp);
+    mpFp_inv(zinv, pt->z);
+    _mpECP_set_zinv_proj(pt, zinv);
+    mpFp_clear(zinv);
+    return;
+}
+
+void _mpECP_to_affine(mpECP_t pt) {
     if (mpFp_cmp_ui(pt->z, 1) == 0) {
         return;
     }
-    mpFp_init_fp(zinv, pt->cvp->fp);
-    switch (pt->cvp->type) {
-        case EQTypeMontgomery:
-            // Montgomery curve point internal representation is short-WS
-        case EQTypeShortWeierstrass:
-            // RCB uses projective coords, so fall through to same xform as Ed
-#ifndef _MPECP_USE_RCB
-            {
-                mpFp_t t;
-                if (pt->is_neutral != 0) break;
-                // Jacobian coords x = X/Z**2 y = Y/Z**3);
-                mpFp_init_fp(t, pt->cvp->fp);
-                mpFp_inv(zinv, pt->z);
-                mpFp_sqr(t, zinv);
-                mpFp_mul(pt->x, pt->x, t);
-                mpFp_pow_ui(t, zinv, 3);
-                mpFp_mul(pt->y, pt->y, t);
-                mpFp_set_ui_fp(pt->z, 1, pt->cvp->fp);
-                mpFp_clear(t);
-            }
-            break;
-#endif
-        case EQTypeEdwards:
-            // Projective x = X/Z y = Y/Z
-        case EQTypeTwistedEdwards:
-            // Projective x = X/Z y = Y/Z
-            mpFp_inv(zinv, pt->z);
-            mpFp_mul(pt->x, pt->x, zinv);
-            mpFp_mul(pt->y, pt->y, zinv);
-            mpFp_set_ui_fp(pt->z, 1, pt->cvp->fp);
-            break;
-        default:
-            assert(_known_curve_type(pt->cvp));
+    _mpECP_to_affine_proj(pt);
+    return;
+}
+
+// scale projective (or Jacobian) coordinates by zinv = 1/Z, so pt is affine
+static inline void _mpECP_set_zinv(mpECP_t pt, mpFp_t zinv) {
+    _mpECP_set_zinv_proj(pt, zinv);
+    return;
+}
+
+// normalize n points to affine (Z = 1) with a single inversion using
+// Montgomery's simultaneous inversion (3(n-1) extra multiplications). Points
+// which are neutral or already affine are skipped
+static void _mpECP_batch_to_affine_ptr(struct _p_mpECP_t **pts, int n) {
+    int i, m, status;
+    int *idx;
+    mpFp_t *acc;
+    mpFp_t inv, zinv;
+
+    if (n <= 0) return;
+    idx = (int *)malloc(n * sizeof(int));
+    assert(idx != NULL);
+    m = 0;
+    for (i = 0; i < n; i++) {
+        if ((pts[i]->is_neutral != 0) || (mpFp_cmp_ui(pts[i]->z, 1) == 0) ||
+            (mpFp_cmp_ui(pts[i]->z, 0) == 0)) {
+            continue;
+        }
+        idx[m] = i;
+        m += 1;
+    }
+    if (m == 0) {
+        free(idx);
+        return;
+    }
+    acc = (mpFp_t *)malloc(m * sizeof(mpFp_t));
+    assert(acc != NULL);
+    mpFp_init_fp(inv, pts[0]->cvp->fp);
+    mpFp_init_fp(zinv, pts[0]->cvp->fp);
+    // acc[i] = Z[0] * Z[1] * ... * Z[i]
+    for (i = 0; i < m; i++) {
+        mpFp_init_fp(acc[i], pts[0]->cvp->fp);
+        if (i == 0) {
+            mpFp_set(acc[i], pts[idx[i]]->z);
+        } else {
+            mpFp_mul(acc[i], acc[i-1], pts[idx[i]]->z);
+        }
     }
+    status = mpFp_inv(inv, acc[m-1]);
+    assert(status == 0);
+    // walk back, peeling one Z off the accumulated inverse each step
+    for (i = m - 1; i > 0; i--) {
+        mpFp_mul(zinv, inv, acc[i-1]);
+        mpFp_mul(inv, inv, pts[idx[i]]->z);
+        _mpECP_set_zinv(pts[idx[i]], zinv);
+    }
+    _mpECP_set_zinv(pts[idx[0]], inv);
+
+    for (i = 0; i < m; i++) {
+        mpFp_clear(acc[i]);
+    }
+    free(acc);
+    free(idx);
     mpFp_clear(zinv);
+    mpFp_clear(inv);
     return;
 }
 
-static inline void _transform_ws_to_mo_x(mpFp_t x, mpECP_t pt) {
-    //assert (pt->cvp->type == EQTypeMontgomery)
-    //_mpECP_to_affine(pt);
-    // transform to Mo
-    // x = Bu-A/3, y = Bv
-    mpFp_mul(x, pt->x, pt->cvp->coeff.mo.B);
-    mpFp_sub(x, x, pt->cvp->coeff.mo.Adiv3);
+static void _mpECP_batch_to_affine(struct _p_mpECP_t *pts, int n) {
+    int i;
+    struct _p_mpECP_t **p;
+
+    if (n <= 0) return;
+    p = (struct _p_mpECP_t **)malloc(n * sizeof(struct _p_mpECP_t *));
+    assert(p != NULL);
+    for (i = 0; i < n; i++) {
+        p[i] = &pts[i];
+    }
+    _mpECP_batch_to_affine_ptr(p, n);
+    free(p);
     return;
 }
 
-static inline void _transform_ws_to_mo_y(mpFp_t y, mpECP_t pt) {
-    //assert (pt->cvp->type == EQTypeMontgomery)
-    //_mpECP_to_affine(pt);
-    // transform to Mo
-    // x = Bu-A/3, y = Bv
-    mpFp_mul(y, pt->y, pt->cvp->coeff.mo.B);
+void mpECP_batch_to_affine(mpECP_t *pts, int n) {
+    int i;
+    struct _p_mpECP_t **p;
+
+    if (n <= 0) return;
+    p = (struct _p_mpECP_t **)malloc(n * sizeof(struct _p_mpECP_t *));
+    assert(p != NULL);
+    for (i = 0; i < n; i++) {
+        p[i] = pts[i];
+    }
+    _mpECP_batch_to_affine_ptr(p, n);
+    free(p);
     return;
 }
 
+// conversion between the internal representation and the affine
+// coordinates of the curve equation (pt is affine, x or y may be NULL)
 void mpFp_set_mpECP_affine_x(mpFp_t x, mpECP_t pt) {
     _mpECP_to_affine(pt);
-    if (pt->cvp->type == EQTypeMontgomery) {
-        _transform_ws_to_mo_x(x, pt);
-    } else {
-        mpFp_set(x, pt->x);
-    }
+    mpFp_set(x, pt->x);
     return;
 }
 
 void mpFp_set_mpECP_affine_y(mpFp_t y, mpECP_t pt) {
     _mpECP_to_affine(pt);
-    if (pt->cvp->type == EQTypeMontgomery) {
-        _transform_ws_to_mo_y(y, pt);
-    } else {
-        mpFp_set(y, pt->y);
-    }
+    mpFp_set(y, pt->y);
     return;
 }
 
 void mpz_set_mpECP_affine_x(mpz_t x, mpECP_t pt) {
-    _mpECP_to_affine(pt);
-    if (pt->cvp->type == EQTypeMontgomery) {
-        mpFp_t t;
-        mpFp_init_fp(t, pt->cvp->fp);
-        _transform_ws_to_mo_x(t, pt);
-        mpz_set_mpFp(x, t);
-        mpFp_clear(t);
-    } else {
-        mpz_set_mpFp(x, pt->x);
-    }
+    mpFp_t t;
+    mpFp_init_fp(t, pt->cvp->fp);
+    mpFp_set_mpECP_affine_x(t, pt);
+    mpz_set_mpFp(x, t);
+    mpFp_clear(t);
     return;
 }
 
 void mpz_set_mpECP_affine_y(mpz_t y, mpECP_t pt) {
-    _mpECP_to_affine(pt);
-    if (pt->cvp->type == EQTypeMontgomery) {
-        mpFp_t t;
-        mpFp_init_fp(t, pt->cvp->fp);
-        _transform_ws_to_mo_y(t, pt);
-        mpz_set_mpFp(y, t);
-        mpFp_clear(t);
-    } else {
-        mpz_set_mpFp(y, pt->y);
-    }
+    mpFp_t t;
+    mpFp_init_fp(t, pt->cvp->fp);
+    mpFp_set_mpECP_affine_y(t, pt);
+    mpz_set_mpFp(y, t);
+    mpFp_clear(t);
     return;
 }
 
@@ -324,6 +404,88 @@ int mpECP_set_str(mpECP_t rpt, char *s, mpECurve_t cv) {
     return status;
 }
 
+// decompression, solve the curve equation for y given x. Returns nonzero if
+// there is no solution (x is not the coordinate of a curve point)
+static int _mpECP_solve_y_ws(mpFp_t y, mpFp_t x, mpECurve_ptr cv) {
+    mpFp_t t;
+    int error;
+    mpFp_init_fp(t, cv->fp);
+    // y**2 = x**3 + ax + b
+    mpFp_mul(t, cv->coeff.ws.a, x);
+    mpFp_add(y, cv->coeff.ws.b, t);
+    mpFp_pow_ui(t, x, 3);
+    mpFp_add(y, y, t);
+    error = mpFp_sqrt(y, y);
+    mpFp_clear(t);
+    return error;
+}
+
+static int _mpECP_solve_y_ed(mpFp_t y, mpFp_t x, mpECurve_ptr cv) {
+    mpFp_t c2, x2, t;
+    int error;
+    mpFp_init_fp(c2, cv->fp);
+    mpFp_init_fp(x2, cv->fp);
+    mpFp_init_fp(t, cv->fp);
+    // x**2 + y**2 = c**2 (1 + d * x**2 * y**2)
+    // y**2 - C**2 * d * x**2 * y**2 = c**2 - x**2
+    // y**2 = (c**2 - x**2) / (1 - c**2 * d * x**2)
+    mpFp_mul(c2, cv->coeff.ed.c, cv->coeff.ed.c);
+    mpFp_mul(t, cv->coeff.ed.d, c2);
+    mpFp_pow_ui(x2, x, 2);
+    mpFp_mul(t, t, x2);
+    mpFp_set_ui_fp(y, 1, cv->fp);
+    mpFp_sub(t, y, t);
+    mpFp_sub(y, c2, x2);
+    mpFp_inv(t, t);
+    mpFp_mul(t, t, y);
+    error = mpFp_sqrt(y, t);
+    mpFp_clear(t);
+    mpFp_clear(x2);
+    mpFp_clear(c2);
+    return error;
+}
+
+static int _mpECP_solve_y_te(mpFp_t y, mpFp_t x, mpECurve_ptr cv) {
+    mpFp_t x2, t;
+    int error;
+    mpFp_init_fp(x2, cv->fp);
+    mpFp_init_fp(t, cv->fp);
+    // a * x**2 + y**2 = 1 + d * x**2 * y**2
+    // y**2 - d * x**2 * y**2 = 1 - a * x**2
+    // y**2 = (1 - a * x**2) / (1 - d * x**2)
+    mpFp_set(t, cv->coeff.te.d);
+    mpFp_pow_ui(x2, x, 2);
+    mpFp_mul(t, t, x2);
+    mpFp_set_ui_fp(y, 1, cv->fp);
+    mpFp_sub(t, y, t);
+    mpFp_mul(x2, x2, cv->coeff.te.a);
+    mpFp_sub(y, y, x2);
+    mpFp_inv(t, t);
+    mpFp_mul(t, t, y);
+    error = mpFp_sqrt(y, t);
+    mpFp_clear(t);
+    mpFp_clear(x2);
+    return error;
+}
+
+static int _mpECP_solve_y_mo(mpFp_t y, mpFp_t x, mpECurve_ptr cv) {
+    mpFp_t s, t;
+    int error;
+    mpFp_init_fp(s, cv->fp);
+    mpFp_init_fp(t, cv->fp);
+    // B * y**2 = x**3 + A * x**2 + x
+    mpFp_mul(s, x, x);
+    mpFp_mul(t, s, x);
+    mpFp_mul(s, s, cv->coeff.mo.A);
+    mpFp_add(s, s, t);
+    mpFp_add(s, s, x);
+    mpFp_mul(s, s, cv->coeff.mo.Binv);
+    error = mpFp_sqrt(y, s);
+    mpFp_clear(t);
+    mpFp_clear(s);
+    return error;
+}
+
 int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, int blen, mpECurve_t cv) {
     int bytes;
 
@@ -348,114 +510,20 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, int blen, mpECurve_t cv) {
         case 2:
         case 3: {
                 mpz_t xz;
-                mpFp_t x, y, t;
+                mpFp_t x, y;
                 int error, odd;
                 if (blen != (1 + bytes)) return -1;
                 mpz_init(xz);
                 mpFp_init_fp(x, cv->fp);
                 mpFp_init_fp(y, cv->fp);
-                mpFp_init_fp(t, cv->fp);
                 mpz_import(xz, bytes, 1, sizeof(unsigned char), 1, 0, &b[1]);
                 mpFp_set_mpz_fp(x, xz, cv->fp);
-                switch (cv->type) {
-                    case EQTypeShortWeierstrass: {
-                            // y**2 = x**3 + ax + b
-                            mpFp_mul(t, cv->coeff.ws.a, x);
-                            mpFp_add(y, cv->coeff.ws.b, t);
-                            mpFp_pow_ui(t, x, 3);
-                            mpFp_add(y, y, t);
-                            error = mpFp_sqrt(y, y);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
-                        }
-                        break;
-                    case EQTypeEdwards: {
-                            mpFp_t c2, x2;
-                            mpFp_init_fp(c2, cv->fp);
-                            mpFp_init_fp(x2, cv->fp);
-                            // x**2 + y**2 = c**2 (1 + d * x**2 * y**2)
-                            // y**2 - C**2 * d * x**2 * y**2 = c**2 - x**2
-                            // y**2 = (c**2 - x**2) / (1 - c**2 * d * x**2)
-                            mpFp_mul(c2, cv->coeff.ed.c, cv->coeff.ed.c);
-                            mpFp_mul(t, cv->coeff.ed.d, c2);
-                            mpFp_pow_ui(x2, x, 2);
-                            mpFp_mul(t, t, x2);
-                            mpFp_set_ui_fp(y, 1, cv->fp);
-                            mpFp_sub(t, y, t);
-                            mpFp_sub(y, c2, x2);
-                            mpFp_inv(t, t);
-                            mpFp_mul(t, t, y);
-                            error = mpFp_sqrt(y, t);
-                            mpFp_clear(x2);
-                            mpFp_clear(c2);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
-                        }
-                        break;
-                    case EQTypeTwistedEdwards: {
-                            mpFp_t a, x2;
-                            mpFp_init_fp(a, cv->fp);
-                            mpFp_init_fp(x2, cv->fp);
-                            // a * x**2 + y**2 = 1 + d * x**2 * y**2
-                            // y**2 - d * x**2 * y**2 = 1 - a * x**2
-                            // y**2 = (1 - a * x**2) / (1 - d * x**2)
-                            mpFp_set(a, cv->coeff.te.a);
-                            mpFp_set(t, cv->coeff.te.d);
-                            mpFp_pow_ui(x2, x, 2);
-                            mpFp_mul(t, t, x2);
-                            mpFp_set_ui_fp(y, 1, cv->fp);
-                            mpFp_sub(t, y, t);
-                            mpFp_mul(x2, x2, a);
-                            mpFp_sub(y, y, x2);
-                            mpFp_inv(t, t);
-                            mpFp_mul(t, t, y);
-                            error = mpFp_sqrt(y, t);
-                            mpFp_clear(x2);
-                            mpFp_clear(a);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
-                        }
-                        break;
-                    case EQTypeMontgomery: {
-                            int error;
-                            // B * y**2 = x**3 + A * x**2 + x
-                            mpFp_t s;
-                            mpFp_init_fp(s, cv->fp);
-                            mpFp_mul(s, x, x);
-                            mpFp_mul(t, s, x);
-                            mpFp_mul(s, s, cv->coeff.mo.A);
-                            mpFp_add(s, s, t);
-                            mpFp_add(s, s, x);
-                            mpFp_mul(s, s, cv->coeff.mo.Binv);
-                            error = mpFp_sqrt(y, s);
-                            mpFp_clear(s);
-                            if (error != 0) {
-                                mpFp_clear(t);
-                                mpFp_clear(y);
-                                mpFp_clear(x);
-                                mpz_clear(xz);
-                                return -1;
-                            }
-                        }
-                        break;
-                    default:
-                        assert(_known_curve_type(cv));
-                        return -1;
+                error = cv->ops->solve_y(y, x, cv);
+                if (error != 0) {
+                    mpFp_clear(y);
+                    mpFp_clear(x);
+                    mpz_clear(xz);
+                    return -1;
                 }
                 odd = mpz_tstbit(y->i, 0);
                 // '3' implies odd, '2' even... negate if not matched
@@ -463,7 +531,6 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, int blen, mpECurve_t cv) {
                     mpFp_neg(y, y);
                 }
                 mpECP_set_mpFp(rpt, x, y, cv);
-                mpFp_clear(t);
                 mpFp_clear(y);
                 mpFp_clear(x);
                 mpz_clear(xz);
@@ -475,6 +542,513 @@ int mpECP_set_bytes(mpECP_t rpt, unsigned char *b, int blen, mpECurve_t cv) {
     assert(0);
 }
 
+// points decoded per simultaneous inversion in mpECP_batch_set_bytes
+#define _MPECP_IMPORT_BATCH     (256)
+
+typedef struct {
+    mpECP_t *rpts;
+    int *status;
+    unsigned char *buf;
+    size_t stride;
+    int blen;
+    int lo;
+    int hi;
+    mpECurve_ptr cvp;
+    int nerr;
+} _mpECP_batch_import_t;
+
+// rhs = num / den of y**2 (compressed) for the curve equation at x
+static void _mpECP_import_rhs(mpFp_t num, mpFp_t den, mpFp_t x, mpECurve_ptr cvp) {
+    mpFp_t t;
+    mpFp_init_fp(t, cvp->fp);
+    switch (cvp->type) {
+        case EQTypeShortWeierstrass:
+            // y**2 = x**3 + ax + b
+            mpFp_sqr(t, x);
+            mpFp_add(t, t, cvp->coeff.ws.a);
+            mpFp_mul(t, t, x);
+            mpFp_add(num, t, cvp->coeff.ws.b);
+            mpFp_set_ui_fp(den, 1, cvp->fp);
+            break;
+        case EQTypeEdwards:
+            // y**2 = (c**2 - x**2) / (1 - c**2 * d * x**2)
+            mpFp_sqr(t, x);
+            mpFp_sqr(num, cvp->coeff.ed.c);
+            mpFp_mul(den, num, cvp->coeff.ed.d);
+            mpFp_sub(num, num, t);
+            mpFp_mul(den, den, t);
+            mpFp_neg(den, den);
+            mpFp_add_ui(den, den, 1);
+            break;
+        case EQTypeTwistedEdwards:
+            // y**2 = (1 - a * x**2) / (1 - d * x**2)
+            mpFp_sqr(t, x);
+            mpFp_mul(num, t, cvp->coeff.te.a);
+            mpFp_neg(num, num);
+            mpFp_add_ui(num, num, 1);
+            mpFp_mul(den, t, cvp->coeff.te.d);
+            mpFp_neg(den, den);
+            mpFp_add_ui(den, den, 1);
+            break;
+        case EQTypeMontgomery:
+            // B * y**2 = x**3 + A * x**2 + x
+            mpFp_add(t, x, cvp->coeff.mo.A);
+            mpFp_mul(t, t, x);
+            mpFp_add_ui(t, t, 1);
+            mpFp_mul(t, t, x);
+            mpFp_mul(num, t, cvp->coeff.mo.Binv);
+            mpFp_set_ui_fp(den, 1, cvp->fp);
+            break;
+        default:
+            assert(_known_curve_type(cvp));
+    }
+    mpFp_clear(t);
+    return;
+}
+
+// is (x, y) (affine, curve native coordinates) on the curve?
+static int _mpECP_import_on_curve(mpFp_t x, mpFp_t y, mpECurve_ptr cvp) {
+    int r;
+    mpFp_t num, den, y2;
+    mpFp_init_fp(num, cvp->fp);
+    mpFp_init_fp(den, cvp->fp);
+    mpFp_init_fp(y2, cvp->fp);
+    _mpECP_import_rhs(num, den, x, cvp);
+    // y**2 * den == num
+    mpFp_sqr(y2, y);
+    mpFp_mul(y2, y2, den);
+    r = (mpFp_cmp(y2, num) == 0);
+    mpFp_clear(y2);
+    mpFp_clear(den);
+    mpFp_clear(num);
+    return r;
+}
+
+// import a coordinate, rejecting values >= p (non-canonical encodings)
+static int _mpECP_import_coord(mpFp_t x, mpz_t t, unsigned char *b, int bytes, mpECurve_ptr cvp) {
+    mpz_import(t, bytes, 1, sizeof(unsigned char), 1, 0, b);
+    if (mpz_cmp(t, cvp->fp->p) >= 0) return -1;
+    mpFp_set_mpz_fp(x, t, cvp->fp);
+    return 0;
+}
+
+// decode and validate one encoding of blen bytes. Compressed points stop at
+// the curve equation so the caller can batch the inversion of den: x, num
+// and den (initialized by the caller) are set and 1 is returned. Otherwise
+// rpt is set and 0 is returned, or -1 if the encoding is invalid
+static int _mpECP_import_start(mpECP_t rpt, mpFp_t x, mpFp_t num, mpFp_t den,
+unsigned char *b, int blen, mpECurve_ptr cvp) {
+    int bytes, status;
+    mpz_t t;
+    mpFp_t y;
+
+    bytes = _bytelen(cvp->bits);
+    if (blen < (1 + bytes)) return -1;
+    status = -1;
+    mpz_init(t);
+    mpFp_init_fp(y, cvp->fp);
+    switch (b[0]) {
+        case 0:
+            mpECP_set_neutral(rpt, cvp);
+            status = 0;
+            break;
+        case 4:
+            if (blen != (1 + (2 * bytes))) break;
+            if ((_mpECP_import_coord(x, t, &b[1], bytes, cvp) == 0) &&
+                (_mpECP_import_coord(y, t, &b[1 + bytes], bytes, cvp) == 0) &&
+                (_mpECP_import_on_curve(x, y, cvp) != 0)) {
+                mpECP_set_mpFp(rpt, x, y, cvp);
+                status = 0;
+            }
+            break;
+        case 2:
+        case 3:
+            if (blen != (1 + bytes)) break;
+            if (_mpECP_import_coord(x, t, &b[1], bytes, cvp) != 0) break;
+            _mpECP_import_rhs(num, den, x, cvp);
+            if (mpFp_cmp_ui(den, 0) == 0) break;
+            status = 1;
+            break;
+        default:
+            break;
+    }
+    mpFp_clear(y);
+    mpz_clear(t);
+    return status;
+}
+
+// complete a compressed point from _mpECP_import_start, y2 = num / den and
+// b[0] selects the parity of y. Returns nonzero if y2 is not a square
+static int _mpECP_import_finish(mpECP_t rpt, mpFp_t x, mpFp_t y2,
+unsigned char *b, mpECurve_ptr cvp) {
+    mpFp_t y;
+    int status;
+    mpFp_init_fp(y, cvp->fp);
+    status = mpFp_sqrt(y, y2);
+    if (status == 0) {
+        // '3' implies odd, '2' even... negate if not matched
+        if ((b[0] & 0x01) != mpz_tstbit(y->i, 0)) {
+            mpFp_neg(y, y);
+        }
+        mpECP_set_mpFp(rpt, x, y, cvp);
+    }
+    mpFp_clear(y);
+    return status;
+}
+
+// single point decode with the validation of mpECP_batch_set_bytes
+static int _mpECP_import_point(mpECP_t rpt, unsigned char *b, int blen, mpECurve_ptr cvp) {
+    int status;
+    mpFp_t x, num, den;
+    mpFp_init_fp(x, cvp->fp);
+    mpFp_init_fp(num, cvp->fp);
+    mpFp_init_fp(den, cvp->fp);
+    status = _mpECP_import_start(rpt, x, num, den, b, blen, cvp);
+    if (status > 0) {
+        status = mpFp_inv(den, den);
+        assert(status == 0);
+        mpFp_mul(num, num, den);
+        status = _mpECP_import_finish(rpt, x, num, b, cvp);
+    }
+    mpFp_clear(den);
+    mpFp_clear(num);
+    mpFp_clear(x);
+    return (status == 0) ? 0 : -1;
+}
+
+static void _mpECP_batch_import_chunk(_mpECP_batch_import_t *ctx, int lo, int hi) {
+    int i, j, m, status;
+    int idx[_MPECP_IMPORT_BATCH];
+    unsigned char *b;
+    mpFp_t x[_MPECP_IMPORT_BATCH];
+    mpFp_t num[_MPECP_IMPORT_BATCH];
+    mpFp_t den[_MPECP_IMPORT_BATCH];
+    mpFp_t inv;
+    mpECurve_ptr cvp;
+
+    cvp = ctx->cvp;
+    mpFp_init_fp(inv, cvp->fp);
+    m = 0;
+    for (i = lo; i < hi; i++) {
+        b = ctx->buf + ((size_t)i * ctx->stride);
+        mpFp_init_fp(x[m], cvp->fp);
+        mpFp_init_fp(num[m], cvp->fp);
+        mpFp_init_fp(den[m], cvp->fp);
+        status = _mpECP_import_start(ctx->rpts[i], x[m], num[m], den[m], b, ctx->blen, cvp);
+        if (status > 0) {
+            // compressed, deferred to the batch inversion
+            ctx->status[i] = -1;
+            idx[m] = i;
+            m += 1;
+        } else {
+            ctx->status[i] = status;
+            mpFp_clear(den[m]);
+            mpFp_clear(num[m]);
+            mpFp_clear(x[m]);
+        }
+        if ((m < _MPECP_IMPORT_BATCH) && (i < (hi - 1))) continue;
+        if (m == 0) continue;
+
+        // den[j] <- 1 / den[j], simultaneous inversion (Montgomery's trick)
+        // with num[j] temporarily holding num[j] * den[0] * ... * den[j-1]
+        mpFp_set_ui_fp(inv, 1, cvp->fp);
+        for (j = 0; j < m; j++) {
+            mpFp_mul(num[j], num[j], inv);
+            mpFp_mul(inv, inv, den[j]);
+        }
+        status = mpFp_inv(inv, inv);
+        assert(status == 0);
+        for (j = m - 1; j >= 0; j--) {
+            // num[j] / den[j] = num[j] * den[0..j-1] / den[0..j]
+            mpFp_mul(num[j], num[j], inv);
+            mpFp_mul(inv, inv, den[j]);
+        }
+        for (j = 0; j < m; j++) {
+            b = ctx->buf + ((size_t)idx[j] * ctx->stride);
+            if (_mpECP_import_finish(ctx->rpts[idx[j]], x[j], num[j], b, cvp) == 0) {
+                ctx->status[idx[j]] = 0;
+            }
+            mpFp_clear(den[j]);
+            mpFp_clear(num[j]);
+            mpFp_clear(x[j]);
+        }
+        m = 0;
+    }
+    for (i = lo; i < hi; i++) {
+        if (ctx->status[i] != 0) ctx->nerr += 1;
+    }
+    mpFp_clear(inv);
+    return;
+}
+
+static void *_mpECP_batch_import_worker(void *arg) {
+    _mpECP_batch_import_t *ctx = (_mpECP_batch_import_t *)arg;
+    _mpECP_batch_import_chunk(ctx, ctx->lo, ctx->hi);
+    return NULL;
+}
+
+int mpECP_batch_set_bytes(mpECP_t *rpts, int *status, unsigned char *buf,
+size_t stride, int blen, int n, mpECurve_t cv, int nthreads) {
+    int i, nerr;
+    long ncpu;
+    pthread_t *th;
+    _mpECP_batch_import_t *ctx;
+
+    if (n <= 0) return 0;
+    if (nthreads <= 0) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpu > 0) ? (int)ncpu : 1;
+    }
+    // no point in threads for less than a few batches each
+    if (nthreads > (n / (4 * _MPECP_IMPORT_BATCH))) {
+        nthreads = n / (4 * _MPECP_IMPORT_BATCH);
+    }
+    if (nthreads < 1) nthreads = 1;
+    ctx = (_mpECP_batch_import_t *)malloc(nthreads * sizeof(_mpECP_batch_import_t));
+    assert(ctx != NULL);
+    for (i = 0; i < nthreads; i++) {
+        ctx[i].rpts = rpts;
+        ctx[i].status = status;
+        ctx[i].buf = buf;
+        ctx[i].stride = stride;
+        ctx[i].blen = blen;
+        ctx[i].lo = (int)(((int64_t)n * i) / nthreads);
+        ctx[i].hi = (int)(((int64_t)n * (i + 1)) / nthreads);
+        ctx[i].cvp = cv;
+        ctx[i].nerr = 0;
+    }
+    if (nthreads == 1) {
+        _mpECP_batch_import_worker(&ctx[0]);
+    } else {
+        th = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+        assert(th != NULL);
+        for (i = 0; i < nthreads; i++) {
+            nerr = pthread_create(&th[i], NULL, _mpECP_batch_import_worker, &ctx[i]);
+            assert(nerr == 0);
+        }
+        for (i = 0; i < nthreads; i++) {
+            pthread_join(th[i], NULL);
+        }
+        free(th);
+    }
+    nerr = 0;
+    for (i = 0; i < nthreads; i++) {
+        nerr += ctx[i].nerr;
+    }
+    free(ctx);
+    return nerr;
+}
+
+
+static void _mpECP_cache_entry_free(_mpECP_cache_entry_t *e) {
+    mpz_clear(e->z);
+    mpz_clear(e->y);
+    mpz_clear(e->x);
+    free(e->key);
+    free(e);
+    return;
+}
+
+#define _SIPROTL(x, b)  (((x) << (b)) | ((x) >> (64 - (b))))
+#define _SIPROUND(v0, v1, v2, v3) { \
+    v0 += v1; v1 = _SIPROTL(v1, 13); v1 ^= v0; v0 = _SIPROTL(v0, 32); \
+    v2 += v3; v3 = _SIPROTL(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = _SIPROTL(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = _SIPROTL(v1, 17); v1 ^= v2; v2 = _SIPROTL(v2, 32); }
+
+// SipHash-2-4 of buf with the 128 bit key k. Cache keys come from peers,
+// so the bucket hash is keyed to keep chains short for chosen inputs
+static uint64_t _mpECP_siphash(const uint64_t k[2], const unsigned char *buf, size_t len) {
+    uint64_t v0, v1, v2, v3, m;
+    size_t i, j, tail;
+
+    v0 = k[0] ^ 0x736f6d6570736575ULL;
+    v1 = k[1] ^ 0x646f72616e646f6dULL;
+    v2 = k[0] ^ 0x6c7967656e657261ULL;
+    v3 = k[1] ^ 0x7465646279746573ULL;
+    tail = len & 7;
+    for (i = 0; i < (len - tail); i += 8) {
+        m = 0;
+        for (j = 0; j < 8; j++) {
+            m |= ((uint64_t)buf[i + j]) << (8 * j);
+        }
+        v3 ^= m;
+        _SIPROUND(v0, v1, v2, v3);
+        _SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    m = ((uint64_t)len) << 56;
+    for (j = 0; j < tail; j++) {
+        m |= ((uint64_t)buf[i + j]) << (8 * j);
+    }
+    v3 ^= m;
+    _SIPROUND(v0, v1, v2, v3);
+    _SIPROUND(v0, v1, v2, v3);
+    v0 ^= m;
+    v2 ^= 0xff;
+    for (j = 0; j < 4; j++) {
+        _SIPROUND(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void mpECP_cache_init(mpECP_cache_t c, int capacity) {
+    mpz_t r, rmax;
+    assert(capacity > 0);
+    // random hash key, unknown to whoever supplies the encodings
+    mpz_init(r);
+    mpz_init(rmax);
+    mpz_setbit(rmax, 128);
+    mpz_sub_ui(rmax, rmax, 1);
+    mpz_urandom(r, rmax);
+    c->key[0] = 0;
+    c->key[1] = 0;
+    mpz_export(c->key, NULL, -1, sizeof(uint64_t), 0, 0, r);
+    mpz_clear(rmax);
+    mpz_clear(r);
+    c->capacity = capacity;
+    c->count = 0;
+    c->nbuckets = 16;
+    while (c->nbuckets < (2 * capacity)) c->nbuckets <<= 1;
+    c->buckets = (_mpECP_cache_entry_t **)calloc(c->nbuckets, sizeof(_mpECP_cache_entry_t *));
+    assert(c->buckets != NULL);
+    c->head = NULL;
+    c->tail = NULL;
+    c->hits = 0;
+    c->misses = 0;
+    pthread_mutex_init(&(c->lock), NULL);
+    return;
+}
+
+void mpECP_cache_clear(mpECP_cache_t c) {
+    _mpECP_cache_entry_t *e, *n;
+    for (e = c->head; e != NULL; e = n) {
+        n = e->next;
+        _mpECP_cache_entry_free(e);
+    }
+    free(c->buckets);
+    c->buckets = NULL;
+    c->head = NULL;
+    c->tail = NULL;
+    c->count = 0;
+    pthread_mutex_destroy(&(c->lock));
+    return;
+}
+
+void mpECP_cache_stats(mpECP_cache_t c, uint64_t *hits, uint64_t *misses) {
+    pthread_mutex_lock(&(c->lock));
+    *hits = c->hits;
+    *misses = c->misses;
+    pthread_mutex_unlock(&(c->lock));
+    return;
+}
+
+static void _mpECP_cache_unlink(mpECP_cache_t c, _mpECP_cache_entry_t *e) {
+    if (e->prev != NULL) {
+        e->prev->next = e->next;
+    } else {
+        c->head = e->next;
+    }
+    if (e->next != NULL) {
+        e->next->prev = e->prev;
+    } else {
+        c->tail = e->prev;
+    }
+    e->prev = NULL;
+    e->next = NULL;
+    return;
+}
+
+static void _mpECP_cache_push_head(mpECP_cache_t c, _mpECP_cache_entry_t *e) {
+    e->prev = NULL;
+    e->next = c->head;
+    if (c->head != NULL) c->head->prev = e;
+    c->head = e;
+    if (c->tail == NULL) c->tail = e;
+    return;
+}
+
+static _mpECP_cache_entry_t *_mpECP_cache_find(mpECP_cache_t c, uint64_t ch,
+uint64_t kh, unsigned char *b, int blen) {
+    _mpECP_cache_entry_t *e;
+    for (e = c->buckets[kh & (c->nbuckets - 1)]; e != NULL; e = e->hnext) {
+        if ((e->key_hash == kh) && (e->curve_hash == ch) && (e->keylen == blen) &&
+            (memcmp(e->key, b, blen) == 0)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+int mpECP_cache_set_bytes(mpECP_t rpt, mpECP_cache_t c, unsigned char *b, int blen, mpECurve_t cv) {
+    uint64_t ch, kh;
+    _mpECP_cache_entry_t *e, **pe;
+
+    if (blen <= 0) return -1;
+    ch = _mpECurve_hash(cv);
+    kh = _mpECP_siphash(c->key, b, blen) ^ ch;
+    pthread_mutex_lock(&(c->lock));
+    e = _mpECP_cache_find(c, ch, kh, b, blen);
+    if (e != NULL) {
+        c->hits += 1;
+        _mpECP_cache_unlink(c, e);
+        _mpECP_cache_push_head(c, e);
+        if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+        rpt->cvp = &cv[0];
+        rpt->is_neutral = e->is_neutral;
+        mpFp_set_mpz_fp(rpt->x, e->x, cv->fp);
+        mpFp_set_mpz_fp(rpt->y, e->y, cv->fp);
+        mpFp_set_mpz_fp(rpt->z, e->z, cv->fp);
+        pthread_mutex_unlock(&(c->lock));
+        return 0;
+    }
+    c->misses += 1;
+    pthread_mutex_unlock(&(c->lock));
+
+    // decode without holding the lock
+    if (_mpECP_import_point(rpt, b, blen, cv) != 0) return -1;
+
+    e = (_mpECP_cache_entry_t *)malloc(sizeof(_mpECP_cache_entry_t));
+    assert(e != NULL);
+    e->key = (unsigned char *)malloc(blen);
+    assert(e->key != NULL);
+    memcpy(e->key, b, blen);
+    e->keylen = blen;
+    e->curve_hash = ch;
+    e->key_hash = kh;
+    mpz_init(e->x);
+    mpz_init(e->y);
+    mpz_init(e->z);
+    mpz_set_mpFp(e->x, rpt->x);
+    mpz_set_mpFp(e->y, rpt->y);
+    mpz_set_mpFp(e->z, rpt->z);
+    e->is_neutral = rpt->is_neutral;
+
+    pthread_mutex_lock(&(c->lock));
+    if (_mpECP_cache_find(c, ch, kh, b, blen) != NULL) {
+        // inserted by another thread meanwhile
+        pthread_mutex_unlock(&(c->lock));
+        _mpECP_cache_entry_free(e);
+        return 0;
+    }
+    if (c->count >= c->capacity) {
+        // evict least recently used
+        _mpECP_cache_entry_t *t = c->tail;
+        _mpECP_cache_unlink(c, t);
+        for (pe = &(c->buckets[t->key_hash & (c->nbuckets - 1)]); *pe != t; pe = &((*pe)->hnext));
+        *pe = t->hnext;
+        c->count -= 1;
+        _mpECP_cache_entry_free(t);
+    }
+    pe = &(c->buckets[kh & (c->nbuckets - 1)]);
+    e->hnext = *pe;
+    *pe = e;
+    _mpECP_cache_push_head(c, e);
+    c->count += 1;
+    pthread_mutex_unlock(&(c->lock));
+    return 0;
+}
+
 int  mpECP_out_bytelen(mpECP_t pt, int compress) {
     int bytes;
     bytes = _bytelen(pt->cvp->bits);
@@ -532,31 +1106,20 @@ void mpECP_out_bytes(unsigned char *s, mpECP_t pt, int compress) {
         }
         return;
     }
+    mpz_t xz;
+    mpz_init(xz);
     if (compress != 0) {
-        mpz_t odd;
-        mpz_init(odd);
-        mpz_set_mpFp(odd, pt->y);
-        mpz_mod_ui(odd, odd, 2);
-        if (mpz_cmp_ui(odd, 1) == 0) {
+        // parity of y (as in mpECP_set_bytes)
+        mpz_set_mpFp(xz, pt->y);
+        if (mpz_tstbit(xz, 0) != 0) {
             s[0] = 3;
         } else {
             s[0] = 2;
         }
-        mpz_clear(odd);
     } else {
         s[0] = 4;
     }
-    mpz_t xz;
-    mpz_init(xz);
-    if (pt->cvp->type == EQTypeMontgomery) {
-        mpFp_t x;
-        mpFp_init_fp(x, pt->cvp->fp);
-        _transform_ws_to_mo_x(x, pt);
-        mpz_set_mpFp(xz, x);
-        mpFp_clear(x);
-    } else {
-        mpz_set_mpFp(xz, pt->x);
-    }
+    mpz_set_mpFp(xz, pt->x);
     mpz_export(&(s[1]), &blen, 1, sizeof(unsigned char), 1, 0, xz);
     assert(blen <= bytes);
     if (blen < bytes) {
@@ -576,15 +1139,7 @@ void mpECP_out_bytes(unsigned char *s, mpECP_t pt, int compress) {
         mpz_t yz;
 
         mpz_init(yz);
-        if (pt->cvp->type == EQTypeMontgomery) {
-            mpFp_t y;
-            mpFp_init_fp(y, pt->cvp->fp);
-            _transform_ws_to_mo_y(y, pt);
-            mpz_set_mpFp(yz, y);
-            mpFp_clear(y);
-        } else {
-            mpz_set_mpFp(yz, pt->y);
-        }
+        mpz_set_mpFp(yz, pt->y);
         mpz_export(&(s[1 + bytes]), &blen, 1, sizeof(unsigned char), 1, 0, yz);
         assert(blen <= bytes);
         if (blen < bytes) {
@@ -606,31 +1161,42 @@ void mpECP_out_bytes(unsigned char *s, mpECP_t pt, int compress) {
     return;
 }
 
+void mpECP_batch_out_bytes(unsigned char *buf, size_t stride, mpECP_t *pts, int n, int compress) {
+    int i;
+
+    if (n <= 0) return;
+    assert((n == 1) || (stride >= (size_t)mpECP_out_bytelen(pts[0], compress)));
+    // one inversion for all points, then mpECP_out_bytes has nothing to do
+    mpECP_batch_to_affine(pts, n);
+    for (i = 0; i < n; i++) {
+        mpECP_out_bytes(buf + (i * stride), pts[i], compress);
+    }
+    return;
+}
+
+static void _mpECP_neg_y(mpECP_t rpt, mpECP_t pt) {
+    mpECP_set(rpt, pt);
+    mpFp_neg(rpt->y, pt->y);
+    return;
+}
+
+static void _mpECP_neg_x(mpECP_t rpt, mpECP_t pt) {
+    mpECP_set(rpt, pt);
+    mpFp_neg(rpt->x, pt->x);
+    return;
+}
+
 void mpECP_neg(mpECP_t rpt, mpECP_t pt) {
     if (pt->is_neutral != 0) {
         mpECP_set_neutral(rpt, pt->cvp);
         return;
     }
-    switch (pt->cvp->type) {
-        case EQTypeMontgomery:
-            // Montgomery curve point internal representation is short-WS
-        case EQTypeShortWeierstrass:
-            mpECP_set(rpt, pt);
-            mpFp_neg(rpt->y, pt->y);
-            break;
-        case EQTypeEdwards:
-        case EQTypeTwistedEdwards:
-            mpECP_set(rpt, pt);
-            mpFp_neg(rpt->x, pt->x);
-            break;
-        default:
-            assert(_known_curve_type(pt->cvp));
-    }
+    pt->cvp->ops->neg(rpt, pt);
     return;
 }
 
 int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
-    if (mpECurve_cmp(pt1->cvp, pt2->cvp) != 0) return -1;
+    if (_mpECP_same_curve(pt1->cvp, pt2->cvp) == 0) return -1;
     if (pt1->is_neutral != 0) {
         if (pt2->is_neutral != 0) {
             return 0;
@@ -641,29 +1207,8 @@ int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
     }
     switch (pt1->cvp->type) {
         case EQTypeMontgomery:
-            // Montgomery curve point internal representation is short-WS
         case EQTypeShortWeierstrass:
-            // RCB uses projective coords, so fall through to same xform as Ed
-#ifndef _MPECP_USE_RCB
-            {
-                mpFp_t U1, U2;
-                mpFp_init_fp(U1, pt1->cvp->fp);
-                mpFp_init_fp(U2, pt1->cvp->fp);
-                mpFp_pow_ui(U1, pt2->z, 2);
-                mpFp_mul(U1, U1, pt1->x);
-                mpFp_pow_ui(U2, pt1->z, 2);
-                mpFp_mul(U2, U2, pt2->x);
-                if (mpFp_cmp(U1, U2) != 0) return -1;
-                mpFp_pow_ui(U1, pt2->z, 3);
-                mpFp_mul(U1, U1, pt1->y);
-                mpFp_pow_ui(U2, pt1->z, 3);
-                mpFp_mul(U2, U2, pt2->y);
-                if (mpFp_cmp(U1, U2) != 0) return -1;
-                mpFp_clear(U2);
-                mpFp_clear(U1);
-            }
-            break;
-#endif
+            // projective coords, so fall through to same xform as Ed
         case EQTypeEdwards:
         case EQTypeTwistedEdwards: {
                 mpFp_t U1, U2;
@@ -687,8 +1232,8 @@ int mpECP_cmp(mpECP_t pt1, mpECP_t pt2) {
 
 void mpECP_swap(mpECP_t pt2, mpECP_t pt1) {
     int t;
-    struct _p_mpECP_t *t_base_pt;
-    assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
+    _mpECP_base_table_t *t_base_tbl;
+    assert(_mpECP_same_curve(pt1->cvp, pt2->cvp));
     mpFp_cswap(pt2->x, pt1->x, 1);
     mpFp_cswap(pt2->y, pt1->y, 1);
     mpFp_cswap(pt2->z, pt1->z, 1);
@@ -698,9 +1243,9 @@ void mpECP_swap(mpECP_t pt2, mpECP_t pt1) {
     t = pt2->base_bits;
     pt2->base_bits = pt1->base_bits;
     pt1->base_bits = t;
-    t_base_pt = pt2->base_pt;
-    pt2->base_pt = pt1->base_pt;
-    pt1->base_pt = t_base_pt;
+    t_base_tbl = pt2->base_tbl;
+    pt2->base_tbl = pt1->base_tbl;
+    pt1->base_tbl = t_base_tbl;
     return;
 }
 
@@ -721,690 +1266,4309 @@ static void _mpECP_cswap_safe(mpECP_t pt2, mpECP_t pt1, int swap) {
 }
 
 void mpECP_cswap(mpECP_t pt2, mpECP_t pt1, int swap) {
-    assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
+    assert(_mpECP_same_curve(pt1->cvp, pt2->cvp));
     assert(pt1->base_bits == 0);
     assert(pt2->base_bits == 0);
     _mpECP_cswap_safe(pt2, pt1, swap);
 }
 
-void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
-#ifdef _MPECP_USE_RCB
-    mpFp_ptr aa, bb;
+// point arithmetic, selected per curve by _mpECP_curve_ops_select. The
+// formula functions below take non-neutral inputs (mpECP_add and friends
+// handle the neutral element) and rpt may alias either input
+
+// short Weierstrass
+static void _mpECP_add_ws(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr aa = pt1->cvp->ws_a;
+    mpFp_ptr b3 = pt1->cvp->ws_b3;
+
+    //assert(0); // might want to implement something here ;)
+    // 2015 Renes-Costello-Batina "Algorithm 1"
+    // from https://eprint.iacr.org/2015/1060.pdf
+    mpFp_t t0, t1, t2, t3, t4, t5;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
 #endif
-    assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
-    if (pt1->is_neutral != 0) {
-        if (pt2->is_neutral != 0) {
-            mpECP_set_neutral(rpt, pt1->cvp);
-            return;
-        } else {
-            mpECP_set(rpt, pt2);
-            return;
-        }
-    } else if (pt2->is_neutral != 0) {
-        mpECP_set(rpt, pt1);
-        return;
-    }
-    if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
-#ifdef _MPECP_USE_RCB
-    aa = pt1->cvp->coeff.ws.a;
-    bb = pt1->cvp->coeff.ws.b;
+
+    // 1. t0 <- X1 * X2
+    // 2. t1 <- Y1 * Y2
+    // 3. t2 <- Z1 * Z2
+    // 4. t3 <- X1 + Y1
+    // 5. t4 <- X2 + Y2
+    // 6. t3 <- t3 * t4
+    // 7. t4 <- t0 + t1
+    // 8. t3 <- t3 - t4
+    // 9. t4 <- X1 + Z1
+    //10. t5 <- X2 + Z2
+    //11. t4 <- t4 * t5
+    //12. t5 <- t0 + t2
+    //13. t4 <- t4 - t5
+    //14. t5 <- Y1 + Z1
+    //15. X3 <- Y2 + Z2
+    //16. t5 <- t5 * X3
+    //17. X3 <- t1 + t2
+    //18. t5 <- t5 - X3
+    //19. Z3 <-  a * t4
+    //20. X3 <- b3 * t2
+    //21. Z3 <- X3 + Z3
+    //22. X3 <- t1 - Z3
+    //23. Z3 <- t1 + Z3
+    //24. Y3 <- X3 * Z3
+    //25. t1 <- t0 + t0
+    //26. t1 <- t1 + t0
+    //27. t2 <-  a * t2
+    //28. t4 <- b3 * t4
+    //29. t1 <- t1 + t2
+    //30. t2 <- t0 - t2
+    //31. t2 <-  a * t2
+    //32. t4 <- t4 + t2
+    //33. t0 <- t1 * t4
+    //34. Y3 <- Y3 + t0
+    //35. t0 <- t5 * t4
+    //36. X3 <- t3 * X3
+    //37. X3 <- X3 - t0
+    //38. t0 <- t3 * t1
+    //39. Z3 <- t5 * Z3
+    //40. Z3 <- Z3 + t0
+
+    // 1. t0 <- X1 * X2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    // 2. t1 <- Y1 * Y2
+    mpFp_mul(t1, pt1->y, pt2->y);
+    // 3. t2 <- Z1 * Z2
+    mpFp_mul(t2, pt1->z, pt2->z);
+    // 4. t3 <- X1 + Y1
+    mpFp_add(t3, pt1->x, pt1->y);
+    // 5. t4 <- X2 + Y2
+    mpFp_add(t4, pt2->x, pt2->y);
+    // 6. t3 <- t3 * t4
+    mpFp_mul(t3, t3, t4);
+    // 7. t4 <- t0 + t1
+    mpFp_add(t4, t0, t1);
+    // 8. t3 <- t3 - t4
+    mpFp_sub(t3, t3, t4);
+    // 9. t4 <- X1 + Z1
+    mpFp_add(t4, pt1->x, pt1->z);
+    //10. t5 <- X2 + Z2
+    mpFp_add(t5, pt2->x, pt2->z);
+    //11. t4 <- t4 * t5
+    mpFp_mul(t4, t4, t5);
+    //12. t5 <- t0 + t2
+    mpFp_add(t5, t0, t2);
+    //13. t4 <- t4 - t5
+    mpFp_sub(t4, t4, t5);
+    //14. t5 <- Y1 + Z1
+    mpFp_add(t5, pt1->y, pt1->z);
+    //15. X3 <- Y2 + Z2
+    mpFp_add(rpt->x, pt2->y, pt2->z);
+    //16. t5 <- t5 * X3
+    mpFp_mul(t5, t5, rpt->x);
+    //17. X3 <- t1 + t2
+    mpFp_add(rpt->x, t1, t2);
+    //18. t5 <- t5 - X3
+    mpFp_sub(t5, t5, rpt->x);
+    //19. Z3 <-  a * t4
+    mpFp_mul(rpt->z, aa, t4);
+    //20. X3 <- b3 * t2
+    mpFp_mul(rpt->x, b3, t2);
+    //21. Z3 <- X3 + Z3
+    mpFp_add(rpt->z, rpt->x, rpt->z);
+    //22. X3 <- t1 - Z3
+    mpFp_sub(rpt->x, t1, rpt->z);
+    //23. Z3 <- t1 + Z3
+    mpFp_add(rpt->z, t1, rpt->z);
+    //24. Y3 <- X3 * Z3
+    mpFp_mul(rpt->y, rpt->x, rpt->z);
+    //25. t1 <- t0 + t0
+    mpFp_add(t1, t0, t0);
+    //26. t1 <- t1 + t0
+    mpFp_add(t1, t1, t0);
+    //27. t2 <-  a * t2
+    mpFp_mul(t2, aa, t2);
+    //28. t4 <- b3 * t4
+    mpFp_mul(t4, b3, t4);
+    //29. t1 <- t1 + t2
+    mpFp_add(t1, t1, t2);
+    //30. t2 <- t0 - t2
+    mpFp_sub(t2, t0, t2);
+    //31. t2 <-  a * t2
+    mpFp_mul(t2, aa, t2);
+    //32. t4 <- t4 + t2
+    mpFp_add(t4, t4, t2);
+    //33. t0 <- t1 * t4
+    mpFp_mul(t0, t1, t4);
+    //34. Y3 <- Y3 + t0
+    mpFp_add(rpt->y, rpt->y, t0);
+    //35. t0 <- t5 * t4
+    mpFp_mul(t0, t5, t4);
+    //36. X3 <- t3 * X3
+    mpFp_mul(rpt->x, t3, rpt->x);
+    //37. X3 <- X3 - t0
+    mpFp_sub(rpt->x, rpt->x, t0);
+    //38. t0 <- t3 * t1
+    mpFp_mul(t0, t3, t1);
+    //39. Z3 <- t5 * Z3
+    mpFp_mul(rpt->z, t5, rpt->z);
+    //40. Z3 <- Z3 + t0
+    mpFp_add(rpt->z, rpt->z, t0);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
 #endif
-    switch (pt1->cvp->type) {
-        case EQTypeMontgomery:
-            // Montgomery curve point internal representation is short-WS
-#ifdef _MPECP_USE_RCB
-            aa = pt1->cvp->coeff.mo.ws_a;
-            bb = pt1->cvp->coeff.mo.ws_b;
+    return;
+}
+
+static void _mpECP_add_ed(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    // 2007 Bernstein-Lange formula
+    // http://www.hyperelliptic.org/EFD/g1p/auto-edwards-projective.html#addition-add-2007-bl
+    // A = Z1*Z2
+    // B = A**2
+    // C = X1*X2
+    // D = Y1*Y2
+    // E = d*C*D
+    // F = B-E
+    // G = B+E
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    // Y3 = A*G*(D-C)
+    // Z3 = c*F*G
+    mpFp_t A, B, C, D, E, F, G;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lA, lB, lC, lD, lE, lF, lG;
+    A->i->_mp_d = lA; A->i->_mp_size = 0; A->i->_mp_alloc = _MPFP_MAX_LIMBS; A->fp = pt1->cvp->fp;
+    B->i->_mp_d = lB; B->i->_mp_size = 0; B->i->_mp_alloc = _MPFP_MAX_LIMBS; B->fp = pt1->cvp->fp;
+    C->i->_mp_d = lC; C->i->_mp_size = 0; C->i->_mp_alloc = _MPFP_MAX_LIMBS; C->fp = pt1->cvp->fp;
+    D->i->_mp_d = lD; D->i->_mp_size = 0; D->i->_mp_alloc = _MPFP_MAX_LIMBS; D->fp = pt1->cvp->fp;
+    E->i->_mp_d = lE; E->i->_mp_size = 0; E->i->_mp_alloc = _MPFP_MAX_LIMBS; E->fp = pt1->cvp->fp;
+    F->i->_mp_d = lF; F->i->_mp_size = 0; F->i->_mp_alloc = _MPFP_MAX_LIMBS; F->fp = pt1->cvp->fp;
+    G->i->_mp_d = lG; G->i->_mp_size = 0; G->i->_mp_alloc = _MPFP_MAX_LIMBS; G->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(A, pt1->cvp->fp);
+    mpFp_init_fp(B, pt1->cvp->fp);
+    mpFp_init_fp(C, pt1->cvp->fp);
+    mpFp_init_fp(D, pt1->cvp->fp);
+    mpFp_init_fp(E, pt1->cvp->fp);
+    mpFp_init_fp(F, pt1->cvp->fp);
+    mpFp_init_fp(G, pt1->cvp->fp);
+#endif
+
+    // A = Z1*Z2
+    mpFp_mul(A, pt1->z, pt2->z);
+    // B = A**2
+    mpFp_pow_ui(B, A, 2);
+    // C = X1*X2
+    mpFp_mul(C, pt1->x, pt2->x);
+    // D = Y1*Y2
+    mpFp_mul(D, pt1->y, pt2->y);
+    // E = d*C*D
+    mpFp_mul(E, pt1->cvp->coeff.ed.d, C);
+    mpFp_mul(E, E, D);
+    // F = B-E
+    mpFp_sub(F, B, E);
+    // G = B+E
+    mpFp_add(G, B, E);
+    // B, E used as temp below here
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    mpFp_add(B, pt1->x, pt1->y);
+    mpFp_add(E, pt2->x, pt2->y);
+    mpFp_mul(B, B, E);
+    mpFp_sub(B, B, C);
+    mpFp_sub(B, B, D);
+    mpFp_mul(B, B, F);
+    mpFp_mul(rpt->x, B, A);
+    // Y3 = A*G*(D-C)
+    mpFp_sub(B, D, C);
+    mpFp_mul(B, B, G);
+    mpFp_mul(rpt->y, B, A);
+    // Z3 = c*F*G
+    mpFp_mul(B, pt1->cvp->coeff.ed.c, G);
+    mpFp_mul(rpt->z, B, F);
+    rpt->cvp = pt1->cvp;
+    rpt->is_neutral = 0;
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(G);
+    mpFp_clear(F);
+    mpFp_clear(E);
+    mpFp_clear(D);
+    mpFp_clear(C);
+    mpFp_clear(B);
+    mpFp_clear(A);
 #endif
-        case EQTypeShortWeierstrass: {
-            // RCB uses projective coords, so fall through to same xform as Ed
-#ifdef _MPECP_USE_RCB
-                //assert(0); // might want to implement something here ;)
-                // 2015 Renes-Costello-Batina "Algorithm 1"
-                // from https://eprint.iacr.org/2015/1060.pdf
-                mpFp_t t0, t1, t2, t3, t4, t5, b3;
+    return;
+}
+
+static void _mpECP_add_te(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    // 2008 Bernstein–Birkner–Joye–Lange–Peters formula
+    // http://www.hyperelliptic.org/EFD/g1p/auto-twisted-projective.html#addition-add-2008-bbjlp
+    // A = Z1*Z2
+    // B = A**2
+    // C = X1*X2
+    // D = Y1*Y2
+    // E = d*C*D
+    // F = B-E
+    // G = B+E
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    // Y3 = A*G*(D-a*C)
+    // Z3 = F*G
+    mpFp_t A, B, C, D, E, F, G;
 #ifdef _MPECP_MPFP_NOMALLOC
-                __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5, lb3;
-                t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
-                t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
-                t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
-                t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
-                t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
-                t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
-                b3->i->_mp_d = lb3; b3->i->_mp_size = 0; b3->i->_mp_alloc = _MPFP_MAX_LIMBS; b3->fp = pt1->cvp->fp;
+    __local_limb_t lA, lB, lC, lD, lE, lF, lG;
+    A->i->_mp_d = lA; A->i->_mp_size = 0; A->i->_mp_alloc = _MPFP_MAX_LIMBS; A->fp = pt1->cvp->fp;
+    B->i->_mp_d = lB; B->i->_mp_size = 0; B->i->_mp_alloc = _MPFP_MAX_LIMBS; B->fp = pt1->cvp->fp;
+    C->i->_mp_d = lC; C->i->_mp_size = 0; C->i->_mp_alloc = _MPFP_MAX_LIMBS; C->fp = pt1->cvp->fp;
+    D->i->_mp_d = lD; D->i->_mp_size = 0; D->i->_mp_alloc = _MPFP_MAX_LIMBS; D->fp = pt1->cvp->fp;
+    E->i->_mp_d = lE; E->i->_mp_size = 0; E->i->_mp_alloc = _MPFP_MAX_LIMBS; E->fp = pt1->cvp->fp;
+    F->i->_mp_d = lF; F->i->_mp_size = 0; F->i->_mp_alloc = _MPFP_MAX_LIMBS; F->fp = pt1->cvp->fp;
+    G->i->_mp_d = lG; G->i->_mp_size = 0; G->i->_mp_alloc = _MPFP_MAX_LIMBS; G->fp = pt1->cvp->fp;
 #else
-                mpFp_init_fp(t0, pt1->cvp->fp);
-                mpFp_init_fp(t1, pt1->cvp->fp);
-                mpFp_init_fp(t2, pt1->cvp->fp);
-                mpFp_init_fp(t3, pt1->cvp->fp);
-                mpFp_init_fp(t4, pt1->cvp->fp);
-                mpFp_init_fp(t5, pt1->cvp->fp);
-                mpFp_init_fp(b3, pt1->cvp->fp);
+    mpFp_init_fp(A, pt1->cvp->fp);
+    mpFp_init_fp(B, pt1->cvp->fp);
+    mpFp_init_fp(C, pt1->cvp->fp);
+    mpFp_init_fp(D, pt1->cvp->fp);
+    mpFp_init_fp(E, pt1->cvp->fp);
+    mpFp_init_fp(F, pt1->cvp->fp);
+    mpFp_init_fp(G, pt1->cvp->fp);
 #endif
-                // TODO: Precalculate b3 and store in coeff.ws.b3
-                mpFp_add(b3, bb, bb);
-                mpFp_add(b3, b3, bb);
-
-                // 1. t0 <- X1 * X2
-                // 2. t1 <- Y1 * Y2
-                // 3. t2 <- Z1 * Z2
-                // 4. t3 <- X1 + Y1
-                // 5. t4 <- X2 + Y2
-                // 6. t3 <- t3 * t4
-                // 7. t4 <- t0 + t1
-                // 8. t3 <- t3 - t4
-                // 9. t4 <- X1 + Z1
-                //10. t5 <- X2 + Z2
-                //11. t4 <- t4 * t5
-                //12. t5 <- t0 + t2
-                //13. t4 <- t4 - t5
-                //14. t5 <- Y1 + Z1
-                //15. X3 <- Y2 + Z2
-                //16. t5 <- t5 * X3
-                //17. X3 <- t1 + t2
-                //18. t5 <- t5 - X3
-                //19. Z3 <-  a * t4
-                //20. X3 <- b3 * t2
-                //21. Z3 <- X3 + Z3
-                //22. X3 <- t1 - Z3
-                //23. Z3 <- t1 + Z3
-                //24. Y3 <- X3 * Z3
-                //25. t1 <- t0 + t0
-                //26. t1 <- t1 + t0
-                //27. t2 <-  a * t2
-                //28. t4 <- b3 * t4
-                //29. t1 <- t1 + t2
-                //30. t2 <- t0 - t2
-                //31. t2 <-  a * t2
-                //32. t4 <- t4 + t2
-                //33. t0 <- t1 * t4
-                //34. Y3 <- Y3 + t0
-                //35. t0 <- t5 * t4
-                //36. X3 <- t3 * X3
-                //37. X3 <- X3 - t0
-                //38. t0 <- t3 * t1
-                //39. Z3 <- t5 * Z3
-                //40. Z3 <- Z3 + t0
-
-                // 1. t0 <- X1 * X2
-                mpFp_mul(t0, pt1->x, pt2->x);
-                // 2. t1 <- Y1 * Y2
-                mpFp_mul(t1, pt1->y, pt2->y);
-                // 3. t2 <- Z1 * Z2
-                mpFp_mul(t2, pt1->z, pt2->z);
-                // 4. t3 <- X1 + Y1
-                mpFp_add(t3, pt1->x, pt1->y);
-                // 5. t4 <- X2 + Y2
-                mpFp_add(t4, pt2->x, pt2->y);
-                // 6. t3 <- t3 * t4
-                mpFp_mul(t3, t3, t4);
-                // 7. t4 <- t0 + t1
-                mpFp_add(t4, t0, t1);
-                // 8. t3 <- t3 - t4
-                mpFp_sub(t3, t3, t4);
-                // 9. t4 <- X1 + Z1
-                mpFp_add(t4, pt1->x, pt1->z);
-                //10. t5 <- X2 + Z2
-                mpFp_add(t5, pt2->x, pt2->z);
-                //11. t4 <- t4 * t5
-                mpFp_mul(t4, t4, t5);
-                //12. t5 <- t0 + t2
-                mpFp_add(t5, t0, t2);
-                //13. t4 <- t4 - t5
-                mpFp_sub(t4, t4, t5);
-                //14. t5 <- Y1 + Z1
-                mpFp_add(t5, pt1->y, pt1->z);
-                //15. X3 <- Y2 + Z2
-                mpFp_add(rpt->x, pt2->y, pt2->z);
-                //16. t5 <- t5 * X3
-                mpFp_mul(t5, t5, rpt->x);
-                //17. X3 <- t1 + t2
-                mpFp_add(rpt->x, t1, t2);
-                //18. t5 <- t5 - X3
-                mpFp_sub(t5, t5, rpt->x);
-                //19. Z3 <-  a * t4
-                mpFp_mul(rpt->z, aa, t4);
-                //20. X3 <- b3 * t2
-                mpFp_mul(rpt->x, b3, t2);
-                //21. Z3 <- X3 + Z3
-                mpFp_add(rpt->z, rpt->x, rpt->z);
-                //22. X3 <- t1 - Z3
-                mpFp_sub(rpt->x, t1, rpt->z);
-                //23. Z3 <- t1 + Z3
-                mpFp_add(rpt->z, t1, rpt->z);
-                //24. Y3 <- X3 * Z3
-                mpFp_mul(rpt->y, rpt->x, rpt->z);
-                //25. t1 <- t0 + t0
-                mpFp_add(t1, t0, t0);
-                //26. t1 <- t1 + t0
-                mpFp_add(t1, t1, t0);
-                //27. t2 <-  a * t2
-                mpFp_mul(t2, aa, t2);
-                //28. t4 <- b3 * t4
-                mpFp_mul(t4, b3, t4);
-                //29. t1 <- t1 + t2
-                mpFp_add(t1, t1, t2);
-                //30. t2 <- t0 - t2
-                mpFp_sub(t2, t0, t2);
-                //31. t2 <-  a * t2
-                mpFp_mul(t2, aa, t2);
-                //32. t4 <- t4 + t2
-                mpFp_add(t4, t4, t2);
-                //33. t0 <- t1 * t4
-                mpFp_mul(t0, t1, t4);
-                //34. Y3 <- Y3 + t0
-                mpFp_add(rpt->y, rpt->y, t0);
-                //35. t0 <- t5 * t4
-                mpFp_mul(t0, t5, t4);
-                //36. X3 <- t3 * X3
-                mpFp_mul(rpt->x, t3, rpt->x);
-                //37. X3 <- X3 - t0
-                mpFp_sub(rpt->x, rpt->x, t0);
-                //38. t0 <- t3 * t1
-                mpFp_mul(t0, t3, t1);
-                //39. Z3 <- t5 * Z3
-                mpFp_mul(rpt->z, t5, rpt->z);
-                //40. Z3 <- Z3 + t0
-                mpFp_add(rpt->z, rpt->z, t0);
-
-                rpt->cvp = pt1->cvp;
-
-                if (mpFp_cmp_ui(rpt->z, 0) == 0) {
-                    mpECP_set_neutral(rpt, pt1->cvp);
-                } else {
-                    rpt->is_neutral = 0;
-                }
 
-#ifndef _MPECP_MPFP_NOMALLOC
-                mpFp_clear(b3);
-                mpFp_clear(t5);
-                mpFp_clear(t4);
-                mpFp_clear(t3);
-                mpFp_clear(t2);
-                mpFp_clear(t1);
-                mpFp_clear(t0);
-#endif
-#else
-                // 2007 Bernstein-Lange formula
-                // from : http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian.html#addition-add-2007-bl
-                // Z1Z1 = Z1**2
-                // Z2Z2 = Z2**2
-                // U1 = X1*Z2Z2
-                // U2 = X2*Z1Z1
-                // S1 = Y1*Z2*Z2Z2
-                // S2 = Y2*Z1*Z1Z1
-                // H = U2-U1
-                // I = (2*H)**2
-                // J = H*I
-                // r = 2*(S2-S1) - use S2 as temp in place of r
-                // V = U1*I 
-                // X3 = r**2-J-2*V
-                // Y3 = r*(V-X3)-2*S1*J
-                // Z3 = ((Z1+Z2)**2-Z1Z1-Z2Z2)*H
-                mpFp_t Z1Z1, Z2Z2, U1, U2, S1, S2, H, I, J, V;
-                mpFp_init_fp(Z1Z1, pt1->cvp->fp);
-                mpFp_init_fp(Z2Z2, pt1->cvp->fp);
-                mpFp_init_fp(U1, pt1->cvp->fp);
-                mpFp_init_fp(U2, pt1->cvp->fp);
-                mpFp_init_fp(S1, pt1->cvp->fp);
-                mpFp_init_fp(S2, pt1->cvp->fp);
-                mpFp_init_fp(H, pt1->cvp->fp);
-                mpFp_init_fp(I, pt1->cvp->fp);
-                mpFp_init_fp(J, pt1->cvp->fp);
-                mpFp_init_fp(V, pt1->cvp->fp);
-                // Z1Z1 = Z1**2
-                mpFp_pow_ui(Z1Z1, pt1->z, 2);
-                // Z2Z2 = Z2**2
-                mpFp_pow_ui(Z2Z2, pt2->z, 2);
-                // U1 = X1*Z2Z2
-                mpFp_mul(U1, Z2Z2, pt1->x);
-                // U2 = X2*Z1Z1
-                mpFp_mul(U2, Z1Z1, pt2->x);
-                // S1 = Y1*Z2*Z2Z2
-                mpFp_mul(S1, pt2->z, Z2Z2);
-                mpFp_mul(S1, S1, pt1->y);
-                // S2 = Y2*Z1*Z1Z1
-                mpFp_mul(S2, pt1->z, Z1Z1);
-                mpFp_mul(S2, S2, pt2->y);
-                if (mpFp_cmp(U1, U2) == 0) {
-                    if (mpFp_cmp(S1, S2) == 0) {
-                        // pt1 == pt2, so use doubling formula
-                        mpECP_double(rpt, pt1);
-                    } else {
-                        // pt1 == -pt2 ? validate, return is_neutral
-                        mpFp_neg(I, S2);
-                        assert(mpFp_cmp(I, S1) == 0);
-                        mpECP_set_neutral(rpt, pt1->cvp);
-                    }
-                } else {
-                    // H = U2-U1
-                    mpFp_sub(H, U2, U1);
-                    // I = (2*H)**2
-                    mpFp_mul_ui(I, H, 2);
-                    mpFp_pow_ui(I, I, 2);
-                    // J = H*I
-                    mpFp_mul(J, H, I);
-                    // S2 is used as r below here
-                    // S2_r = 2*(S2-S1) - use S2 as temp in place of r
-                    mpFp_sub(S2, S2, S1);
-                    mpFp_mul_ui(S2, S2, 2);
-                    // V = U1*I 
-                    mpFp_mul(V, U1, I);
-                    // I, U2 is used as temp below here
-                    // X3 = S2_r**2-J-2*V
-                    mpFp_pow_ui(U2, S2, 2);
-                    mpFp_sub(U2, U2, J);
-                    mpFp_mul_ui(I, V, 2);
-                    mpFp_sub(rpt->x, U2, I);
-                    // Y3 = S2_r*(V-X3)-2*S1*J
-                    mpFp_sub(I, V, rpt->x);
-                    mpFp_mul(I, I, S2);
-                    mpFp_mul(S1, S1, J);
-                    mpFp_mul_ui(S1, S1, 2);
-                    mpFp_sub(rpt->y, I, S1);
-                    // Z3 = ((Z1+Z2)**2-Z1Z1-Z2Z2)*H
-                    mpFp_add(I, pt1->z, pt2->z);
-                    mpFp_pow_ui(I, I, 2);
-                    mpFp_sub(I, I, Z1Z1);
-                    mpFp_sub(I, I, Z2Z2);
-                    mpFp_mul(rpt->z, I, H);
-                    rpt->cvp = pt1->cvp;
-                    rpt->is_neutral = 0;
-                }
-                // done... clean up temporary variables
-                mpFp_clear(V);
-                mpFp_clear(J);
-                mpFp_clear(I);
-                mpFp_clear(H);
-                mpFp_clear(S2);
-                mpFp_clear(S1);
-                mpFp_clear(U2);
-                mpFp_clear(U1);
-                mpFp_clear(Z2Z2);
-                mpFp_clear(Z1Z1);
-#endif
-                return;
+    // A = Z1*Z2
+    mpFp_mul(A, pt1->z, pt2->z);
+    // B = A**2
+    mpFp_mul(B, A, A);
+    // C = X1*X2
+    mpFp_mul(C, pt1->x, pt2->x);
+    // D = Y1*Y2
+    mpFp_mul(D, pt1->y, pt2->y);
+    // E = d*C*D
+    mpFp_mul(E, pt1->cvp->coeff.te.d, C);
+    mpFp_mul(E, E, D);
+    // F = B-E
+    mpFp_sub(F, B, E);
+    // G = B+E
+    mpFp_add(G, B, E);
+    // B, E used as temp below here
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    mpFp_add(B, pt1->x, pt1->y);
+    mpFp_add(E, pt2->x, pt2->y);
+    mpFp_mul(B, B, E);
+    mpFp_sub(B, B, C);
+    mpFp_sub(B, B, D);
+    mpFp_mul(B, B, F);
+    mpFp_mul(rpt->x, B, A);
+    // Y3 = A*G*(D-a*C)
+    mpFp_mul(C, C, pt1->cvp->coeff.te.a);
+    mpFp_sub(B, D, C);
+    mpFp_mul(B, B, G);
+    mpFp_mul(rpt->y, B, A);
+    // Z3 = F*G
+    mpFp_mul(rpt->z, G, F);
+    rpt->cvp = pt1->cvp;
+    rpt->is_neutral = 0;
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(G);
+    mpFp_clear(F);
+    mpFp_clear(E);
+    mpFp_clear(D);
+    mpFp_clear(C);
+    mpFp_clear(B);
+    mpFp_clear(A);
+#endif
+    return;
+}
+
+static void _mpECP_dbl_ws(mpECP_t rpt, mpECP_t pt) {
+    // 2015 Renes-Costello-Batina "Algorithm 3"
+    // from https://eprint.iacr.org/2015/1060.pdf
+    // (Y*Z is computed up front so that rpt may alias pt)
+    mpFp_ptr aa = pt->cvp->ws_a;
+    mpFp_ptr b3 = pt->cvp->ws_b3;
+    mpFp_t t0, t1, t2, t3, t4;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt->cvp->fp);
+    mpFp_init_fp(t1, pt->cvp->fp);
+    mpFp_init_fp(t2, pt->cvp->fp);
+    mpFp_init_fp(t3, pt->cvp->fp);
+    mpFp_init_fp(t4, pt->cvp->fp);
+#endif
+
+    //25. t2 <- Y * Z (as t4)
+    mpFp_mul(t4, pt->y, pt->z);
+    // 1. t0 <- X * X
+    mpFp_sqr(t0, pt->x);
+    // 2. t1 <- Y * Y
+    mpFp_sqr(t1, pt->y);
+    // 3. t2 <- Z * Z
+    mpFp_sqr(t2, pt->z);
+    // 4. t3 <- X * Y
+    mpFp_mul(t3, pt->x, pt->y);
+    // 5. t3 <- t3 + t3
+    mpFp_add(t3, t3, t3);
+    // 6. Z3 <- X * Z
+    mpFp_mul(rpt->z, pt->x, pt->z);
+    // 7. Z3 <- Z3 + Z3
+    mpFp_add(rpt->z, rpt->z, rpt->z);
+    // 8. X3 <-  a * Z3
+    mpFp_mul(rpt->x, aa, rpt->z);
+    // 9. Y3 <- b3 * t2
+    mpFp_mul(rpt->y, b3, t2);
+    //10. Y3 <- X3 + Y3
+    mpFp_add(rpt->y, rpt->x, rpt->y);
+    //11. X3 <- t1 - Y3
+    mpFp_sub(rpt->x, t1, rpt->y);
+    //12. Y3 <- t1 + Y3
+    mpFp_add(rpt->y, t1, rpt->y);
+    //13. Y3 <- X3 * Y3
+    mpFp_mul(rpt->y, rpt->x, rpt->y);
+    //14. X3 <- t3 * X3
+    mpFp_mul(rpt->x, t3, rpt->x);
+    //15. Z3 <- b3 * Z3
+    mpFp_mul(rpt->z, b3, rpt->z);
+    //16. t2 <-  a * t2
+    mpFp_mul(t2, aa, t2);
+    //17. t3 <- t0 - t2
+    mpFp_sub(t3, t0, t2);
+    //18. t3 <-  a * t3
+    mpFp_mul(t3, aa, t3);
+    //19. t3 <- t3 + Z3
+    mpFp_add(t3, t3, rpt->z);
+    //20. Z3 <- t0 + t0
+    mpFp_add(rpt->z, t0, t0);
+    //21. t0 <- Z3 + t0
+    mpFp_add(t0, rpt->z, t0);
+    //22. t0 <- t0 + t2
+    mpFp_add(t0, t0, t2);
+    //23. t0 <- t0 * t3
+    mpFp_mul(t0, t0, t3);
+    //24. Y3 <- Y3 + t0
+    mpFp_add(rpt->y, rpt->y, t0);
+    //26. t2 <- t2 + t2
+    mpFp_add(t2, t4, t4);
+    //27. t0 <- t2 * t3
+    mpFp_mul(t0, t2, t3);
+    //28. X3 <- X3 - t0
+    mpFp_sub(rpt->x, rpt->x, t0);
+    //29. Z3 <- t2 * t1
+    mpFp_mul(rpt->z, t2, t1);
+    //30. Z3 <- Z3 + Z3
+    mpFp_add(rpt->z, rpt->z, rpt->z);
+    //31. Z3 <- Z3 + Z3
+    mpFp_add(rpt->z, rpt->z, rpt->z);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+static void _mpECP_dbl_ed(mpECP_t rpt, mpECP_t pt) {
+    // Edwards addition law is complete, so can use add for double
+    _mpECP_add_ed(rpt, pt, pt);
+    return;
+}
+
+static void _mpECP_dbl_te(mpECP_t rpt, mpECP_t pt) {
+    // Twisted Edwards addition law is complete, so can use add for double
+    _mpECP_add_te(rpt, pt, pt);
+    return;
+}
+
+static void _mpECP_add_mixed_ws(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr aa = pt1->cvp->ws_a;
+    mpFp_ptr b3 = pt1->cvp->ws_b3;
+
+    // 2015 Renes-Costello-Batina "Algorithm 2"
+    // from https://eprint.iacr.org/2015/1060.pdf
+    mpFp_t t0, t1, t2, t3, t4, t5;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
+#endif
+
+    // t2 holds Z1 so that rpt may alias pt1
+    mpFp_set(t2, pt1->z);
+    // 1. t0 <- X1 * X2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    // 2. t1 <- Y1 * Y2
+    mpFp_mul(t1, pt1->y, pt2->y);
+    // 3. t3 <- X2 + Y2
+    mpFp_add(t3, pt2->x, pt2->y);
+    // 4. t4 <- X1 + Y1
+    mpFp_add(t4, pt1->x, pt1->y);
+    // 5. t3 <- t3 * t4
+    mpFp_mul(t3, t3, t4);
+    // 6. t4 <- t0 + t1
+    mpFp_add(t4, t0, t1);
+    // 7. t3 <- t3 - t4
+    mpFp_sub(t3, t3, t4);
+    // 8. t4 <- X2 * Z1
+    mpFp_mul(t4, pt2->x, t2);
+    // 9. t4 <- t4 + X1
+    mpFp_add(t4, t4, pt1->x);
+    //10. t5 <- Y2 * Z1
+    mpFp_mul(t5, pt2->y, t2);
+    //11. t5 <- t5 + Y1
+    mpFp_add(t5, t5, pt1->y);
+    //12. Z3 <-  a * t4
+    mpFp_mul(rpt->z, aa, t4);
+    //13. X3 <- b3 * Z1
+    mpFp_mul(rpt->x, b3, t2);
+    //14. Z3 <- X3 + Z3
+    mpFp_add(rpt->z, rpt->x, rpt->z);
+    //15. X3 <- t1 - Z3
+    mpFp_sub(rpt->x, t1, rpt->z);
+    //16. Z3 <- t1 + Z3
+    mpFp_add(rpt->z, t1, rpt->z);
+    //17. Y3 <- X3 * Z3
+    mpFp_mul(rpt->y, rpt->x, rpt->z);
+    //18. t1 <- t0 + t0
+    mpFp_add(t1, t0, t0);
+    //19. t1 <- t1 + t0
+    mpFp_add(t1, t1, t0);
+    //20. t2 <-  a * Z1
+    mpFp_mul(t2, aa, t2);
+    //21. t4 <- b3 * t4
+    mpFp_mul(t4, b3, t4);
+    //22. t1 <- t1 + t2
+    mpFp_add(t1, t1, t2);
+    //23. t2 <- t0 - t2
+    mpFp_sub(t2, t0, t2);
+    //24. t2 <-  a * t2
+    mpFp_mul(t2, aa, t2);
+    //25. t4 <- t4 + t2
+    mpFp_add(t4, t4, t2);
+    //26. t0 <- t1 * t4
+    mpFp_mul(t0, t1, t4);
+    //27. Y3 <- Y3 + t0
+    mpFp_add(rpt->y, rpt->y, t0);
+    //28. t0 <- t5 * t4
+    mpFp_mul(t0, t5, t4);
+    //29. X3 <- t3 * X3
+    mpFp_mul(rpt->x, t3, rpt->x);
+    //30. X3 <- X3 - t0
+    mpFp_sub(rpt->x, rpt->x, t0);
+    //31. t0 <- t3 * t1
+    mpFp_mul(t0, t3, t1);
+    //32. Z3 <- t5 * Z3
+    mpFp_mul(rpt->z, t5, rpt->z);
+    //33. Z3 <- Z3 + t0
+    mpFp_add(rpt->z, rpt->z, t0);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+// add-2007-bl (Edwards) and add-2008-bbjlp (Twisted Edwards) with Z2 = 1,
+// i.e. A = Z1, saves one multiplication
+static void _mpECP_add_mixed_ed(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_t A, B, C, D, E, F, G;
+    mpFp_init_fp(A, pt1->cvp->fp);
+    mpFp_init_fp(B, pt1->cvp->fp);
+    mpFp_init_fp(C, pt1->cvp->fp);
+    mpFp_init_fp(D, pt1->cvp->fp);
+    mpFp_init_fp(E, pt1->cvp->fp);
+    mpFp_init_fp(F, pt1->cvp->fp);
+    mpFp_init_fp(G, pt1->cvp->fp);
+
+    // A = Z1
+    mpFp_set(A, pt1->z);
+    // B = A**2
+    mpFp_sqr(B, A);
+    // C = X1*X2
+    mpFp_mul(C, pt1->x, pt2->x);
+    // D = Y1*Y2
+    mpFp_mul(D, pt1->y, pt2->y);
+    // E = d*C*D
+    mpFp_mul(E, pt1->cvp->coeff.ed.d, C);
+    mpFp_mul(E, E, D);
+    // F = B-E
+    mpFp_sub(F, B, E);
+    // G = B+E
+    mpFp_add(G, B, E);
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    mpFp_add(B, pt1->x, pt1->y);
+    mpFp_add(E, pt2->x, pt2->y);
+    mpFp_mul(B, B, E);
+    mpFp_sub(B, B, C);
+    mpFp_sub(B, B, D);
+    mpFp_mul(B, B, F);
+    mpFp_mul(rpt->x, B, A);
+    // Y3 = A*G*(D-C)
+    mpFp_sub(B, D, C);
+    mpFp_mul(B, B, G);
+    mpFp_mul(rpt->y, B, A);
+    // Z3 = c*F*G
+    mpFp_mul(B, pt1->cvp->coeff.ed.c, G);
+    mpFp_mul(rpt->z, B, F);
+    rpt->cvp = pt1->cvp;
+    rpt->is_neutral = 0;
+
+    mpFp_clear(G);
+    mpFp_clear(F);
+    mpFp_clear(E);
+    mpFp_clear(D);
+    mpFp_clear(C);
+    mpFp_clear(B);
+    mpFp_clear(A);
+    return;
+}
+
+static void _mpECP_add_mixed_te(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_t A, B, C, D, E, F, G;
+    mpFp_init_fp(A, pt1->cvp->fp);
+    mpFp_init_fp(B, pt1->cvp->fp);
+    mpFp_init_fp(C, pt1->cvp->fp);
+    mpFp_init_fp(D, pt1->cvp->fp);
+    mpFp_init_fp(E, pt1->cvp->fp);
+    mpFp_init_fp(F, pt1->cvp->fp);
+    mpFp_init_fp(G, pt1->cvp->fp);
+
+    // A = Z1
+    mpFp_set(A, pt1->z);
+    // B = A**2
+    mpFp_sqr(B, A);
+    // C = X1*X2
+    mpFp_mul(C, pt1->x, pt2->x);
+    // D = Y1*Y2
+    mpFp_mul(D, pt1->y, pt2->y);
+    // E = d*C*D
+    mpFp_mul(E, pt1->cvp->coeff.te.d, C);
+    mpFp_mul(E, E, D);
+    // F = B-E
+    mpFp_sub(F, B, E);
+    // G = B+E
+    mpFp_add(G, B, E);
+    // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
+    mpFp_add(B, pt1->x, pt1->y);
+    mpFp_add(E, pt2->x, pt2->y);
+    mpFp_mul(B, B, E);
+    mpFp_sub(B, B, C);
+    mpFp_sub(B, B, D);
+    mpFp_mul(B, B, F);
+    mpFp_mul(rpt->x, B, A);
+    // Y3 = A*G*(D-a*C)
+    mpFp_mul(C, C, pt1->cvp->coeff.te.a);
+    mpFp_sub(B, D, C);
+    mpFp_mul(B, B, G);
+    mpFp_mul(rpt->y, B, A);
+    // Z3 = F*G
+    mpFp_mul(rpt->z, G, F);
+    rpt->cvp = pt1->cvp;
+    rpt->is_neutral = 0;
+
+    mpFp_clear(G);
+    mpFp_clear(F);
+    mpFp_clear(E);
+    mpFp_clear(D);
+    mpFp_clear(C);
+    mpFp_clear(B);
+    mpFp_clear(A);
+    return;
+}
+
+// short Weierstrass with a = 0 (e.g. secp256k1): 2015 Renes-Costello-Batina
+// Algorithms 7, 8 and 9, which drop the multiplications by a. Temporaries
+// are reordered (vs. the paper) so that all reads of the inputs precede the
+// writes to rpt
+
+static void _mpECP_add_ws_a0(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr b3 = pt1->cvp->ws_b3;
+    mpFp_t t0, t1, t2, t3, t4, t5;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
+#endif
+
+    // t0 <- X1 * X2, t1 <- Y1 * Y2, t2 <- Z1 * Z2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    mpFp_mul(t2, pt1->z, pt2->z);
+    // t3 <- (X1 + Y1) * (X2 + Y2) - t0 - t1 = X1*Y2 + X2*Y1
+    mpFp_add(t3, pt1->x, pt1->y);
+    mpFp_add(t4, pt2->x, pt2->y);
+    mpFp_mul(t3, t3, t4);
+    mpFp_add(t4, t0, t1);
+    mpFp_sub(t3, t3, t4);
+    // t4 <- (Y1 + Z1) * (Y2 + Z2) - t1 - t2 = Y1*Z2 + Y2*Z1
+    mpFp_add(t4, pt1->y, pt1->z);
+    mpFp_add(t5, pt2->y, pt2->z);
+    mpFp_mul(t4, t4, t5);
+    mpFp_add(t5, t1, t2);
+    mpFp_sub(t4, t4, t5);
+    // t5 <- (X1 + Z1) * (X2 + Z2) - t0 - t2 = X1*Z2 + X2*Z1
+    mpFp_add(t5, pt1->x, pt1->z);
+    mpFp_add(rpt->y, pt2->x, pt2->z);
+    mpFp_mul(t5, t5, rpt->y);
+    mpFp_add(rpt->y, t0, t2);
+    mpFp_sub(t5, t5, rpt->y);
+    // t0 <- 3 * t0
+    mpFp_add(rpt->x, t0, t0);
+    mpFp_add(t0, rpt->x, t0);
+    // t2 <- b3 * t2, Z3 <- t1 + t2, t1 <- t1 - t2
+    mpFp_mul(t2, b3, t2);
+    mpFp_add(rpt->z, t1, t2);
+    mpFp_sub(t1, t1, t2);
+    // X3 <- t3 * t1 - t4 * (b3 * t5)
+    mpFp_mul(t5, b3, t5);
+    mpFp_mul(rpt->x, t4, t5);
+    mpFp_mul(t2, t3, t1);
+    mpFp_sub(rpt->x, t2, rpt->x);
+    // Y3 <- t1 * Z3 + t0 * (b3 * t5)
+    mpFp_mul(rpt->y, t5, t0);
+    mpFp_mul(t1, t1, rpt->z);
+    mpFp_add(rpt->y, t1, rpt->y);
+    // Z3 <- Z3 * t4 + t0 * t3
+    mpFp_mul(t0, t0, t3);
+    mpFp_mul(rpt->z, rpt->z, t4);
+    mpFp_add(rpt->z, rpt->z, t0);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+static void _mpECP_add_mixed_ws_a0(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr b3 = pt1->cvp->ws_b3;
+    mpFp_t t0, t1, t2, t3, t4, t5;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
+#endif
+
+    // t0 <- X1 * X2, t1 <- Y1 * Y2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    // t3 <- (X1 + Y1) * (X2 + Y2) - t0 - t1 = X1*Y2 + X2*Y1
+    mpFp_add(t3, pt2->x, pt2->y);
+    mpFp_add(t4, pt1->x, pt1->y);
+    mpFp_mul(t3, t3, t4);
+    mpFp_add(t4, t0, t1);
+    mpFp_sub(t3, t3, t4);
+    // t4 <- Y2 * Z1 + Y1, t5 <- X2 * Z1 + X1
+    mpFp_mul(t4, pt2->y, pt1->z);
+    mpFp_add(t4, t4, pt1->y);
+    mpFp_mul(t5, pt2->x, pt1->z);
+    mpFp_add(t5, t5, pt1->x);
+    // t2 <- b3 * Z1
+    mpFp_mul(t2, b3, pt1->z);
+    // t0 <- 3 * t0
+    mpFp_add(rpt->x, t0, t0);
+    mpFp_add(t0, rpt->x, t0);
+    // Z3 <- t1 + t2, t1 <- t1 - t2
+    mpFp_add(rpt->z, t1, t2);
+    mpFp_sub(t1, t1, t2);
+    // X3 <- t3 * t1 - t4 * (b3 * t5)
+    mpFp_mul(t5, b3, t5);
+    mpFp_mul(rpt->x, t4, t5);
+    mpFp_mul(t2, t3, t1);
+    mpFp_sub(rpt->x, t2, rpt->x);
+    // Y3 <- t1 * Z3 + t0 * (b3 * t5)
+    mpFp_mul(rpt->y, t5, t0);
+    mpFp_mul(t1, t1, rpt->z);
+    mpFp_add(rpt->y, t1, rpt->y);
+    // Z3 <- Z3 * t4 + t0 * t3
+    mpFp_mul(t0, t0, t3);
+    mpFp_mul(rpt->z, rpt->z, t4);
+    mpFp_add(rpt->z, rpt->z, t0);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+static void _mpECP_dbl_ws_a0(mpECP_t rpt, mpECP_t pt) {
+    mpFp_ptr b3 = pt->cvp->ws_b3;
+    mpFp_t t0, t1, t2, t3, t4;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt->cvp->fp);
+    mpFp_init_fp(t1, pt->cvp->fp);
+    mpFp_init_fp(t2, pt->cvp->fp);
+    mpFp_init_fp(t3, pt->cvp->fp);
+    mpFp_init_fp(t4, pt->cvp->fp);
+#endif
+
+    // t0 <- Y * Y, t3 <- 8 * t0
+    mpFp_sqr(t0, pt->y);
+    mpFp_add(t3, t0, t0);
+    mpFp_add(t3, t3, t3);
+    mpFp_add(t3, t3, t3);
+    // t1 <- Y * Z, t4 <- X * Y
+    mpFp_mul(t1, pt->y, pt->z);
+    mpFp_mul(t4, pt->x, pt->y);
+    // t2 <- b3 * Z * Z
+    mpFp_sqr(t2, pt->z);
+    mpFp_mul(t2, b3, t2);
+    // X3 <- t2 * t3, Y3 <- t0 + t2, Z3 <- t1 * t3
+    mpFp_mul(rpt->x, t2, t3);
+    mpFp_add(rpt->y, t0, t2);
+    mpFp_mul(rpt->z, t1, t3);
+    // t0 <- t0 - 3 * t2
+    mpFp_add(t1, t2, t2);
+    mpFp_add(t2, t1, t2);
+    mpFp_sub(t0, t0, t2);
+    // Y3 <- t0 * Y3 + X3
+    mpFp_mul(rpt->y, t0, rpt->y);
+    mpFp_add(rpt->y, rpt->x, rpt->y);
+    // X3 <- 2 * t0 * t4
+    mpFp_mul(rpt->x, t0, t4);
+    mpFp_add(rpt->x, rpt->x, rpt->x);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+// short Weierstrass with a = -3 (e.g. P256, P384, brainpool t1 curves): 2015
+// Renes-Costello-Batina Algorithms 4, 5 and 6, which replace the
+// multiplications by a with additions. The result is formed in X3, Y3, Z3 so
+// that rpt may alias the inputs
+static void _mpECP_add_ws_a3(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr b = pt1->cvp->ws_b;
+    mpFp_t t0, t1, t2, t3, t4, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt1->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt1->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(X3, pt1->cvp->fp);
+    mpFp_init_fp(Y3, pt1->cvp->fp);
+    mpFp_init_fp(Z3, pt1->cvp->fp);
+#endif
+
+    // t0 <- X1 * X2, t1 <- Y1 * Y2, t2 <- Z1 * Z2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    mpFp_mul(t2, pt1->z, pt2->z);
+    // t3 <- (X1 + Y1) * (X2 + Y2) - t0 - t1
+    mpFp_add(t3, pt1->x, pt1->y);
+    mpFp_add(t4, pt2->x, pt2->y);
+    mpFp_mul(t3, t3, t4);
+    mpFp_add(t4, t0, t1);
+    mpFp_sub(t3, t3, t4);
+    // t4 <- (Y1 + Z1) * (Y2 + Z2) - t1 - t2
+    mpFp_add(t4, pt1->y, pt1->z);
+    mpFp_add(X3, pt2->y, pt2->z);
+    mpFp_mul(t4, t4, X3);
+    mpFp_add(X3, t1, t2);
+    mpFp_sub(t4, t4, X3);
+    // Y3 <- (X1 + Z1) * (X2 + Z2) - t0 - t2
+    mpFp_add(X3, pt1->x, pt1->z);
+    mpFp_add(Y3, pt2->x, pt2->z);
+    mpFp_mul(X3, X3, Y3);
+    mpFp_add(Y3, t0, t2);
+    mpFp_sub(Y3, X3, Y3);
+    // X3 <- 3 * (Y3 - b * t2), Z3 <- t1 - X3, X3 <- t1 + X3
+    mpFp_mul(Z3, b, t2);
+    mpFp_sub(X3, Y3, Z3);
+    mpFp_add(Z3, X3, X3);
+    mpFp_add(X3, X3, Z3);
+    mpFp_sub(Z3, t1, X3);
+    mpFp_add(X3, t1, X3);
+    // Y3 <- 3 * (b * Y3 - 3 * t2 - t0)
+    mpFp_mul(Y3, b, Y3);
+    mpFp_add(t1, t2, t2);
+    mpFp_add(t2, t1, t2);
+    mpFp_sub(Y3, Y3, t2);
+    mpFp_sub(Y3, Y3, t0);
+    mpFp_add(t1, Y3, Y3);
+    mpFp_add(Y3, t1, Y3);
+    // t0 <- 3 * t0 - t2
+    mpFp_add(t1, t0, t0);
+    mpFp_add(t0, t1, t0);
+    mpFp_sub(t0, t0, t2);
+    // X3 <- t3 * X3 - t4 * Y3, Y3 <- X3 * Z3 + t0 * Y3, Z3 <- t4 * Z3 + t3 * t0
+    mpFp_mul(t1, t4, Y3);
+    mpFp_mul(t2, t0, Y3);
+    mpFp_mul(Y3, X3, Z3);
+    mpFp_add(rpt->y, Y3, t2);
+    mpFp_mul(X3, t3, X3);
+    mpFp_sub(rpt->x, X3, t1);
+    mpFp_mul(Z3, t4, Z3);
+    mpFp_mul(t1, t3, t0);
+    mpFp_add(rpt->z, Z3, t1);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+static void _mpECP_add_mixed_ws_a3(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr b = pt1->cvp->ws_b;
+    mpFp_t t0, t1, t2, t3, t4, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt1->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt1->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(X3, pt1->cvp->fp);
+    mpFp_init_fp(Y3, pt1->cvp->fp);
+    mpFp_init_fp(Z3, pt1->cvp->fp);
+#endif
+
+    // t0 <- X1 * X2, t1 <- Y1 * Y2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    // t3 <- (X2 + Y2) * (X1 + Y1) - t0 - t1
+    mpFp_add(t3, pt2->x, pt2->y);
+    mpFp_add(t4, pt1->x, pt1->y);
+    mpFp_mul(t3, t3, t4);
+    mpFp_add(t4, t0, t1);
+    mpFp_sub(t3, t3, t4);
+    // t4 <- Y2 * Z1 + Y1, Y3 <- X2 * Z1 + X1
+    mpFp_mul(t4, pt2->y, pt1->z);
+    mpFp_add(t4, t4, pt1->y);
+    mpFp_mul(Y3, pt2->x, pt1->z);
+    mpFp_add(Y3, Y3, pt1->x);
+    // X3 <- 3 * (Y3 - b * Z1), Z3 <- t1 - X3, X3 <- t1 + X3
+    mpFp_mul(Z3, b, pt1->z);
+    mpFp_sub(X3, Y3, Z3);
+    mpFp_add(Z3, X3, X3);
+    mpFp_add(X3, X3, Z3);
+    mpFp_sub(Z3, t1, X3);
+    mpFp_add(X3, t1, X3);
+    // Y3 <- 3 * (b * Y3 - 3 * Z1 - t0)
+    mpFp_mul(Y3, b, Y3);
+    mpFp_add(t1, pt1->z, pt1->z);
+    mpFp_add(t2, t1, pt1->z);
+    mpFp_sub(Y3, Y3, t2);
+    mpFp_sub(Y3, Y3, t0);
+    mpFp_add(t1, Y3, Y3);
+    mpFp_add(Y3, t1, Y3);
+    // t0 <- 3 * t0 - t2
+    mpFp_add(t1, t0, t0);
+    mpFp_add(t0, t1, t0);
+    mpFp_sub(t0, t0, t2);
+    // X3 <- t3 * X3 - t4 * Y3, Y3 <- X3 * Z3 + t0 * Y3, Z3 <- t4 * Z3 + t3 * t0
+    mpFp_mul(t1, t4, Y3);
+    mpFp_mul(t2, t0, Y3);
+    mpFp_mul(Y3, X3, Z3);
+    mpFp_add(rpt->y, Y3, t2);
+    mpFp_mul(X3, t3, X3);
+    mpFp_sub(rpt->x, X3, t1);
+    mpFp_mul(Z3, t4, Z3);
+    mpFp_mul(t1, t3, t0);
+    mpFp_add(rpt->z, Z3, t1);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+static void _mpECP_dbl_ws_a3(mpECP_t rpt, mpECP_t pt) {
+    mpFp_ptr b = pt->cvp->ws_b;
+    mpFp_t t0, t1, t2, t3, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt->cvp->fp);
+    mpFp_init_fp(t1, pt->cvp->fp);
+    mpFp_init_fp(t2, pt->cvp->fp);
+    mpFp_init_fp(t3, pt->cvp->fp);
+    mpFp_init_fp(X3, pt->cvp->fp);
+    mpFp_init_fp(Y3, pt->cvp->fp);
+    mpFp_init_fp(Z3, pt->cvp->fp);
+#endif
+
+    // t0 <- X * X, t1 <- Y * Y, t2 <- Z * Z, t3 <- 2 * X * Y, Z3 <- 2 * X * Z
+    mpFp_sqr(t0, pt->x);
+    mpFp_sqr(t1, pt->y);
+    mpFp_sqr(t2, pt->z);
+    mpFp_mul(t3, pt->x, pt->y);
+    mpFp_add(t3, t3, t3);
+    mpFp_mul(Z3, pt->x, pt->z);
+    mpFp_add(Z3, Z3, Z3);
+    // Y3 <- 3 * (b * t2 - Z3), X3 <- t1 - Y3, Y3 <- t1 + Y3
+    mpFp_mul(Y3, b, t2);
+    mpFp_sub(Y3, Y3, Z3);
+    mpFp_add(X3, Y3, Y3);
+    mpFp_add(Y3, X3, Y3);
+    mpFp_sub(X3, t1, Y3);
+    mpFp_add(Y3, t1, Y3);
+    // Y3 <- X3 * Y3, X3 <- X3 * t3
+    mpFp_mul(Y3, X3, Y3);
+    mpFp_mul(X3, X3, t3);
+    // Z3 <- 3 * (b * Z3 - 3 * t2 - t0)
+    mpFp_add(t3, t2, t2);
+    mpFp_add(t2, t2, t3);
+    mpFp_mul(Z3, b, Z3);
+    mpFp_sub(Z3, Z3, t2);
+    mpFp_sub(Z3, Z3, t0);
+    mpFp_add(t3, Z3, Z3);
+    mpFp_add(Z3, Z3, t3);
+    // Y3 <- Y3 + (3 * t0 - t2) * Z3
+    mpFp_add(t3, t0, t0);
+    mpFp_add(t0, t3, t0);
+    mpFp_sub(t0, t0, t2);
+    mpFp_mul(t0, t0, Z3);
+    mpFp_add(Y3, Y3, t0);
+    // t0 <- 2 * Y * Z, X3 <- X3 - t0 * Z3, Z3 <- 4 * t0 * t1
+    mpFp_mul(t0, pt->y, pt->z);
+    mpFp_add(t0, t0, t0);
+    mpFp_mul(Z3, t0, Z3);
+    mpFp_sub(rpt->x, X3, Z3);
+    mpFp_set(rpt->y, Y3);
+    mpFp_mul(Z3, t0, t1);
+    mpFp_add(Z3, Z3, Z3);
+    mpFp_add(rpt->z, Z3, Z3);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+// Jacobian coordinates x = X/Z**2, y = Y/Z**3 (Bernstein-Lange formulas from
+// http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian.html). These are
+// NOT complete, pt1 == +/-pt2 and points of order 2 are handled by branching,
+// so they are only used for public data (variable time) paths, which convert
+// to and from projective coordinates with _mpECP_proj_to_jac/_jac_to_proj
+
+// (X : Y : Z) projective -> (XZ : YZ**2 : Z) Jacobian
+static void _mpECP_proj_to_jac(mpECP_t pt) {
+    mpFp_t t;
+    if (pt->is_neutral != 0) return;
+    if (mpFp_cmp_ui(pt->z, 1) == 0) return;
+    mpFp_init_fp(t, pt->cvp->fp);
+    mpFp_mul(pt->x, pt->x, pt->z);
+    mpFp_sqr(t, pt->z);
+    mpFp_mul(pt->y, pt->y, t);
+    mpFp_clear(t);
+    return;
+}
+
+// (X : Y : Z) Jacobian -> (XZ : Y : Z**3) projective
+static void _mpECP_jac_to_proj(mpECP_t pt) {
+    mpFp_t t;
+    if (pt->is_neutral != 0) return;
+    if (mpFp_cmp_ui(pt->z, 1) == 0) return;
+    mpFp_init_fp(t, pt->cvp->fp);
+    mpFp_mul(pt->x, pt->x, pt->z);
+    mpFp_sqr(t, pt->z);
+    mpFp_mul(pt->z, pt->z, t);
+    mpFp_clear(t);
+    return;
+}
+
+// dbl-2007-bl, any a
+static void _mpECP_dbl_ws_jac(mpECP_t rpt, mpECP_t pt) {
+    mpFp_t XX, YY, YYYY, ZZ, S, M, T;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lXX, lYY, lYYYY, lZZ, lS, lM, lT;
+    XX->i->_mp_d = lXX; XX->i->_mp_size = 0; XX->i->_mp_alloc = _MPFP_MAX_LIMBS; XX->fp = pt->cvp->fp;
+    YY->i->_mp_d = lYY; YY->i->_mp_size = 0; YY->i->_mp_alloc = _MPFP_MAX_LIMBS; YY->fp = pt->cvp->fp;
+    YYYY->i->_mp_d = lYYYY; YYYY->i->_mp_size = 0; YYYY->i->_mp_alloc = _MPFP_MAX_LIMBS; YYYY->fp = pt->cvp->fp;
+    ZZ->i->_mp_d = lZZ; ZZ->i->_mp_size = 0; ZZ->i->_mp_alloc = _MPFP_MAX_LIMBS; ZZ->fp = pt->cvp->fp;
+    S->i->_mp_d = lS; S->i->_mp_size = 0; S->i->_mp_alloc = _MPFP_MAX_LIMBS; S->fp = pt->cvp->fp;
+    M->i->_mp_d = lM; M->i->_mp_size = 0; M->i->_mp_alloc = _MPFP_MAX_LIMBS; M->fp = pt->cvp->fp;
+    T->i->_mp_d = lT; T->i->_mp_size = 0; T->i->_mp_alloc = _MPFP_MAX_LIMBS; T->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(XX, pt->cvp->fp);
+    mpFp_init_fp(YY, pt->cvp->fp);
+    mpFp_init_fp(YYYY, pt->cvp->fp);
+    mpFp_init_fp(ZZ, pt->cvp->fp);
+    mpFp_init_fp(S, pt->cvp->fp);
+    mpFp_init_fp(M, pt->cvp->fp);
+    mpFp_init_fp(T, pt->cvp->fp);
+#endif
+
+    // XX = X1**2, YY = Y1**2, YYYY = YY**2, ZZ = Z1**2
+    mpFp_sqr(XX, pt->x);
+    mpFp_sqr(YY, pt->y);
+    mpFp_sqr(YYYY, YY);
+    mpFp_sqr(ZZ, pt->z);
+    // S = 2*((X1+YY)**2-XX-YYYY)
+    mpFp_add(S, pt->x, YY);
+    mpFp_sqr(S, S);
+    mpFp_sub(S, S, XX);
+    mpFp_sub(S, S, YYYY);
+    mpFp_add(S, S, S);
+    // M = 3*XX+a*ZZ**2
+    mpFp_sqr(M, ZZ);
+    mpFp_mul(M, M, pt->cvp->ws_a);
+    mpFp_add(M, M, XX);
+    mpFp_add(XX, XX, XX);
+    mpFp_add(M, M, XX);
+    // Z3 = (Y1+Z1)**2-YY-ZZ
+    mpFp_add(T, pt->y, pt->z);
+    mpFp_sqr(T, T);
+    mpFp_sub(T, T, YY);
+    mpFp_sub(rpt->z, T, ZZ);
+    // X3 = T = M**2-2*S
+    mpFp_sqr(T, M);
+    mpFp_sub(T, T, S);
+    mpFp_sub(T, T, S);
+    // Y3 = M*(S-T)-8*YYYY
+    mpFp_sub(S, S, T);
+    mpFp_mul(S, M, S);
+    mpFp_add(YYYY, YYYY, YYYY);
+    mpFp_add(YYYY, YYYY, YYYY);
+    mpFp_add(YYYY, YYYY, YYYY);
+    mpFp_sub(rpt->y, S, YYYY);
+    mpFp_set(rpt->x, T);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(T);
+    mpFp_clear(M);
+    mpFp_clear(S);
+    mpFp_clear(ZZ);
+    mpFp_clear(YYYY);
+    mpFp_clear(YY);
+    mpFp_clear(XX);
+#endif
+    return;
+}
+
+// dbl-2009-l, a = 0
+static void _mpECP_dbl_ws_jac_a0(mpECP_t rpt, mpECP_t pt) {
+    mpFp_t A, B, C, D, E;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lA, lB, lC, lD, lE;
+    A->i->_mp_d = lA; A->i->_mp_size = 0; A->i->_mp_alloc = _MPFP_MAX_LIMBS; A->fp = pt->cvp->fp;
+    B->i->_mp_d = lB; B->i->_mp_size = 0; B->i->_mp_alloc = _MPFP_MAX_LIMBS; B->fp = pt->cvp->fp;
+    C->i->_mp_d = lC; C->i->_mp_size = 0; C->i->_mp_alloc = _MPFP_MAX_LIMBS; C->fp = pt->cvp->fp;
+    D->i->_mp_d = lD; D->i->_mp_size = 0; D->i->_mp_alloc = _MPFP_MAX_LIMBS; D->fp = pt->cvp->fp;
+    E->i->_mp_d = lE; E->i->_mp_size = 0; E->i->_mp_alloc = _MPFP_MAX_LIMBS; E->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(A, pt->cvp->fp);
+    mpFp_init_fp(B, pt->cvp->fp);
+    mpFp_init_fp(C, pt->cvp->fp);
+    mpFp_init_fp(D, pt->cvp->fp);
+    mpFp_init_fp(E, pt->cvp->fp);
+#endif
+
+    // A = X1**2, B = Y1**2, C = B**2
+    mpFp_sqr(A, pt->x);
+    mpFp_sqr(B, pt->y);
+    mpFp_sqr(C, B);
+    // D = 2*((X1+B)**2-A-C)
+    mpFp_add(D, pt->x, B);
+    mpFp_sqr(D, D);
+    mpFp_sub(D, D, A);
+    mpFp_sub(D, D, C);
+    mpFp_add(D, D, D);
+    // E = 3*A
+    mpFp_add(E, A, A);
+    mpFp_add(E, E, A);
+    // Z3 = 2*Y1*Z1
+    mpFp_mul(B, pt->y, pt->z);
+    mpFp_add(rpt->z, B, B);
+    // X3 = E**2-2*D
+    mpFp_sqr(A, E);
+    mpFp_sub(A, A, D);
+    mpFp_sub(A, A, D);
+    // Y3 = E*(D-X3)-8*C
+    mpFp_sub(D, D, A);
+    mpFp_mul(D, E, D);
+    mpFp_add(C, C, C);
+    mpFp_add(C, C, C);
+    mpFp_add(C, C, C);
+    mpFp_sub(rpt->y, D, C);
+    mpFp_set(rpt->x, A);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(E);
+    mpFp_clear(D);
+    mpFp_clear(C);
+    mpFp_clear(B);
+    mpFp_clear(A);
+#endif
+    return;
+}
+
+// dbl-2001-b, a = -3
+static void _mpECP_dbl_ws_jac_a3(mpECP_t rpt, mpECP_t pt) {
+    mpFp_t delta, gamma, beta, alpha, t;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t ldelta, lgamma, lbeta, lalpha, lt;
+    delta->i->_mp_d = ldelta; delta->i->_mp_size = 0; delta->i->_mp_alloc = _MPFP_MAX_LIMBS; delta->fp = pt->cvp->fp;
+    gamma->i->_mp_d = lgamma; gamma->i->_mp_size = 0; gamma->i->_mp_alloc = _MPFP_MAX_LIMBS; gamma->fp = pt->cvp->fp;
+    beta->i->_mp_d = lbeta; beta->i->_mp_size = 0; beta->i->_mp_alloc = _MPFP_MAX_LIMBS; beta->fp = pt->cvp->fp;
+    alpha->i->_mp_d = lalpha; alpha->i->_mp_size = 0; alpha->i->_mp_alloc = _MPFP_MAX_LIMBS; alpha->fp = pt->cvp->fp;
+    t->i->_mp_d = lt; t->i->_mp_size = 0; t->i->_mp_alloc = _MPFP_MAX_LIMBS; t->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(delta, pt->cvp->fp);
+    mpFp_init_fp(gamma, pt->cvp->fp);
+    mpFp_init_fp(beta, pt->cvp->fp);
+    mpFp_init_fp(alpha, pt->cvp->fp);
+    mpFp_init_fp(t, pt->cvp->fp);
+#endif
+
+    // delta = Z1**2, gamma = Y1**2, beta = X1*gamma
+    mpFp_sqr(delta, pt->z);
+    mpFp_sqr(gamma, pt->y);
+    mpFp_mul(beta, pt->x, gamma);
+    // alpha = 3*(X1-delta)*(X1+delta)
+    mpFp_sub(alpha, pt->x, delta);
+    mpFp_add(t, pt->x, delta);
+    mpFp_mul(alpha, alpha, t);
+    mpFp_add(t, alpha, alpha);
+    mpFp_add(alpha, alpha, t);
+    // Z3 = (Y1+Z1)**2-gamma-delta
+    mpFp_add(t, pt->y, pt->z);
+    mpFp_sqr(t, t);
+    mpFp_sub(t, t, gamma);
+    mpFp_sub(rpt->z, t, delta);
+    // X3 = alpha**2-8*beta
+    mpFp_add(beta, beta, beta);
+    mpFp_add(beta, beta, beta);
+    mpFp_sqr(t, alpha);
+    mpFp_sub(t, t, beta);
+    mpFp_sub(rpt->x, t, beta);
+    // Y3 = alpha*(4*beta-X3)-8*gamma**2
+    mpFp_sub(beta, beta, rpt->x);
+    mpFp_mul(beta, alpha, beta);
+    mpFp_sqr(gamma, gamma);
+    mpFp_add(gamma, gamma, gamma);
+    mpFp_add(gamma, gamma, gamma);
+    mpFp_add(gamma, gamma, gamma);
+    mpFp_sub(rpt->y, beta, gamma);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(t);
+    mpFp_clear(alpha);
+    mpFp_clear(beta);
+    mpFp_clear(gamma);
+    mpFp_clear(delta);
+#endif
+    return;
+}
+
+// add-2007-bl
+static void _mpECP_add_ws_jac(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_t Z1Z1, Z2Z2, U1, U2, S1, S2, I, J;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lZ1Z1, lZ2Z2, lU1, lU2, lS1, lS2, lI, lJ;
+    Z1Z1->i->_mp_d = lZ1Z1; Z1Z1->i->_mp_size = 0; Z1Z1->i->_mp_alloc = _MPFP_MAX_LIMBS; Z1Z1->fp = pt1->cvp->fp;
+    Z2Z2->i->_mp_d = lZ2Z2; Z2Z2->i->_mp_size = 0; Z2Z2->i->_mp_alloc = _MPFP_MAX_LIMBS; Z2Z2->fp = pt1->cvp->fp;
+    U1->i->_mp_d = lU1; U1->i->_mp_size = 0; U1->i->_mp_alloc = _MPFP_MAX_LIMBS; U1->fp = pt1->cvp->fp;
+    U2->i->_mp_d = lU2; U2->i->_mp_size = 0; U2->i->_mp_alloc = _MPFP_MAX_LIMBS; U2->fp = pt1->cvp->fp;
+    S1->i->_mp_d = lS1; S1->i->_mp_size = 0; S1->i->_mp_alloc = _MPFP_MAX_LIMBS; S1->fp = pt1->cvp->fp;
+    S2->i->_mp_d = lS2; S2->i->_mp_size = 0; S2->i->_mp_alloc = _MPFP_MAX_LIMBS; S2->fp = pt1->cvp->fp;
+    I->i->_mp_d = lI; I->i->_mp_size = 0; I->i->_mp_alloc = _MPFP_MAX_LIMBS; I->fp = pt1->cvp->fp;
+    J->i->_mp_d = lJ; J->i->_mp_size = 0; J->i->_mp_alloc = _MPFP_MAX_LIMBS; J->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(Z1Z1, pt1->cvp->fp);
+    mpFp_init_fp(Z2Z2, pt1->cvp->fp);
+    mpFp_init_fp(U1, pt1->cvp->fp);
+    mpFp_init_fp(U2, pt1->cvp->fp);
+    mpFp_init_fp(S1, pt1->cvp->fp);
+    mpFp_init_fp(S2, pt1->cvp->fp);
+    mpFp_init_fp(I, pt1->cvp->fp);
+    mpFp_init_fp(J, pt1->cvp->fp);
+#endif
+
+    // Z1Z1 = Z1**2, Z2Z2 = Z2**2, U1 = X1*Z2Z2, U2 = X2*Z1Z1
+    mpFp_sqr(Z1Z1, pt1->z);
+    mpFp_sqr(Z2Z2, pt2->z);
+    mpFp_mul(U1, pt1->x, Z2Z2);
+    mpFp_mul(U2, pt2->x, Z1Z1);
+    // S1 = Y1*Z2*Z2Z2, S2 = Y2*Z1*Z1Z1
+    mpFp_mul(S1, pt2->z, Z2Z2);
+    mpFp_mul(S1, S1, pt1->y);
+    mpFp_mul(S2, pt1->z, Z1Z1);
+    mpFp_mul(S2, S2, pt2->y);
+    // H = U2-U1 (as U2), r = 2*(S2-S1) (as S2)
+    mpFp_sub(U2, U2, U1);
+    mpFp_sub(S2, S2, S1);
+    if (mpFp_cmp_ui(U2, 0) == 0) {
+        if (mpFp_cmp_ui(S2, 0) == 0) {
+            _mpECP_dbl_ws_jac(rpt, pt1);
+        } else {
+            mpECP_set_neutral(rpt, pt1->cvp);
+        }
+    } else {
+        mpFp_add(S2, S2, S2);
+        // Z3 = ((Z1+Z2)**2-Z1Z1-Z2Z2)*H
+        mpFp_add(I, pt1->z, pt2->z);
+        mpFp_sqr(I, I);
+        mpFp_sub(I, I, Z1Z1);
+        mpFp_sub(I, I, Z2Z2);
+        mpFp_mul(rpt->z, I, U2);
+        // I = (2*H)**2, J = H*I, V = U1*I (as U1)
+        mpFp_add(I, U2, U2);
+        mpFp_sqr(I, I);
+        mpFp_mul(J, U2, I);
+        mpFp_mul(U1, U1, I);
+        // X3 = r**2-J-2*V
+        mpFp_sqr(I, S2);
+        mpFp_sub(I, I, J);
+        mpFp_sub(I, I, U1);
+        mpFp_sub(rpt->x, I, U1);
+        // Y3 = r*(V-X3)-2*S1*J
+        mpFp_sub(U1, U1, rpt->x);
+        mpFp_mul(U1, S2, U1);
+        mpFp_mul(S1, S1, J);
+        mpFp_add(S1, S1, S1);
+        mpFp_sub(rpt->y, U1, S1);
+        rpt->cvp = pt1->cvp;
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(J);
+    mpFp_clear(I);
+    mpFp_clear(S2);
+    mpFp_clear(S1);
+    mpFp_clear(U2);
+    mpFp_clear(U1);
+    mpFp_clear(Z2Z2);
+    mpFp_clear(Z1Z1);
+#endif
+    return;
+}
+
+// madd-2007-bl, pt2 has Z == 1
+static void _mpECP_add_mixed_ws_jac(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_t Z1Z1, U2, S2, HH, I, J;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lZ1Z1, lU2, lS2, lHH, lI, lJ;
+    Z1Z1->i->_mp_d = lZ1Z1; Z1Z1->i->_mp_size = 0; Z1Z1->i->_mp_alloc = _MPFP_MAX_LIMBS; Z1Z1->fp = pt1->cvp->fp;
+    U2->i->_mp_d = lU2; U2->i->_mp_size = 0; U2->i->_mp_alloc = _MPFP_MAX_LIMBS; U2->fp = pt1->cvp->fp;
+    S2->i->_mp_d = lS2; S2->i->_mp_size = 0; S2->i->_mp_alloc = _MPFP_MAX_LIMBS; S2->fp = pt1->cvp->fp;
+    HH->i->_mp_d = lHH; HH->i->_mp_size = 0; HH->i->_mp_alloc = _MPFP_MAX_LIMBS; HH->fp = pt1->cvp->fp;
+    I->i->_mp_d = lI; I->i->_mp_size = 0; I->i->_mp_alloc = _MPFP_MAX_LIMBS; I->fp = pt1->cvp->fp;
+    J->i->_mp_d = lJ; J->i->_mp_size = 0; J->i->_mp_alloc = _MPFP_MAX_LIMBS; J->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(Z1Z1, pt1->cvp->fp);
+    mpFp_init_fp(U2, pt1->cvp->fp);
+    mpFp_init_fp(S2, pt1->cvp->fp);
+    mpFp_init_fp(HH, pt1->cvp->fp);
+    mpFp_init_fp(I, pt1->cvp->fp);
+    mpFp_init_fp(J, pt1->cvp->fp);
+#endif
+
+    // Z1Z1 = Z1**2, U2 = X2*Z1Z1, S2 = Y2*Z1*Z1Z1
+    mpFp_sqr(Z1Z1, pt1->z);
+    mpFp_mul(U2, pt2->x, Z1Z1);
+    mpFp_mul(S2, pt1->z, Z1Z1);
+    mpFp_mul(S2, S2, pt2->y);
+    // H = U2-X1 (as U2), r = 2*(S2-Y1) (as S2)
+    mpFp_sub(U2, U2, pt1->x);
+    mpFp_sub(S2, S2, pt1->y);
+    if (mpFp_cmp_ui(U2, 0) == 0) {
+        if (mpFp_cmp_ui(S2, 0) == 0) {
+            _mpECP_dbl_ws_jac(rpt, pt1);
+        } else {
+            mpECP_set_neutral(rpt, pt1->cvp);
+        }
+    } else {
+        mpFp_add(S2, S2, S2);
+        // HH = H**2, I = 4*HH, J = H*I, V = X1*I (as I)
+        mpFp_sqr(HH, U2);
+        mpFp_add(I, HH, HH);
+        mpFp_add(I, I, I);
+        mpFp_mul(J, U2, I);
+        mpFp_mul(I, pt1->x, I);
+        // Z3 = (Z1+H)**2-Z1Z1-HH
+        mpFp_add(U2, pt1->z, U2);
+        mpFp_sqr(U2, U2);
+        mpFp_sub(U2, U2, Z1Z1);
+        mpFp_sub(U2, U2, HH);
+        // Y1*J before rpt is written (2*Y1*J as HH)
+        mpFp_mul(HH, pt1->y, J);
+        mpFp_add(HH, HH, HH);
+        mpFp_set(rpt->z, U2);
+        // X3 = r**2-J-2*V
+        mpFp_sqr(U2, S2);
+        mpFp_sub(U2, U2, J);
+        mpFp_sub(U2, U2, I);
+        mpFp_sub(rpt->x, U2, I);
+        // Y3 = r*(V-X3)-2*Y1*J
+        mpFp_sub(I, I, rpt->x);
+        mpFp_mul(I, S2, I);
+        mpFp_sub(rpt->y, I, HH);
+        rpt->cvp = pt1->cvp;
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(J);
+    mpFp_clear(I);
+    mpFp_clear(HH);
+    mpFp_clear(S2);
+    mpFp_clear(U2);
+    mpFp_clear(Z1Z1);
+#endif
+    return;
+}
+
+// Montgomery curves B * v**2 = u**3 + A * u**2 + u in projective (U : Y : Z)
+// coordinates. The Renes-Costello-Batina law moved over from the equivalent
+// short Weierstrass curve (x = u + A/3, scaled by B) reduces to
+//   s0 = U1*U2, s1 = B*Y1*Y2, s2 = Z1*Z2, s3 = U1*Y2 + U2*Y1,
+//   s4 = U1*Z2 + U2*Z1, s5 = Y1*Z2 + Y2*Z1
+//   D = s0 - s2, P = s1 + s4 + A*s0, Q = s1 - s4 - A*s0,
+//   G = 3*s0 + A*s4 + s2
+//   U3 = B*(s3*Q - s5*D), Y3 = P*Q + G*D, Z3 = B*(s5*P + s3*G)
+// i.e. 12M and two multiplications by A (B == 1 for the standard curves). As
+// for the Weierstrass form the only exceptional pairs differ by a point of
+// order 2, which the odd order subgroup does not contain
+static void _mpECP_add_mo(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr A = pt1->cvp->coeff.mo.A;
+    mpFp_ptr B = pt1->cvp->coeff.mo.B;
+    int b1 = (mpFp_cmp_ui(B, 1) == 0);
+    mpFp_t t0, t1, t2, t3, t4, t5, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt1->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt1->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
+    mpFp_init_fp(X3, pt1->cvp->fp);
+    mpFp_init_fp(Y3, pt1->cvp->fp);
+    mpFp_init_fp(Z3, pt1->cvp->fp);
+#endif
+
+    // t0 <- U1 * U2, t1 <- Y1 * Y2, t2 <- Z1 * Z2
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    mpFp_mul(t2, pt1->z, pt2->z);
+    // t3 <- (U1 + Y1) * (U2 + Y2) - t0 - t1
+    mpFp_add(t3, pt1->x, pt1->y);
+    mpFp_add(X3, pt2->x, pt2->y);
+    mpFp_mul(t3, t3, X3);
+    mpFp_sub(t3, t3, t0);
+    mpFp_sub(t3, t3, t1);
+    // t4 <- (U1 + Z1) * (U2 + Z2) - t0 - t2
+    mpFp_add(t4, pt1->x, pt1->z);
+    mpFp_add(X3, pt2->x, pt2->z);
+    mpFp_mul(t4, t4, X3);
+    mpFp_sub(t4, t4, t0);
+    mpFp_sub(t4, t4, t2);
+    // t5 <- (Y1 + Z1) * (Y2 + Z2) - t1 - t2
+    mpFp_add(t5, pt1->y, pt1->z);
+    mpFp_add(X3, pt2->y, pt2->z);
+    mpFp_mul(t5, t5, X3);
+    mpFp_sub(t5, t5, t1);
+    mpFp_sub(t5, t5, t2);
+    if (b1 == 0) mpFp_mul(t1, t1, B);
+    // Y3 <- P = t1 + t4 + A * t0, Z3 <- Q = t1 - t4 - A * t0
+    mpFp_mul(X3, A, t0);
+    mpFp_add(X3, X3, t4);
+    mpFp_add(Y3, t1, X3);
+    mpFp_sub(Z3, t1, X3);
+    // t1 <- G = 3 * t0 + A * t4 + t2, t2 <- D = t0 - t2
+    mpFp_mul(t1, A, t4);
+    mpFp_add(t1, t1, t2);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_sub(t2, t0, t2);
+    // X3 <- t3 * Q - t5 * D, t0 <- P * Q + G * D, Z3 <- t5 * P + t3 * G
+    mpFp_mul(t0, Y3, Z3);
+    mpFp_mul(X3, t3, Z3);
+    mpFp_mul(Z3, t5, t2);
+    mpFp_sub(X3, X3, Z3);
+    mpFp_mul(Z3, t2, t1);
+    mpFp_add(t0, t0, Z3);
+    mpFp_mul(Z3, t5, Y3);
+    mpFp_mul(t1, t3, t1);
+    mpFp_add(Z3, Z3, t1);
+    if (b1 == 0) {
+        mpFp_mul(X3, X3, B);
+        mpFp_mul(Z3, Z3, B);
+    }
+    mpFp_set(rpt->x, X3);
+    mpFp_set(rpt->y, t0);
+    mpFp_set(rpt->z, Z3);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+// as _mpECP_add_mo with Z2 == 1
+static void _mpECP_add_mixed_mo(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    mpFp_ptr A = pt1->cvp->coeff.mo.A;
+    mpFp_ptr B = pt1->cvp->coeff.mo.B;
+    int b1 = (mpFp_cmp_ui(B, 1) == 0);
+    mpFp_t t0, t1, t2, t3, t4, t5, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt1->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt1->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt1->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt1->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt1->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt1->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt1->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt1->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt1->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt1->cvp->fp);
+    mpFp_init_fp(t1, pt1->cvp->fp);
+    mpFp_init_fp(t2, pt1->cvp->fp);
+    mpFp_init_fp(t3, pt1->cvp->fp);
+    mpFp_init_fp(t4, pt1->cvp->fp);
+    mpFp_init_fp(t5, pt1->cvp->fp);
+    mpFp_init_fp(X3, pt1->cvp->fp);
+    mpFp_init_fp(Y3, pt1->cvp->fp);
+    mpFp_init_fp(Z3, pt1->cvp->fp);
+#endif
+
+    // t0 <- U1 * U2, t1 <- Y1 * Y2, t2 <- Z1
+    mpFp_mul(t0, pt1->x, pt2->x);
+    mpFp_mul(t1, pt1->y, pt2->y);
+    mpFp_set(t2, pt1->z);
+    // t3 <- (U1 + Y1) * (U2 + Y2) - t0 - t1
+    mpFp_add(t3, pt1->x, pt1->y);
+    mpFp_add(X3, pt2->x, pt2->y);
+    mpFp_mul(t3, t3, X3);
+    mpFp_sub(t3, t3, t0);
+    mpFp_sub(t3, t3, t1);
+    // t4 <- U2 * Z1 + U1, t5 <- Y2 * Z1 + Y1
+    mpFp_mul(t4, pt2->x, pt1->z);
+    mpFp_add(t4, t4, pt1->x);
+    mpFp_mul(t5, pt2->y, pt1->z);
+    mpFp_add(t5, t5, pt1->y);
+    if (b1 == 0) mpFp_mul(t1, t1, B);
+    // Y3 <- P = t1 + t4 + A * t0, Z3 <- Q = t1 - t4 - A * t0
+    mpFp_mul(X3, A, t0);
+    mpFp_add(X3, X3, t4);
+    mpFp_add(Y3, t1, X3);
+    mpFp_sub(Z3, t1, X3);
+    // t1 <- G = 3 * t0 + A * t4 + t2, t2 <- D = t0 - t2
+    mpFp_mul(t1, A, t4);
+    mpFp_add(t1, t1, t2);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_sub(t2, t0, t2);
+    // X3 <- t3 * Q - t5 * D, t0 <- P * Q + G * D, Z3 <- t5 * P + t3 * G
+    mpFp_mul(t0, Y3, Z3);
+    mpFp_mul(X3, t3, Z3);
+    mpFp_mul(Z3, t5, t2);
+    mpFp_sub(X3, X3, Z3);
+    mpFp_mul(Z3, t2, t1);
+    mpFp_add(t0, t0, Z3);
+    mpFp_mul(Z3, t5, Y3);
+    mpFp_mul(t1, t3, t1);
+    mpFp_add(Z3, Z3, t1);
+    if (b1 == 0) {
+        mpFp_mul(X3, X3, B);
+        mpFp_mul(Z3, Z3, B);
+    }
+    mpFp_set(rpt->x, X3);
+    mpFp_set(rpt->y, t0);
+    mpFp_set(rpt->z, Z3);
+
+    rpt->cvp = pt1->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt1->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+// _mpECP_add_mo with P1 == P2, s3 = 2UY and s5 = 2YZ give
+//   U3 = 2BY * (U*Q - Z*D), Y3 = P*Q + G*D, Z3 = 2BY * (Z*P + U*G)
+// with s4 = 2UZ, (8M + 4S)
+static void _mpECP_dbl_mo(mpECP_t rpt, mpECP_t pt) {
+    mpFp_ptr A = pt->cvp->coeff.mo.A;
+    mpFp_ptr B = pt->cvp->coeff.mo.B;
+    int b1 = (mpFp_cmp_ui(B, 1) == 0);
+    mpFp_t t0, t1, t2, t3, t4, t5, X3, Y3, Z3;
+#ifdef _MPECP_MPFP_NOMALLOC
+    __local_limb_t lt0, lt1, lt2, lt3, lt4, lt5, lX3, lY3, lZ3;
+    t0->i->_mp_d = lt0; t0->i->_mp_size = 0; t0->i->_mp_alloc = _MPFP_MAX_LIMBS; t0->fp = pt->cvp->fp;
+    t1->i->_mp_d = lt1; t1->i->_mp_size = 0; t1->i->_mp_alloc = _MPFP_MAX_LIMBS; t1->fp = pt->cvp->fp;
+    t2->i->_mp_d = lt2; t2->i->_mp_size = 0; t2->i->_mp_alloc = _MPFP_MAX_LIMBS; t2->fp = pt->cvp->fp;
+    t3->i->_mp_d = lt3; t3->i->_mp_size = 0; t3->i->_mp_alloc = _MPFP_MAX_LIMBS; t3->fp = pt->cvp->fp;
+    t4->i->_mp_d = lt4; t4->i->_mp_size = 0; t4->i->_mp_alloc = _MPFP_MAX_LIMBS; t4->fp = pt->cvp->fp;
+    t5->i->_mp_d = lt5; t5->i->_mp_size = 0; t5->i->_mp_alloc = _MPFP_MAX_LIMBS; t5->fp = pt->cvp->fp;
+    X3->i->_mp_d = lX3; X3->i->_mp_size = 0; X3->i->_mp_alloc = _MPFP_MAX_LIMBS; X3->fp = pt->cvp->fp;
+    Y3->i->_mp_d = lY3; Y3->i->_mp_size = 0; Y3->i->_mp_alloc = _MPFP_MAX_LIMBS; Y3->fp = pt->cvp->fp;
+    Z3->i->_mp_d = lZ3; Z3->i->_mp_size = 0; Z3->i->_mp_alloc = _MPFP_MAX_LIMBS; Z3->fp = pt->cvp->fp;
+#else
+    mpFp_init_fp(t0, pt->cvp->fp);
+    mpFp_init_fp(t1, pt->cvp->fp);
+    mpFp_init_fp(t2, pt->cvp->fp);
+    mpFp_init_fp(t3, pt->cvp->fp);
+    mpFp_init_fp(t4, pt->cvp->fp);
+    mpFp_init_fp(t5, pt->cvp->fp);
+    mpFp_init_fp(X3, pt->cvp->fp);
+    mpFp_init_fp(Y3, pt->cvp->fp);
+    mpFp_init_fp(Z3, pt->cvp->fp);
+#endif
+
+    // t0 <- U**2, t1 <- Y**2, t2 <- Z**2, t4 <- (U + Z)**2 - t0 - t2
+    mpFp_sqr(t0, pt->x);
+    mpFp_sqr(t1, pt->y);
+    mpFp_sqr(t2, pt->z);
+    mpFp_add(t4, pt->x, pt->z);
+    mpFp_sqr(t4, t4);
+    mpFp_sub(t4, t4, t0);
+    mpFp_sub(t4, t4, t2);
+    if (b1 == 0) mpFp_mul(t1, t1, B);
+    // Y3 <- P = t1 + t4 + A * t0, Z3 <- Q = t1 - t4 - A * t0
+    mpFp_mul(X3, A, t0);
+    mpFp_add(X3, X3, t4);
+    mpFp_add(Y3, t1, X3);
+    mpFp_sub(Z3, t1, X3);
+    // t1 <- G = 3 * t0 + A * t4 + t2, t2 <- D = t0 - t2
+    mpFp_mul(t1, A, t4);
+    mpFp_add(t1, t1, t2);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_add(t1, t1, t0);
+    mpFp_sub(t2, t0, t2);
+    // t3 <- U * Q - Z * D, t0 <- P * Q + G * D, t5 <- Z * P + U * G
+    mpFp_mul(t3, pt->x, Z3);
+    mpFp_mul(t5, pt->z, t2);
+    mpFp_sub(t3, t3, t5);
+    mpFp_mul(t0, Y3, Z3);
+    mpFp_mul(t5, t1, t2);
+    mpFp_add(t0, t0, t5);
+    mpFp_mul(t5, pt->z, Y3);
+    mpFp_mul(t4, pt->x, t1);
+    mpFp_add(t5, t5, t4);
+    // t4 <- 2 * B * Y
+    mpFp_add(t4, pt->y, pt->y);
+    if (b1 == 0) mpFp_mul(t4, t4, B);
+    mpFp_mul(rpt->x, t4, t3);
+    mpFp_set(rpt->y, t0);
+    mpFp_mul(rpt->z, t4, t5);
+
+    rpt->cvp = pt->cvp;
+
+    if (mpFp_cmp_ui(rpt->z, 0) == 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+    } else {
+        rpt->is_neutral = 0;
+    }
+
+#ifndef _MPECP_MPFP_NOMALLOC
+    mpFp_clear(Z3);
+    mpFp_clear(Y3);
+    mpFp_clear(X3);
+    mpFp_clear(t5);
+    mpFp_clear(t4);
+    mpFp_clear(t3);
+    mpFp_clear(t2);
+    mpFp_clear(t1);
+    mpFp_clear(t0);
+#endif
+    return;
+}
+
+void mpECP_add(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    assert(_mpECP_same_curve(pt1->cvp, pt2->cvp));
+    if (pt1->is_neutral != 0) {
+        if (pt2->is_neutral != 0) {
+            mpECP_set_neutral(rpt, pt1->cvp);
+            return;
+        } else {
+            mpECP_set(rpt, pt2);
+            return;
+        }
+    } else if (pt2->is_neutral != 0) {
+        mpECP_set(rpt, pt1);
+        return;
+    }
+    if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+    pt1->cvp->formulas[MPECP_FORMULAS_SECRET]->add(rpt, pt1, pt2);
+    return;
+}
+
+void mpECP_double(mpECP_t rpt, mpECP_t pt) {
+    if (pt->is_neutral != 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+        return;
+    }
+    if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+    pt->cvp->formulas[MPECP_FORMULAS_SECRET]->dbl(rpt, pt);
+    return;
+}
+
+void mpECP_sub(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    assert(_mpECP_same_curve(pt1->cvp, pt2->cvp));
+    if (pt2->is_neutral != 0) {
+        if (pt1->is_neutral != 0) {
+            mpECP_set_neutral(rpt, pt1->cvp);
+        } else {
+            mpECP_set(rpt, pt1);
+        }
+    } else {
+        mpECP_t n;
+        mpECP_init(n, pt1->cvp);
+        mpECP_neg(n, pt2);
+        mpECP_add(rpt, pt1, n);
+        mpECP_clear(n);
+    }
+    return;
+}
+
+// mixed addition, rpt = pt1 + pt2 where pt2 is affine (Z2 == 1). rpt may
+// alias either input. Used with normalized (affine) tables
+static void _mpECP_add_mixed(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    if ((pt1->is_neutral != 0) || (pt2->is_neutral != 0)) {
+        mpECP_add(rpt, pt1, pt2);
+        return;
+    }
+    assert(mpFp_cmp_ui(pt2->z, 1) == 0);
+    if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+    pt1->cvp->formulas[MPECP_FORMULAS_SECRET]->add_mixed(rpt, pt1, pt2);
+    return;
+}
+
+// double and mixed add with the public (variable time) formulas, in the
+// coordinates of that set (see _mpECP_formulas_leave)
+static void _mpECP_double_public(mpECP_t rpt, mpECP_t pt) {
+    if (pt->is_neutral != 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+        return;
+    }
+    pt->cvp->formulas[MPECP_FORMULAS_PUBLIC]->dbl(rpt, pt);
+    return;
+}
+
+static void _mpECP_add_mixed_public(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
+    if (pt2->is_neutral != 0) {
+        mpECP_set(rpt, pt1);
+        return;
+    }
+    if (pt1->is_neutral != 0) {
+        // affine, so the same in any coordinates
+        mpECP_set(rpt, pt2);
+        return;
+    }
+    assert(mpFp_cmp_ui(pt2->z, 1) == 0);
+    pt1->cvp->formulas[MPECP_FORMULAS_PUBLIC]->add_mixed(rpt, pt1, pt2);
+    return;
+}
+
+// convert pt from the coordinates of the public formulas to projective
+static inline void _mpECP_formulas_leave(mpECP_t pt) {
+    const _mpECurve_formulas_t *f = pt->cvp->formulas[MPECP_FORMULAS_PUBLIC];
+    if (f->to_proj != NULL) f->to_proj(pt);
+    return;
+}
+
+// Montgomery ladder step, (R0, R1) <- (2 * R0, R0 + R1)
+static void _mpECP_ladder_step(mpECP_t R0, mpECP_t R1) {
+    mpECP_add(R1, R1, R0);
+    mpECP_double(R0, R0);
+    return;
+}
+
+static const _mpECurve_ops_t _mpECP_ops_ws = {
+    .name = "short-weierstrass",
+    .neg = _mpECP_neg_y,
+    .solve_y = _mpECP_solve_y_ws
+};
+
+static const _mpECurve_ops_t _mpECP_ops_mo = {
+    .name = "montgomery",
+    .neg = _mpECP_neg_y,
+    .solve_y = _mpECP_solve_y_mo
+};
+
+static const _mpECurve_ops_t _mpECP_ops_ed = {
+    .name = "edwards",
+    .neg = _mpECP_neg_x,
+    .solve_y = _mpECP_solve_y_ed
+};
+
+static const _mpECurve_ops_t _mpECP_ops_te = {
+    .name = "twisted-edwards",
+    .neg = _mpECP_neg_x,
+    .solve_y = _mpECP_solve_y_te
+};
+
+// group law formula sets. The -a0 and -a3 variants of the short Weierstrass
+// sets require a == 0 and a == -3
+
+static const _mpECurve_formulas_t _mpECP_formulas_rcb = {
+    .name = "rcb",
+    .complete = 1,
+    .add = _mpECP_add_ws,
+    .add_mixed = _mpECP_add_mixed_ws,
+    .dbl = _mpECP_dbl_ws,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_rcb_a0 = {
+    .name = "rcb-a0",
+    .complete = 1,
+    .add = _mpECP_add_ws_a0,
+    .add_mixed = _mpECP_add_mixed_ws_a0,
+    .dbl = _mpECP_dbl_ws_a0,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_rcb_a3 = {
+    .name = "rcb-a3",
+    .complete = 1,
+    .add = _mpECP_add_ws_a3,
+    .add_mixed = _mpECP_add_mixed_ws_a3,
+    .dbl = _mpECP_dbl_ws_a3,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_jac = {
+    .name = "jacobian",
+    .complete = 0,
+    .add = _mpECP_add_ws_jac,
+    .add_mixed = _mpECP_add_mixed_ws_jac,
+    .dbl = _mpECP_dbl_ws_jac,
+    .from_proj = _mpECP_proj_to_jac,
+    .to_proj = _mpECP_jac_to_proj
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_jac_a0 = {
+    .name = "jacobian-a0",
+    .complete = 0,
+    .add = _mpECP_add_ws_jac,
+    .add_mixed = _mpECP_add_mixed_ws_jac,
+    .dbl = _mpECP_dbl_ws_jac_a0,
+    .from_proj = _mpECP_proj_to_jac,
+    .to_proj = _mpECP_jac_to_proj
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_jac_a3 = {
+    .name = "jacobian-a3",
+    .complete = 0,
+    .add = _mpECP_add_ws_jac,
+    .add_mixed = _mpECP_add_mixed_ws_jac,
+    .dbl = _mpECP_dbl_ws_jac_a3,
+    .from_proj = _mpECP_proj_to_jac,
+    .to_proj = _mpECP_jac_to_proj
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_mo = {
+    .name = "montgomery",
+    .complete = 1,
+    .add = _mpECP_add_mo,
+    .add_mixed = _mpECP_add_mixed_mo,
+    .dbl = _mpECP_dbl_mo,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_ed = {
+    .name = "edwards",
+    .complete = 1,
+    .add = _mpECP_add_ed,
+    .add_mixed = _mpECP_add_mixed_ed,
+    .dbl = _mpECP_dbl_ed,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+static const _mpECurve_formulas_t _mpECP_formulas_te = {
+    .name = "twisted-edwards",
+    .complete = 1,
+    .add = _mpECP_add_te,
+    .add_mixed = _mpECP_add_mixed_te,
+    .dbl = _mpECP_dbl_te,
+    .from_proj = NULL,
+    .to_proj = NULL
+};
+
+#define _MPECP_FORMULAS_A_ANY   (0)
+#define _MPECP_FORMULAS_A_0     (1)
+#define _MPECP_FORMULAS_A_M3    (2)
+
+// all formula sets, specialized sets precede the generic set of the same
+// family (see _mpECP_formulas_select)
+static const struct {
+    const _mpECurve_formulas_t *f;
+    _mpECurve_eq_type type;
+    int a;
+} _mpECP_formulas_all[] = {
+    {&_mpECP_formulas_rcb_a0, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_0},
+    {&_mpECP_formulas_rcb_a3, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_M3},
+    {&_mpECP_formulas_rcb, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_ANY},
+    {&_mpECP_formulas_jac_a0, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_0},
+    {&_mpECP_formulas_jac_a3, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_M3},
+    {&_mpECP_formulas_jac, EQTypeShortWeierstrass, _MPECP_FORMULAS_A_ANY},
+    {&_mpECP_formulas_mo, EQTypeMontgomery, _MPECP_FORMULAS_A_ANY},
+    {&_mpECP_formulas_ed, EQTypeEdwards, _MPECP_FORMULAS_A_ANY},
+    {&_mpECP_formulas_te, EQTypeTwistedEdwards, _MPECP_FORMULAS_A_ANY},
+    {NULL, EQTypeNone, 0}
+};
+
+static int _mpECP_formulas_apply(mpECurve_t cv, int i, int opclass) {
+    int a;
+    mpFp_t t;
+
+    if ((opclass == MPECP_FORMULAS_SECRET) &&
+        (_mpECP_formulas_all[i].f->complete == 0)) return 0;
+    if (cv->type != _mpECP_formulas_all[i].type) return 0;
+    if (_mpECP_formulas_all[i].a == _MPECP_FORMULAS_A_ANY) return 1;
+    if (_mpECP_formulas_all[i].a == _MPECP_FORMULAS_A_0) {
+        return (mpFp_cmp_ui(cv->ws_a, 0) == 0);
+    }
+    mpFp_init_fp(t, cv->fp);
+    mpFp_add_ui(t, cv->ws_a, 3);
+    a = (mpFp_cmp_ui(t, 0) == 0);
+    mpFp_clear(t);
+    return a;
+}
+
+int mpECP_formulas_set(mpECurve_t cv, int opclass, const char *name) {
+    int i;
+    assert((opclass == MPECP_FORMULAS_SECRET) || (opclass == MPECP_FORMULAS_PUBLIC));
+    for (i = 0; _mpECP_formulas_all[i].f != NULL; i++) {
+        if (strcmp(_mpECP_formulas_all[i].f->name, name) != 0) continue;
+        if (_mpECP_formulas_apply(cv, i, opclass) == 0) return -1;
+        cv->formulas[opclass] = _mpECP_formulas_all[i].f;
+        return 0;
+    }
+    return -1;
+}
+
+const char *mpECP_formulas_name(mpECurve_t cv, int opclass) {
+    assert((opclass == MPECP_FORMULAS_SECRET) || (opclass == MPECP_FORMULAS_PUBLIC));
+    if (cv->formulas[opclass] == NULL) return NULL;
+    return cv->formulas[opclass]->name;
+}
+
+int mpECP_formulas_list(mpECurve_t cv, int opclass, const char **names, int max) {
+    int i, n;
+    assert((opclass == MPECP_FORMULAS_SECRET) || (opclass == MPECP_FORMULAS_PUBLIC));
+    n = 0;
+    for (i = 0; _mpECP_formulas_all[i].f != NULL; i++) {
+        if (_mpECP_formulas_apply(cv, i, opclass) == 0) continue;
+        if (n < max) names[n] = _mpECP_formulas_all[i].f->name;
+        n += 1;
+    }
+    return n;
+}
+
+// default formulas, the first applicable complete set for secret data and
+// the first applicable variable time set (if any) for public data
+static void _mpECP_formulas_select(mpECurve_t cv) {
+    int i;
+    const _mpECurve_formulas_t *f;
+    cv->formulas[MPECP_FORMULAS_SECRET] = NULL;
+    cv->formulas[MPECP_FORMULAS_PUBLIC] = NULL;
+    for (i = 0; _mpECP_formulas_all[i].f != NULL; i++) {
+        if (_mpECP_formulas_apply(cv, i, MPECP_FORMULAS_PUBLIC) == 0) continue;
+        f = _mpECP_formulas_all[i].f;
+        if (f->complete != 0) {
+            if (cv->formulas[MPECP_FORMULAS_SECRET] == NULL) {
+                cv->formulas[MPECP_FORMULAS_SECRET] = f;
+            }
+        } else if (cv->formulas[MPECP_FORMULAS_PUBLIC] == NULL) {
+            cv->formulas[MPECP_FORMULAS_PUBLIC] = f;
+        }
+    }
+    if (cv->formulas[MPECP_FORMULAS_PUBLIC] == NULL) {
+        cv->formulas[MPECP_FORMULAS_PUBLIC] = cv->formulas[MPECP_FORMULAS_SECRET];
+    }
+    return;
+}
+
+void _mpECP_curve_ops_select(mpECurve_t cv) {
+    cv->ws_a = NULL;
+    cv->ws_b = NULL;
+    cv->ws_b3 = NULL;
+    switch (cv->type) {
+        case EQTypeShortWeierstrass:
+            cv->ws_a = cv->coeff.ws.a;
+            cv->ws_b = cv->coeff.ws.b;
+            cv->ws_b3 = cv->coeff.ws.b3;
+            cv->ops = &_mpECP_ops_ws;
+            break;
+        case EQTypeMontgomery:
+            cv->ops = &_mpECP_ops_mo;
+            break;
+        case EQTypeEdwards:
+            cv->ops = &_mpECP_ops_ed;
+            break;
+        case EQTypeTwistedEdwards:
+            cv->ops = &_mpECP_ops_te;
+            break;
+        default:
+            cv->ops = NULL;
+            cv->formulas[MPECP_FORMULAS_SECRET] = NULL;
+            cv->formulas[MPECP_FORMULAS_PUBLIC] = NULL;
+            return;
+    }
+    if (cv->ws_b3 != NULL) {
+        mpFp_add(cv->ws_b3, cv->ws_b, cv->ws_b);
+        mpFp_add(cv->ws_b3, cv->ws_b3, cv->ws_b);
+    }
+    _mpECP_formulas_select(cv);
+#ifdef HAVE_CXX_ENGINES
+    // fixed size C++ engines for the common named curves (ecc_engines.cpp)
+    cv->ops = _mpECP_engine_ops_select(cv, cv->ops);
+#endif
+    return;
+}
+
+// per host tuning (see mpECP_tune_load). The list of entries is replaced as
+// a whole under _mpECP_tune_lock, the file named at init is read once
+
+#ifndef _MPECP_TUNE_FILE
+#define _MPECP_TUNE_FILE    "/etc/ecc-tune.conf"
+#endif
+
+#define _MPECP_TUNE_NAME_LEN    (32)
+#define _MPECP_TUNE_LINE_LEN    (256)
+
+typedef struct __mpECP_tune_t {
+    char name[_MPECP_TUNE_NAME_LEN];
+    int window_bits;
+    int base_bits;
+    char formulas[2][_MPECP_TUNE_NAME_LEN];
+    struct __mpECP_tune_t *next;
+} _mpECP_tune_t;
+
+static pthread_mutex_t _mpECP_tune_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _mpECP_tune_once = PTHREAD_ONCE_INIT;
+static _mpECP_tune_t *_mpECP_tune_list = NULL;
+static const char *_mpECP_tune_file = NULL;
+
+static void _mpECP_tune_free(_mpECP_tune_t *e) {
+    _mpECP_tune_t *next;
+    while (e != NULL) {
+        next = e->next;
+        free(e);
+        e = next;
+    }
+    return;
+}
+
+// one key=value setting for curve entry e (or a global setting if e is
+// NULL), nonzero if malformed. The global backend setting is applied by
+// field.c when the library is loaded
+static int _mpECP_tune_setting(_mpECP_tune_t *e, char *kv) {
+    char *v, *end;
+    long w;
+
+    v = strchr(kv, '=');
+    if ((v == NULL) || (strlen(v + 1) >= _MPECP_TUNE_NAME_LEN)) return -1;
+    *v = 0;
+    v += 1;
+    if (e == NULL) return 0;
+    if ((strcmp(kv, "window") == 0) || (strcmp(kv, "base") == 0)) {
+        w = strtol(v, &end, 10);
+        if ((end == v) || (*end != 0) || (w > _MPECP_MAX_WINDOW_BITS)) return -1;
+        // window 1 is the ladder, tables need at least 2 bits
+        if (kv[0] == 'w') {
+            if (w < 1) return -1;
+            e->window_bits = (int)w;
+        } else {
+            if (w < 2) return -1;
+            e->base_bits = (int)w;
+        }
+    } else if (strcmp(kv, "secret") == 0) {
+        strcpy(e->formulas[MPECP_FORMULAS_SECRET], v);
+    } else if (strcmp(kv, "public") == 0) {
+        strcpy(e->formulas[MPECP_FORMULAS_PUBLIC], v);
+    }
+    return 0;
+}
+
+static int _mpECP_tune_read(const char *path) {
+    FILE *f;
+    char line[_MPECP_TUNE_LINE_LEN];
+    char *tok, *save;
+    _mpECP_tune_t *list, *e;
+    int error;
+
+    list = NULL;
+    error = 0;
+    f = fopen(path, "r");
+    if (f == NULL) error = -1;
+    while ((error == 0) && (fgets(line, sizeof(line), f) != NULL)) {
+        if ((strchr(line, '\n') == NULL) && (feof(f) == 0)) {
+            // line too long
+            error = -1;
+            break;
+        }
+        tok = strchr(line, '#');
+        if (tok != NULL) *tok = 0;
+        tok = strtok_r(line, " \t\r\n", &save);
+        if (tok == NULL) continue;
+        e = NULL;
+        if (strchr(tok, '=') == NULL) {
+            if (strlen(tok) >= _MPECP_TUNE_NAME_LEN) {
+                error = -1;
+                break;
+            }
+            // later entries for the same curve take precedence
+            e = (_mpECP_tune_t *)calloc(1, sizeof(_mpECP_tune_t));
+            assert(e != NULL);
+            strcpy(e->name, tok);
+            e->next = list;
+            list = e;
+            tok = strtok_r(NULL, " \t\r\n", &save);
+        }
+        while ((tok != NULL) && (error == 0)) {
+            error = _mpECP_tune_setting(e, tok);
+            tok = strtok_r(NULL, " \t\r\n", &save);
+        }
+    }
+    if (f != NULL) fclose(f);
+    if (error != 0) {
+        _mpECP_tune_free(list);
+        list = NULL;
+    }
+    pthread_mutex_lock(&_mpECP_tune_lock);
+    e = _mpECP_tune_list;
+    _mpECP_tune_list = list;
+    pthread_mutex_unlock(&_mpECP_tune_lock);
+    _mpECP_tune_free(e);
+    return error;
+}
+
+static void _mpECP_tune_init(void) {
+    const char *path;
+    path = getenv("ECC_TUNE_FILE");
+    if (path == NULL) path = _MPECP_TUNE_FILE;
+    if (path[0] == 0) return;
+    _mpECP_tune_file = path;
+    // without a tuning file the built in defaults apply
+    _mpECP_tune_read(path);
+    return;
+}
+
+int mpECP_tune_load(const char *path) {
+    pthread_once(&_mpECP_tune_once, _mpECP_tune_init);
+    return _mpECP_tune_read(path);
+}
+
+void mpECP_tune_reset(void) {
+    _mpECP_tune_t *e;
+    pthread_once(&_mpECP_tune_once, _mpECP_tune_init);
+    pthread_mutex_lock(&_mpECP_tune_lock);
+    e = _mpECP_tune_list;
+    _mpECP_tune_list = NULL;
+    pthread_mutex_unlock(&_mpECP_tune_lock);
+    _mpECP_tune_free(e);
+    return;
+}
+
+const char *mpECP_tune_path(void) {
+    pthread_once(&_mpECP_tune_once, _mpECP_tune_init);
+    return _mpECP_tune_file;
+}
+
+void _mpECP_tune_apply(mpECurve_t cv) {
+    _mpECP_tune_t *e;
+    int c;
+
+    pthread_once(&_mpECP_tune_once, _mpECP_tune_init);
+    if (cv->name == NULL) return;
+    pthread_mutex_lock(&_mpECP_tune_lock);
+    for (e = _mpECP_tune_list; e != NULL; e = e->next) {
+        if (strcmp(e->name, cv->name) == 0) break;
+    }
+    if (e != NULL) {
+        cv->window_bits = e->window_bits;
+        cv->base_bits = e->base_bits;
+        for (c = 0; c < 2; c++) {
+            // formulas which do not apply to cv keep the default
+            if (e->formulas[c][0] != 0) mpECP_formulas_set(cv, c, e->formulas[c]);
+        }
+    }
+    pthread_mutex_unlock(&_mpECP_tune_lock);
+    return;
+}
+
+// number of bits in a scalar, i.e. bitsize of n (which may exceed cv->bits)
+static inline int _mpECP_scalar_bits(mpECurve_ptr cvp) {
+    return mpz_sizeinbase(cvp->n, 2);
+}
+
+// return w bits of the (little endian) limb array d starting at bit pos
+static inline unsigned int _mpECP_limb_bits(mp_limb_t *d, mp_size_t nlimbs, int pos, int w) {
+    int limb, shift;
+    mp_limb_t v;
+
+    limb = pos / GMP_NUMB_BITS;
+    shift = pos % GMP_NUMB_BITS;
+    if (limb >= nlimbs) return 0;
+    v = d[limb] >> shift;
+    if (((shift + w) > GMP_NUMB_BITS) && ((limb + 1) < nlimbs)) {
+        v |= d[limb + 1] << (GMP_NUMB_BITS - shift);
+    }
+    return (unsigned int)(v & ((((mp_limb_t)1) << w) - 1));
+}
+
+// conditional move (constant time), rpt = pt if move != 0
+static inline void _mpECP_cmov(mpECP_t rpt, mpECP_t pt, int move) {
+    int a[2];
+    move = (move != 0);
+
+    mpFp_cmov(rpt->x, pt->x, move);
+    mpFp_cmov(rpt->y, pt->y, move);
+    mpFp_cmov(rpt->z, pt->z, move);
+
+    a[0] = rpt->is_neutral;
+    a[1] = pt->is_neutral;
+    rpt->is_neutral = a[move];
+    return;
+}
+
+// conditional negation (constant time), pt = -pt if neg != 0
+static void _mpECP_cneg(mpECP_t pt, int neg) {
+    mpFp_t t;
+    mpFp_init_fp(t, pt->cvp->fp);
+    switch (pt->cvp->type) {
+        case EQTypeMontgomery:
+        case EQTypeShortWeierstrass:
+            mpFp_neg(t, pt->y);
+            mpFp_cmov(pt->y, t, neg);
+            break;
+        case EQTypeEdwards:
+        case EQTypeTwistedEdwards:
+            mpFp_neg(t, pt->x);
+            mpFp_cmov(pt->x, t, neg);
+            break;
+        default:
+            assert(_known_curve_type(pt->cvp));
+    }
+    mpFp_clear(t);
+    return;
+}
+
+// constant time table lookup, scans every entry, rpt = T[idx]
+static void _mpECP_ct_lookup(mpECP_t rpt, struct _p_mpECP_t *T, int tsz, unsigned int idx) {
+    int i;
+    mpECP_set(rpt, &T[0]);
+    for (i = 1; i < tsz; i++) {
+        _mpECP_cmov(rpt, &T[i], (unsigned int)i == idx);
+    }
+    return;
+}
+
+// window sizes selected from timings across the standard curves. Larger
+// windows trade table setup (2**(w-1) adds) and lookup cost for fewer adds in
+// the main loop, w = 5 is best (or within noise) from 160 to 521 bits. The
+// x-only ladder (w = 1) is about twice as fast as any window on Montgomery
+// curves
+static int _mpECP_default_window_bits(mpECurve_ptr cvp) {
+    int bits;
+    if (_MPECP_WINDOW_BITS != 0) return _MPECP_WINDOW_BITS;
+    if (cvp->type == EQTypeMontgomery) return 1;
+    bits = _mpECP_scalar_bits(cvp);
+    if (bits <= 128) return 4;
+    return 5;
+}
+
+// GLV processes two half length scalars jointly, with twice the tables
+static int _mpECP_default_glv_window_bits(mpECurve_ptr cvp) {
+    if (_MPECP_WINDOW_BITS != 0) return _MPECP_WINDOW_BITS;
+    return 4;
+}
+
+// window used by mpECP_scalar_mul, measured (cv->window_bits, see
+// mpECP_tune_load) or the default
+static int _mpECP_window_bits(mpECurve_ptr cvp) {
+    if (cvp->glv.enabled != 0) {
+        // there is no GLV form of the ladder
+        if (cvp->window_bits >= 2) return cvp->window_bits;
+        return _mpECP_default_glv_window_bits(cvp);
+    }
+    if (cvp->window_bits != 0) return cvp->window_bits;
+    return _mpECP_default_window_bits(cvp);
+}
+
+int mpECP_scalar_mul_window_bits(mpECurve_t cv) {
+    return _mpECP_window_bits(cv);
+}
+
+void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    if (pt->cvp->ops->scalar_mul != NULL) {
+        if (pt->is_neutral != 0) {
+            mpECP_set_neutral(rpt, pt->cvp);
+            return;
+        }
+        // scalar should be modulo the order of the curve
+        assert(mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
+        pt->cvp->ops->scalar_mul(rpt, pt, sc);
+        return;
+    }
+    if (pt->cvp->glv.enabled != 0) {
+        mpECP_scalar_mul_glv(rpt, pt, sc, _mpECP_window_bits(pt->cvp));
+        return;
+    }
+    mpECP_scalar_mul_window(rpt, pt, sc, _mpECP_window_bits(pt->cvp));
+    return;
+}
+
+// table of odd multiples T[i] = (2i + 1) * P, T must be allocated
+static void _mpECP_odd_multiples(struct _p_mpECP_t *T, int tsz, mpECP_t pt) {
+    int i;
+    mpECP_t P2;
+    for (i = 0; i < tsz; i++) {
+        mpECP_init(&T[i], pt->cvp);
+    }
+    mpECP_set(&T[0], pt);
+    if (tsz > 1) {
+        mpECP_init(P2, pt->cvp);
+        mpECP_double(P2, pt);
+        for (i = 1; i < tsz; i++) {
+            mpECP_add(&T[i], &T[i-1], P2);
+        }
+        mpECP_clear(P2);
+    }
+    return;
+}
+
+static void _mpECP_odd_multiples_clear(struct _p_mpECP_t *T, int tsz) {
+    int i;
+    for (i = 0; i < tsz; i++) {
+        mpECP_clear(&T[i]);
+    }
+    free(T);
+    return;
+}
+
+// copy the scalar into a limb array and force it to be odd, returns 1 if
+// the scalar was even (in which case k + 1 is used)
+static inline int _mpECP_limbs_odd(mp_limb_t *kl, mp_size_t nlimbs, mpz_t k) {
+    int i, even;
+    assert(mpz_size(k) <= (size_t)nlimbs);
+    for (i = 0; i < nlimbs; i++) {
+        kl[i] = mpz_getlimbn(k, i);
+    }
+    even = 1 - (int)(kl[0] & 1);
+    kl[0] |= 1;
+    return even;
+}
+
+// joint fixed window (constant time), rpt = sum(k[j] * P[j]) for j < m. T[j]
+// holds the 2**(w-1) odd multiples of P[j], every k[j] must be odd and have
+// at most nbits bits. If kneg != NULL, -k[j] is used where kneg[j] != 0. If
+// affine != 0 all table entries are affine and mixed additions are used.
+// Each window costs w doublings and m additions
+static void _mpECP_straus_ct(mpECP_t rpt, struct _p_mpECP_t **T, mp_limb_t **k,
+int *kneg, mp_size_t nlimbs, int m, int w, int nbits, int affine) {
+    int i, j, nd, tsz, neg, sneg;
+    unsigned int u, idx;
+    mpECP_t R, Q;
+
+    nd = (nbits + w - 1) / w;
+    tsz = 1 << (w - 1);
+    mpECP_init(R, T[0][0].cvp);
+    mpECP_init(Q, T[0][0].cvp);
+    // most significant digits are always positive
+    for (j = 0; j < m; j++) {
+        sneg = (kneg != NULL) ? kneg[j] : 0;
+        u = _mpECP_limb_bits(k[j], nlimbs, ((nd - 1) * w) + 1, w - 1);
+        if (j == 0) {
+            _mpECP_ct_lookup(R, T[j], tsz, u);
+            _mpECP_cneg(R, sneg);
+        } else {
+            _mpECP_ct_lookup(Q, T[j], tsz, u);
+            _mpECP_cneg(Q, sneg);
+            if (affine != 0) {
+                _mpECP_add_mixed(R, R, Q);
+            } else {
+                mpECP_add(R, R, Q);
+            }
+        }
+    }
+    for (i = nd - 2; i >= 0; i--) {
+        for (j = 0; j < w; j++) {
+            mpECP_double(R, R);
+        }
+        for (j = 0; j < m; j++) {
+            sneg = (kneg != NULL) ? kneg[j] : 0;
+            u = _mpECP_limb_bits(k[j], nlimbs, (i * w) + 1, w);
+            neg = 1 - (int)(u >> (w - 1));
+            idx = (u ^ (0U - (unsigned int)neg)) & (tsz - 1);
+            _mpECP_ct_lookup(Q, T[j], tsz, idx);
+            _mpECP_cneg(Q, neg ^ sneg);
+            if (affine != 0) {
+                _mpECP_add_mixed(R, R, Q);
+            } else {
+                mpECP_add(R, R, Q);
+            }
+        }
+    }
+    mpECP_set(rpt, R);
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    return;
+}
+
+// fixed window scalar multiplication using signed odd digits (regular
+// recoding, Joye-Tunstall). For odd k and window w the digits are
+// d_i = 2 * k[iw+1 .. iw+w] + 1 - 2**w, so every digit is odd and nonzero,
+// k = sum(d_i * 2**(iw)) and each window costs exactly w doublings and one
+// addition of an entry from the table of odd multiples {P, 3P, ...}. Even k
+// is handled by multiplying by k+1 and (conditionally) subtracting P.
+void mpECP_scalar_mul_window(mpECP_t rpt, mpECP_t pt, mpFp_t sc, int w) {
+    int tsz, even;
+    mp_size_t nlimbs;
+    mp_limb_t kl[_MPFP_MAX_LIMBS];
+    mp_limb_t *kp[1];
+    mpECP_t R, Q;
+    mpz_t k;
+    struct _p_mpECP_t *T;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
+    if (w < 2) {
+        mpECP_scalar_mul_coz(rpt, pt, sc);
+        return;
+    }
+    assert(w <= _MPECP_MAX_WINDOW_BITS);
+    if (pt->is_neutral != 0) {
+        mpECP_set_neutral(rpt, pt->cvp);
+        return;
+    }
+    tsz = 1 << (w - 1);
+    mpECP_init(R, pt->cvp);
+    mpECP_init(Q, pt->cvp);
+    T = (struct _p_mpECP_t *)malloc(tsz * sizeof(struct _p_mpECP_t));
+    assert(T != NULL);
+    _mpECP_odd_multiples(T, tsz, pt);
+
+    nlimbs = sc->fp->psize;
+    mpz_init(k);
+    mpz_set_mpFp(k, sc);
+    even = _mpECP_limbs_odd(kl, nlimbs, k);
+    kp[0] = kl;
+    _mpECP_straus_ct(R, &T, kp, NULL, nlimbs, 1, w, _mpECP_scalar_bits(pt->cvp), 0);
+
+    // k was even, so we calculated (k + 1) * P
+    mpECP_sub(Q, R, pt);
+    _mpECP_cmov(R, Q, even);
+    mpECP_set(rpt, R);
+
+    mpz_clear(k);
+    _mpECP_odd_multiples_clear(T, tsz);
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    return;
+}
+
+// apply the endomorphism phi(X:Y:Z) = (beta*X:Y:Z), same form for projective
+// and Jacobian coordinates
+static inline void _mpECP_glv_phi(mpECP_t rpt, mpECP_t pt) {
+    mpECP_set(rpt, pt);
+    if (pt->is_neutral == 0) {
+        mpFp_mul(rpt->x, pt->x, pt->cvp->glv.beta);
+    }
+    return;
+}
+
+// GLV: k * P = k1 * P + k2 * phi(P) with half length k1, k2 processed with
+// a joint fixed window, so the doubling chain is half as long. The table for
+// phi(P) is derived from the table for P with one multiplication per entry
+void mpECP_scalar_mul_glv(mpECP_t rpt, mpECP_t pt, mpFp_t sc, int w) {
+    int i, j, tsz, even[2], neg[2];
+    mp_size_t nlimbs;
+    mp_limb_t kl[2][_MPFP_MAX_LIMBS];
+    mp_limb_t *kp[2];
+    mpz_t k, kk[2];
+    mpECP_t R, Q;
+    struct _p_mpECP_t *T[2];
+    mpECurve_ptr cvp;
+
+    cvp = pt->cvp;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, cvp->n) == 0);
+    if ((cvp->glv.enabled == 0) || (w < 2)) {
+        mpECP_scalar_mul_window(rpt, pt, sc, w);
+        return;
+    }
+    assert(w <= _MPECP_MAX_WINDOW_BITS);
+    if (pt->is_neutral != 0) {
+        mpECP_set_neutral(rpt, cvp);
+        return;
+    }
+    mpz_init(k);
+    mpz_init(kk[0]);
+    mpz_init(kk[1]);
+    mpz_set_mpFp(k, sc);
+    _mpECurve_glv_decompose(kk[0], kk[1], k, cvp);
+    nlimbs = sc->fp->psize;
+    for (j = 0; j < 2; j++) {
+        neg[j] = (mpz_sgn(kk[j]) < 0);
+        mpz_abs(kk[j], kk[j]);
+        assert(mpz_sizeinbase(kk[j], 2) <= cvp->glv.bits);
+        even[j] = _mpECP_limbs_odd(kl[j], nlimbs, kk[j]);
+        kp[j] = kl[j];
+    }
+
+    tsz = 1 << (w - 1);
+    mpECP_init(R, cvp);
+    mpECP_init(Q, cvp);
+    // T[0] = odd multiples of +/-P, T[1] = phi(T[0]) with sign of k2
+    mpECP_set(Q, pt);
+    _mpECP_cneg(Q, neg[0]);
+    for (j = 0; j < 2; j++) {
+        T[j] = (struct _p_mpECP_t *)malloc(tsz * sizeof(struct _p_mpECP_t));
+        assert(T[j] != NULL);
+    }
+    _mpECP_odd_multiples(T[0], tsz, Q);
+    for (i = 0; i < tsz; i++) {
+        mpECP_init(&T[1][i], cvp);
+        _mpECP_glv_phi(&T[1][i], &T[0][i]);
+        _mpECP_cneg(&T[1][i], neg[0] ^ neg[1]);
+    }
+    _mpECP_straus_ct(R, T, kp, NULL, nlimbs, 2, w, cvp->glv.bits, 0);
+
+    // k1, k2 were forced odd, remove the extra +/-P, +/-phi(P)
+    for (j = 0; j < 2; j++) {
+        mpECP_sub(Q, R, &T[j][0]);
+        _mpECP_cmov(R, Q, even[j]);
+    }
+    mpECP_set(rpt, R);
+
+    _mpECP_odd_multiples_clear(T[1], tsz);
+    _mpECP_odd_multiples_clear(T[0], tsz);
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    mpz_clear(kk[1]);
+    mpz_clear(kk[0]);
+    mpz_clear(k);
+    return;
+}
+
+// tables are built once, so a larger window than for a single multiply pays
+static int _mpECP_default_precomp_window_bits(mpECurve_ptr cvp) {
+    if (_MPECP_WINDOW_BITS != 0) return _MPECP_WINDOW_BITS;
+    if (cvp->glv.enabled != 0) return 5;
+    return 6;
+}
+
+void mpECP_precomp_init(mpECP_precomp_t pc, mpECP_t pt, int w) {
+    int i, j;
+    mpECurve_ptr cvp;
+
+    cvp = pt->cvp;
+    if (w == 0) w = _mpECP_default_precomp_window_bits(cvp);
+    assert((w >= 2) && (w <= _MPECP_MAX_WINDOW_BITS));
+    pc->window_bits = w;
+    pc->tsz = 1 << (w - 1);
+    pc->ntables = (cvp->glv.enabled != 0) ? 2 : 1;
+    pc->cvp = cvp;
+    pc->is_neutral = pt->is_neutral;
+    pc->T[0] = NULL;
+    pc->T[1] = NULL;
+    if (pt->is_neutral != 0) {
+        pc->ntables = 0;
+        pc->affine = 0;
+        return;
+    }
+    pc->T[0] = (struct _p_mpECP_t *)malloc(pc->tsz * sizeof(struct _p_mpECP_t));
+    assert(pc->T[0] != NULL);
+    _mpECP_odd_multiples(pc->T[0], pc->tsz, pt);
+    _mpECP_batch_to_affine(pc->T[0], pc->tsz);
+    if (pc->ntables == 2) {
+        // phi keeps affine points affine
+        pc->T[1] = (struct _p_mpECP_t *)malloc(pc->tsz * sizeof(struct _p_mpECP_t));
+        assert(pc->T[1] != NULL);
+        for (i = 0; i < pc->tsz; i++) {
+            mpECP_init(&pc->T[1][i], cvp);
+            _mpECP_glv_phi(&pc->T[1][i], &pc->T[0][i]);
+        }
+    }
+    // small order points may have neutral multiples, no mixed additions then
+    pc->affine = 1;
+    for (j = 0; j < pc->ntables; j++) {
+        for (i = 0; i < pc->tsz; i++) {
+            if ((pc->T[j][i].is_neutral != 0) || (mpFp_cmp_ui(pc->T[j][i].z, 1) != 0)) {
+                pc->affine = 0;
+            }
+        }
+    }
+    return;
+}
+
+void mpECP_precomp_clear(mpECP_precomp_t pc) {
+    int j;
+    for (j = 0; j < pc->ntables; j++) {
+        _mpECP_odd_multiples_clear(pc->T[j], pc->tsz);
+        pc->T[j] = NULL;
+    }
+    pc->ntables = 0;
+    pc->cvp = NULL;
+    return;
+}
+
+void mpECP_scalar_mul_precomp(mpECP_t rpt, mpECP_precomp_t pc, mpFp_t sc) {
+    int j, nbits, even[2], neg[2];
+    mp_size_t nlimbs;
+    mp_limb_t kl[2][_MPFP_MAX_LIMBS];
+    mp_limb_t *kp[2];
+    mpz_t k, kk[2];
+    mpECP_t R, Q;
+    mpECurve_ptr cvp;
+
+    cvp = pc->cvp;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, cvp->n) == 0);
+    if (pc->is_neutral != 0) {
+        mpECP_set_neutral(rpt, cvp);
+        return;
+    }
+    mpz_init(k);
+    mpz_init(kk[0]);
+    mpz_init(kk[1]);
+    mpz_set_mpFp(k, sc);
+    if (pc->ntables == 2) {
+        _mpECurve_glv_decompose(kk[0], kk[1], k, cvp);
+        nbits = cvp->glv.bits;
+    } else {
+        mpz_set(kk[0], k);
+        nbits = _mpECP_scalar_bits(cvp);
+    }
+    nlimbs = sc->fp->psize;
+    for (j = 0; j < pc->ntables; j++) {
+        neg[j] = (mpz_sgn(kk[j]) < 0);
+        mpz_abs(kk[j], kk[j]);
+        assert(mpz_sizeinbase(kk[j], 2) <= nbits);
+        even[j] = _mpECP_limbs_odd(kl[j], nlimbs, kk[j]);
+        kp[j] = kl[j];
+    }
+
+    mpECP_init(R, cvp);
+    mpECP_init(Q, cvp);
+    _mpECP_straus_ct(R, pc->T, kp, neg, nlimbs, pc->ntables, pc->window_bits,
+        nbits, pc->affine);
+    // scalars were forced odd, remove the extra +/-P (+/-phi(P))
+    for (j = 0; j < pc->ntables; j++) {
+        mpECP_set(Q, &pc->T[j][0]);
+        _mpECP_cneg(Q, neg[j]);
+        mpECP_sub(Q, R, Q);
+        _mpECP_cmov(R, Q, even[j]);
+    }
+    mpECP_set(rpt, R);
+
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    mpz_clear(kk[1]);
+    mpz_clear(kk[0]);
+    mpz_clear(k);
+    return;
+}
+
+void mpECP_scalar_mul_ladder(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    int i, b;
+    mpECP_t R0, R1;
+    mpECP_init(R0, pt->cvp);
+    mpECP_init(R1, pt->cvp);
+    mpECP_set_neutral(R0, pt->cvp);
+    mpECP_set(R1, pt);
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
+    for (i = _mpECP_scalar_bits(pt->cvp) - 1; i >= 0 ; i--) {
+        b = mpFp_tstbit(sc, i);
+        _mpECP_cswap_safe(R0, R1, b);
+        _mpECP_ladder_step(R0, R1);
+        _mpECP_cswap_safe(R0, R1, b);
+    }
+    mpECP_set(rpt, R0);
+    mpECP_clear(R1);
+    mpECP_clear(R0);
+    return;
+}
+
+// x-only ladder step for Montgomery curves in projective (X:Z), u = X/Z,
+// with R1 - R0 = P = (x, 1) fixed and a24 = (A - 2) / 4 (RFC 7748):
+//   R1 <- R0 + R1, R0 <- 2R0, (5M + 4S + 1 multiplication by a24)
+// Exact for R0 = neutral (1:0). t holds 5 temporaries
+static void _mpECP_mo_xladder_step(mpFp_t X0, mpFp_t Z0, mpFp_t X1, mpFp_t Z1,
+        mpFp_t x, mpFp_t a24, mpFp_t *t) {
+    mpFp_add(t[0], X0, Z0);
+    mpFp_sub(t[1], X0, Z0);
+    mpFp_add(t[2], X1, Z1);
+    mpFp_sub(t[3], X1, Z1);
+    mpFp_mul(t[3], t[3], t[0]);             // DA
+    mpFp_mul(t[2], t[2], t[1]);             // CB
+    mpFp_sqr(t[0], t[0]);                   // AA
+    mpFp_sqr(t[1], t[1]);                   // BB
+    // R1 <- R0 + R1
+    mpFp_add(t[4], t[3], t[2]);
+    mpFp_sub(t[3], t[3], t[2]);
+    mpFp_sqr(X1, t[4]);
+    mpFp_sqr(Z1, t[3]);
+    mpFp_mul(Z1, Z1, x);
+    // R0 <- 2R0
+    mpFp_mul(X0, t[0], t[1]);
+    mpFp_sub(t[4], t[0], t[1]);             // E = AA - BB
+    mpFp_mul(t[2], a24, t[4]);
+    mpFp_add(t[2], t[2], t[0]);
+    mpFp_mul(Z0, t[4], t[2]);
+    return;
+}
+
+// native Montgomery scalar multiplication, x-only ladder over all bits of n
+// followed by Okeya-Sakurai y recovery from P, kP = (X0:Z0) and
+// (k+1)P = (X1:Z1). Recovery fails for points of order 2 (y == 0) and when
+// (k+1)P is the neutral element, in which case the generic ladder is used
+static void _mpECP_scalar_mul_mo(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    int i, b;
+    mpFp_t x, y, X0, Z0, X1, Z1;
+    mpFp_t t[5];
+    mpECurve_ptr cvp = pt->cvp;
+
+    for (i = 0; i < 5; i++) {
+        mpFp_init_fp(t[i], cvp->fp);
+    }
+    mpFp_init_fp(x, cvp->fp);
+    mpFp_init_fp(y, cvp->fp);
+    mpFp_init_fp(X0, cvp->fp);
+    mpFp_init_fp(Z0, cvp->fp);
+    mpFp_init_fp(X1, cvp->fp);
+    mpFp_init_fp(Z1, cvp->fp);
+
+    mpFp_inv(t[0], pt->z);
+    mpFp_mul(x, pt->x, t[0]);
+    mpFp_mul(y, pt->y, t[0]);
+    mpFp_set_ui_fp(X0, 1, cvp->fp);
+    mpFp_set_ui_fp(Z0, 0, cvp->fp);
+    mpFp_set(X1, x);
+    mpFp_set_ui_fp(Z1, 1, cvp->fp);
+    for (i = _mpECP_scalar_bits(cvp) - 1; i >= 0 ; i--) {
+        b = mpFp_tstbit(sc, i);
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Z0, Z1, b);
+        _mpECP_mo_xladder_step(X0, Z0, X1, Z1, x, cvp->coeff.mo.a24, t);
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Z0, Z1, b);
+    }
+
+    if (mpFp_cmp_ui(Z0, 0) == 0) {
+        mpECP_set_neutral(rpt, cvp);
+    } else if ((mpFp_cmp_ui(Z1, 0) == 0) || (mpFp_cmp_ui(y, 0) == 0)) {
+        mpECP_scalar_mul_ladder(rpt, pt, sc);
+    } else {
+        // t[2] <- (X0 - x*Z0)**2 * X1
+        mpFp_mul(t[0], x, Z0);
+        mpFp_add(t[1], X0, t[0]);
+        mpFp_sub(t[2], X0, t[0]);
+        mpFp_sqr(t[2], t[2]);
+        mpFp_mul(t[2], t[2], X1);
+        // t[1] <- ((X0 + x*Z0 + 2A*Z0)(x*X0 + Z0) - 2A*Z0**2) * Z1
+        mpFp_add(t[0], cvp->coeff.mo.A, cvp->coeff.mo.A);
+        mpFp_mul(t[0], t[0], Z0);
+        mpFp_add(t[1], t[1], t[0]);
+        mpFp_mul(t[3], x, X0);
+        mpFp_add(t[3], t[3], Z0);
+        mpFp_mul(t[1], t[1], t[3]);
+        mpFp_mul(t[0], t[0], Z0);
+        mpFp_sub(t[1], t[1], t[0]);
+        mpFp_mul(t[1], t[1], Z1);
+        // t[0] <- 2B * y * Z0 * Z1
+        mpFp_mul(t[0], cvp->coeff.mo.B, y);
+        mpFp_add(t[0], t[0], t[0]);
+        mpFp_mul(t[0], t[0], Z0);
+        mpFp_mul(t[0], t[0], Z1);
+        if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+        rpt->cvp = cvp;
+        rpt->is_neutral = 0;
+        mpFp_mul(rpt->x, t[0], X0);
+        mpFp_sub(rpt->y, t[1], t[2]);
+        mpFp_mul(rpt->z, t[0], Z0);
+    }
+
+    mpFp_clear(Z1);
+    mpFp_clear(X1);
+    mpFp_clear(Z0);
+    mpFp_clear(X0);
+    mpFp_clear(y);
+    mpFp_clear(x);
+    for (i = 0; i < 5; i++) {
+        mpFp_clear(t[i]);
+    }
+    return;
+}
+
+// co-Z Montgomery ladder (Goundar, Joye, Miyaji) for short Weierstrass
+// curves. R0 and R1 are kept in Jacobian coordinates sharing Z, so only X
+// and Y are updated and each bit costs one XYcZ-ADDC and one XYcZ-ADD
+// (9M + 5S, +2M to track Z) instead of a general add plus a double.
+//
+// XYcZ-ADD: (X1,Y1) = P, (X2,Y2) = Q -> (X2,Y2) = P + Q, (X1,Y1) = P with
+// the new common Z. lambda receives the Z scaling factor X2 - X1
+static void _mpECP_coz_add(mpFp_t X1, mpFp_t Y1, mpFp_t X2, mpFp_t Y2,
+        mpFp_t lambda, mpFp_t *t) {
+    mpFp_sub(lambda, X2, X1);
+    mpFp_sqr(t[0], lambda);
+    mpFp_mul(t[1], X1, t[0]);               // W1
+    mpFp_mul(t[2], X2, t[0]);               // W2
+    mpFp_sub(t[3], Y2, Y1);
+    mpFp_sub(t[0], t[2], t[1]);
+    mpFp_mul(Y1, Y1, t[0]);                 // A1 = Y1 * (W2 - W1)
+    mpFp_sqr(t[0], t[3]);
+    mpFp_sub(t[0], t[0], t[1]);
+    mpFp_sub(X2, t[0], t[2]);               // X3 = D - W1 - W2
+    mpFp_sub(t[0], t[1], X2);
+    mpFp_mul(t[0], t[0], t[3]);
+    mpFp_sub(Y2, t[0], Y1);                 // Y3 = (Y2 - Y1)(W1 - X3) - A1
+    mpFp_set(X1, t[1]);
+    return;
+}
+
+// XYcZ-ADDC: (X1,Y1) = P, (X2,Y2) = Q -> (X2,Y2) = P + Q, (X1,Y1) = P - Q
+static void _mpECP_coz_addc(mpFp_t X1, mpFp_t Y1, mpFp_t X2, mpFp_t Y2,
+        mpFp_t lambda, mpFp_t *t) {
+    mpFp_sub(lambda, X2, X1);
+    mpFp_sqr(t[0], lambda);
+    mpFp_mul(t[1], X1, t[0]);               // W1
+    mpFp_mul(t[2], X2, t[0]);               // W2
+    mpFp_sub(t[3], Y2, Y1);
+    mpFp_add(t[4], Y2, Y1);
+    mpFp_sub(t[0], t[2], t[1]);
+    mpFp_mul(Y1, Y1, t[0]);                 // A1 = Y1 * (W2 - W1)
+    // P + Q
+    mpFp_sqr(t[0], t[3]);
+    mpFp_sub(t[0], t[0], t[1]);
+    mpFp_sub(X2, t[0], t[2]);
+    mpFp_sub(t[0], t[1], X2);
+    mpFp_mul(t[0], t[0], t[3]);
+    mpFp_sub(Y2, t[0], Y1);
+    // P - Q, i.e. Q = (X2, -Y2)
+    mpFp_sqr(t[0], t[4]);
+    mpFp_sub(t[0], t[0], t[1]);
+    mpFp_sub(X1, t[0], t[2]);
+    mpFp_sub(t[0], X1, t[1]);
+    mpFp_mul(t[0], t[0], t[4]);
+    mpFp_sub(Y1, t[0], Y1);
+    return;
+}
+
+// the ladder starts from (P, 2P), so the scalar needs a known leading bit.
+// k' = k + N or k + 2N, N = h*n the order of the group, has exactly
+// bits(N) + 1 bits and k'P == kP for every point on the curve. The ladder
+// falls back to mpECP_scalar_mul_ladder for other curve types and when the
+// co-Z state degenerates (common Z == 0), which only happens when a partial
+// result is the neutral element, e.g. kP == 0. Montgomery curves use the
+// native x-only ladder (_mpECP_scalar_mul_mo)
+void mpECP_scalar_mul_coz(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    int i, b, nbits;
+    mpz_t k, N;
+    mpFp_t X0, Y0, X1, Y1, Z, l;
+    mpFp_t t[5];
+    mpECurve_ptr cvp = pt->cvp;
+
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, cvp->n) == 0);
+    if ((cvp->type != EQTypeShortWeierstrass) &&
+        (cvp->type != EQTypeMontgomery)) {
+        mpECP_scalar_mul_ladder(rpt, pt, sc);
+        return;
+    }
+    if (pt->is_neutral != 0) {
+        mpECP_set_neutral(rpt, cvp);
+        return;
+    }
+    if (cvp->type == EQTypeMontgomery) {
+        _mpECP_scalar_mul_mo(rpt, pt, sc);
+        return;
+    }
+
+    mpz_init(k);
+    mpz_init(N);
+    mpz_mul(N, cvp->n, cvp->h);
+    nbits = (int)mpz_sizeinbase(N, 2);
+    mpz_set_mpFp(k, sc);
+    mpz_add(k, k, N);
+    mpz_addmul_ui(k, N, (unsigned long)(1 - mpz_tstbit(k, nbits)));
+    assert(mpz_sizeinbase(k, 2) == (size_t)(nbits + 1));
+
+    mpFp_init_fp(X0, cvp->fp);
+    mpFp_init_fp(Y0, cvp->fp);
+    mpFp_init_fp(X1, cvp->fp);
+    mpFp_init_fp(Y1, cvp->fp);
+    mpFp_init_fp(Z, cvp->fp);
+    mpFp_init_fp(l, cvp->fp);
+    for (i = 0; i < 5; i++) {
+        mpFp_init_fp(t[i], cvp->fp);
+    }
+
+    // affine P = (x, y)
+    mpFp_inv(t[0], pt->z);
+    mpFp_mul(X1, pt->x, t[0]);
+    mpFp_mul(Y1, pt->y, t[0]);
+    // XYcZ-IDBL: R1 = 2P, R0 = P, both with Z = 2y
+    mpFp_add(Z, Y1, Y1);
+    mpFp_sqr(t[0], Y1);
+    mpFp_mul(t[1], X1, t[0]);
+    mpFp_add(t[1], t[1], t[1]);
+    mpFp_add(X0, t[1], t[1]);               // S = 4xy**2
+    mpFp_sqr(t[0], t[0]);
+    mpFp_add(t[0], t[0], t[0]);
+    mpFp_add(t[0], t[0], t[0]);
+    mpFp_add(Y0, t[0], t[0]);               // 8y**4
+    mpFp_sqr(t[2], X1);
+    mpFp_add(t[3], t[2], t[2]);
+    mpFp_add(t[2], t[2], t[3]);
+    mpFp_add(t[2], t[2], cvp->ws_a);        // M = 3x**2 + a
+    mpFp_sqr(t[3], t[2]);
+    mpFp_sub(t[3], t[3], X0);
+    mpFp_sub(X1, t[3], X0);                 // X(2P) = M**2 - 2S
+    mpFp_sub(t[3], X0, X1);
+    mpFp_mul(t[3], t[3], t[2]);
+    mpFp_sub(Y1, t[3], Y0);                 // Y(2P) = M(S - X) - 8y**4
+
+    for (i = nbits - 1; i >= 0; i--) {
+        b = mpz_tstbit(k, i);
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Y0, Y1, b);
+        // R1 <- Rb + R(1-b), R0 <- Rb - R(1-b) = +/-P
+        _mpECP_coz_addc(X0, Y0, X1, Y1, l, t);
+        mpFp_mul(Z, Z, l);
+        // R0 <- 2Rb, R1 <- Rb + R(1-b)
+        _mpECP_coz_add(X1, Y1, X0, Y0, l, t);
+        mpFp_mul(Z, Z, l);
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Y0, Y1, b);
+    }
+
+    if (mpFp_cmp_ui(Z, 0) == 0) {
+        mpECP_scalar_mul_ladder(rpt, pt, sc);
+    } else {
+        // Jacobian (X, Y, Z) -> projective (XZ, Y, Z**3)
+        if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
+        rpt->cvp = cvp;
+        rpt->is_neutral = 0;
+        mpFp_mul(t[0], X0, Z);
+        mpFp_sqr(t[1], Z);
+        mpFp_mul(t[1], t[1], Z);
+        mpFp_set(rpt->x, t[0]);
+        mpFp_set(rpt->y, Y0);
+        mpFp_set(rpt->z, t[1]);
+    }
+
+    for (i = 0; i < 5; i++) {
+        mpFp_clear(t[i]);
+    }
+    mpFp_clear(l);
+    mpFp_clear(Z);
+    mpFp_clear(Y1);
+    mpFp_clear(X1);
+    mpFp_clear(Y0);
+    mpFp_clear(X0);
+    mpz_clear(N);
+    mpz_clear(k);
+    return;
+}
+
+// x-only differential ladder (Brier-Joye) for short Weierstrass curves in
+// projective (X:Z), x = X/Z. With R1 - R0 = P = (x, 1) fixed:
+//   2R: X = (X**2 - aZ**2)**2 - 8bXZ**3, Z = 4Z(X**3 + aXZ**2 + bZ**3)
+//   R0 + R1: X = 2(X0Z1 + X1Z0)(X0X1 + aZ0Z1) + 4b(Z0Z1)**2 - x(X0Z1 - X1Z0)**2
+//            Z = (X0Z1 - X1Z0)**2
+// The formulas are exact for R0 = neutral (1:0), so the ladder runs over all
+// bits of n from the neutral element. t holds 6 temporaries
+static void _mpECP_xladder_step(mpFp_t X0, mpFp_t Z0, mpFp_t X1, mpFp_t Z1,
+        mpFp_t x, mpFp_t b4, mpECurve_ptr cvp, mpFp_t *t) {
+    mpFp_ptr a = cvp->coeff.ws.a;
+    // R1 <- R0 + R1
+    mpFp_mul(t[0], X0, Z1);
+    mpFp_mul(t[1], X1, Z0);
+    mpFp_mul(t[2], X0, X1);
+    mpFp_mul(t[3], Z0, Z1);
+    mpFp_sub(t[4], t[0], t[1]);
+    mpFp_add(t[0], t[0], t[1]);
+    mpFp_mul(t[1], a, t[3]);
+    mpFp_add(t[2], t[2], t[1]);
+    mpFp_mul(t[0], t[0], t[2]);
+    mpFp_add(t[0], t[0], t[0]);
+    mpFp_sqr(t[3], t[3]);
+    mpFp_mul(t[3], t[3], b4);
+    mpFp_add(t[0], t[0], t[3]);
+    mpFp_sqr(Z1, t[4]);
+    mpFp_mul(t[4], Z1, x);
+    mpFp_sub(X1, t[0], t[4]);
+    // R0 <- 2R0
+    mpFp_sqr(t[0], X0);
+    mpFp_sqr(t[1], Z0);
+    mpFp_mul(t[2], a, t[1]);
+    mpFp_sub(t[3], t[0], t[2]);
+    mpFp_add(t[0], t[0], t[2]);
+    mpFp_mul(t[0], t[0], X0);               // X**3 + aXZ**2
+    mpFp_mul(t[1], t[1], Z0);               // Z**3
+    mpFp_mul(t[2], t[1], X0);
+    mpFp_mul(t[2], t[2], b4);               // 4bXZ**3
+    mpFp_mul(t[5], t[1], cvp->coeff.ws.b);
+    mpFp_add(t[0], t[0], t[5]);
+    mpFp_mul(t[0], t[0], Z0);
+    mpFp_add(t[0], t[0], t[0]);
+    mpFp_add(Z0, t[0], t[0]);
+    mpFp_sqr(t[3], t[3]);
+    mpFp_sub(t[3], t[3], t[2]);
+    mpFp_sub(X0, t[3], t[2]);
+    return;
+}
+
+// x coordinate of sc * P given only x of P (e.g. ECDH). x is checked to be
+// the coordinate of a point on the curve (not on the twist) using the
+// Legendre symbol of x**3 + ax + b (Montgomery: (x**3 + Ax**2 + x) / B), no
+// square root is computed. Returns nonzero if the curve is not short
+// Weierstrass or Montgomery, x is not on the curve or the result is the
+// neutral element (which has no x)
+int mpECP_scalar_mul_x(mpFp_t rx, mpFp_t x, mpFp_t sc, mpECurve_t cv) {
+    int i, b, status;
+    mpz_t r;
+    mpFp_t X0, Z0, X1, Z1, b4;
+    mpFp_t t[6];
+
+    if ((cv->type != EQTypeShortWeierstrass) &&
+        (cv->type != EQTypeMontgomery)) return -1;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, cv->n) == 0);
+    for (i = 0; i < 6; i++) {
+        mpFp_init_fp(t[i], cv->fp);
+    }
+    // x**3 + ax + b must be a square (or 0)
+    mpz_init(r);
+    if (cv->type == EQTypeMontgomery) {
+        mpFp_add(t[0], x, cv->coeff.mo.A);
+        mpFp_mul(t[0], t[0], x);
+        mpFp_add_ui(t[0], t[0], 1);
+        mpFp_mul(t[0], t[0], x);
+        mpFp_mul(t[0], t[0], cv->coeff.mo.Binv);
+    } else {
+        mpFp_sqr(t[0], x);
+        mpFp_add(t[0], t[0], cv->coeff.ws.a);
+        mpFp_mul(t[0], t[0], x);
+        mpFp_add(t[0], t[0], cv->coeff.ws.b);
+    }
+    mpz_set_mpFp(r, t[0]);
+    if (mpz_legendre(r, cv->fp->p) < 0) {
+        mpz_clear(r);
+        for (i = 0; i < 6; i++) {
+            mpFp_clear(t[i]);
+        }
+        return -1;
+    }
+    mpz_clear(r);
+
+    mpFp_init_fp(X0, cv->fp);
+    mpFp_init_fp(Z0, cv->fp);
+    mpFp_init_fp(X1, cv->fp);
+    mpFp_init_fp(Z1, cv->fp);
+    mpFp_init_fp(b4, cv->fp);
+    if (cv->type == EQTypeShortWeierstrass) {
+        mpFp_add(b4, cv->coeff.ws.b, cv->coeff.ws.b);
+        mpFp_add(b4, b4, b4);
+    }
+    mpFp_set_ui_fp(X0, 1, cv->fp);
+    mpFp_set_ui_fp(Z0, 0, cv->fp);
+    mpFp_set(X1, x);
+    mpFp_set_ui_fp(Z1, 1, cv->fp);
+    for (i = _mpECP_scalar_bits(cv) - 1; i >= 0 ; i--) {
+        b = mpFp_tstbit(sc, i);
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Z0, Z1, b);
+        if (cv->type == EQTypeMontgomery) {
+            _mpECP_mo_xladder_step(X0, Z0, X1, Z1, x, cv->coeff.mo.a24, t);
+        } else {
+            _mpECP_xladder_step(X0, Z0, X1, Z1, x, b4, cv, t);
+        }
+        mpFp_cswap(X0, X1, b);
+        mpFp_cswap(Z0, Z1, b);
+    }
+    status = mpFp_inv(t[0], Z0);
+    if (status == 0) {
+        mpFp_mul(rx, X0, t[0]);
+    }
+
+    mpFp_clear(b4);
+    mpFp_clear(Z1);
+    mpFp_clear(X1);
+    mpFp_clear(Z0);
+    mpFp_clear(X0);
+    for (i = 0; i < 6; i++) {
+        mpFp_clear(t[i]);
+    }
+    return status;
+}
+
+// x only scalar multiplication from an encoded point (as accepted by
+// mpECP_set_bytes). Only x is read, so compressed input needs no square
+// root. The result x is written to rx as a big endian integer of
+// (bits + 7) / 8 bytes. Returns nonzero on error (see mpECP_scalar_mul_x)
+int mpECP_scalar_mul_x_bytes(unsigned char *rx, unsigned char *b, int blen,
+        mpFp_t sc, mpECurve_t cv) {
+    int bytes, status;
+    size_t xlen;
+    mpz_t xz;
+    mpFp_t x;
+
+    bytes = _bytelen(cv->bits);
+    if (blen < (1 + bytes)) return -1;
+    switch (b[0]) {
+        case 2:
+        case 3:
+            if (blen != (1 + bytes)) return -1;
+            break;
+        case 4:
+            if (blen != (1 + (2 * bytes))) return -1;
+            break;
+        default:
+            return -1;
+    }
+    mpz_init(xz);
+    mpFp_init_fp(x, cv->fp);
+    mpz_import(xz, bytes, 1, sizeof(unsigned char), 1, 0, &b[1]);
+    if (mpz_cmp(xz, cv->fp->p) >= 0) {
+        status = -1;
+    } else {
+        mpFp_set_mpz_fp(x, xz, cv->fp);
+        status = mpECP_scalar_mul_x(x, x, sc, cv);
+    }
+    if (status == 0) {
+        mpz_set_mpFp(xz, x);
+        xlen = (mpz_sgn(xz) == 0) ? 0 : ((mpz_sizeinbase(xz, 2) + 7) >> 3);
+        assert(xlen <= (size_t)bytes);
+        memset(rx, 0, bytes - xlen);
+        mpz_export(rx + (bytes - xlen), NULL, 1, sizeof(unsigned char), 1, 0, xz);
+    }
+    mpFp_clear(x);
+    mpz_clear(xz);
+    return status;
+}
+
+void mpECP_scalar_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc) {
+    mpFp_t s;
+    mpFp_init_fp(s, pt->cvp->fp);
+    mpFp_set_mpz(s, sc, pt->cvp->n);
+    mpECP_scalar_mul(rpt, pt, s);
+    mpFp_clear(s);
+    return;
+}
+
+// width-w non-adjacent form of k >= 0, digits are zero or odd with
+// |d| < 2**(w-1) and at most one nonzero digit in any w consecutive. Returns
+// the number of digits (least significant first)
+static int _mpECP_wnaf(signed char *naf, mpz_t k, int w) {
+    int i, d;
+    mpz_t t;
+    mpz_init_set(t, k);
+    i = 0;
+    while (mpz_sgn(t) > 0) {
+        if (mpz_odd_p(t)) {
+            d = (int)mpz_fdiv_ui(t, 1UL << w);
+            if (d >= (1 << (w - 1))) {
+                d -= (1 << w);
+                mpz_add_ui(t, t, (unsigned long)(-d));
+            } else {
+                mpz_sub_ui(t, t, (unsigned long)d);
             }
-            break;
-        case EQTypeEdwards: {
-                // 2007 Bernstein-Lange formula
-                // http://www.hyperelliptic.org/EFD/g1p/auto-edwards-projective.html#addition-add-2007-bl
-                // A = Z1*Z2
-                // B = A**2
-                // C = X1*X2
-                // D = Y1*Y2
-                // E = d*C*D
-                // F = B-E
-                // G = B+E
-                // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
-                // Y3 = A*G*(D-C)
-                // Z3 = c*F*G
-                mpFp_t A, B, C, D, E, F, G;
-#ifdef _MPECP_MPFP_NOMALLOC
-                __local_limb_t lA, lB, lC, lD, lE, lF, lG;
-                A->i->_mp_d = lA; A->i->_mp_size = 0; A->i->_mp_alloc = _MPFP_MAX_LIMBS; A->fp = pt1->cvp->fp;
-                B->i->_mp_d = lB; B->i->_mp_size = 0; B->i->_mp_alloc = _MPFP_MAX_LIMBS; B->fp = pt1->cvp->fp;
-                C->i->_mp_d = lC; C->i->_mp_size = 0; C->i->_mp_alloc = _MPFP_MAX_LIMBS; C->fp = pt1->cvp->fp;
-                D->i->_mp_d = lD; D->i->_mp_size = 0; D->i->_mp_alloc = _MPFP_MAX_LIMBS; D->fp = pt1->cvp->fp;
-                E->i->_mp_d = lE; E->i->_mp_size = 0; E->i->_mp_alloc = _MPFP_MAX_LIMBS; E->fp = pt1->cvp->fp;
-                F->i->_mp_d = lF; F->i->_mp_size = 0; F->i->_mp_alloc = _MPFP_MAX_LIMBS; F->fp = pt1->cvp->fp;
-                G->i->_mp_d = lG; G->i->_mp_size = 0; G->i->_mp_alloc = _MPFP_MAX_LIMBS; G->fp = pt1->cvp->fp;
-#else
-                mpFp_init_fp(A, pt1->cvp->fp);
-                mpFp_init_fp(B, pt1->cvp->fp);
-                mpFp_init_fp(C, pt1->cvp->fp);
-                mpFp_init_fp(D, pt1->cvp->fp);
-                mpFp_init_fp(E, pt1->cvp->fp);
-                mpFp_init_fp(F, pt1->cvp->fp);
-                mpFp_init_fp(G, pt1->cvp->fp);
-#endif
+        } else {
+            d = 0;
+        }
+        naf[i] = (signed char)d;
+        i += 1;
+        mpz_tdiv_q_2exp(t, t, 1);
+    }
+    mpz_clear(t);
+    return i;
+}
 
-                // A = Z1*Z2
-                mpFp_mul(A, pt1->z, pt2->z);
-                // B = A**2
-                mpFp_pow_ui(B, A, 2);
-                // C = X1*X2
-                mpFp_mul(C, pt1->x, pt2->x);
-                // D = Y1*Y2
-                mpFp_mul(D, pt1->y, pt2->y);
-                // E = d*C*D
-                mpFp_mul(E, pt1->cvp->coeff.ed.d, C);
-                mpFp_mul(E, E, D);
-                // F = B-E
-                mpFp_sub(F, B, E);
-                // G = B+E
-                mpFp_add(G, B, E);
-                // B, E used as temp below here
-                // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
-                mpFp_add(B, pt1->x, pt1->y);
-                mpFp_add(E, pt2->x, pt2->y);
-                mpFp_mul(B, B, E);
-                mpFp_sub(B, B, C);
-                mpFp_sub(B, B, D);
-                mpFp_mul(B, B, F);
-                mpFp_mul(rpt->x, B, A);
-                // Y3 = A*G*(D-C)
-                mpFp_sub(B, D, C);
-                mpFp_mul(B, B, G);
-                mpFp_mul(rpt->y, B, A);
-                // Z3 = c*F*G
-                mpFp_mul(B, pt1->cvp->coeff.ed.c, G);
-                mpFp_mul(rpt->z, B, F);
-                mpECurve_set(rpt->cvp, pt1->cvp);
-                rpt->is_neutral = 0;
+// wNAF width for a scalar of nbits, trading table size (2**(w-2) points)
+// against the density of additions (1/(w+1))
+static int _mpECP_wnaf_window_bits(int nbits) {
+    if (nbits < 16) return 2;
+    if (nbits < 64) return 3;
+    if (nbits < 160) return 4;
+    return 5;
+}
 
-#ifndef _MPECP_MPFP_NOMALLOC
-                mpFp_clear(G);
-                mpFp_clear(F);
-                mpFp_clear(E);
-                mpFp_clear(D);
-                mpFp_clear(C);
-                mpFp_clear(B);
-                mpFp_clear(A);
-#endif
-                return;
+// interleaved wNAF (variable time), rpt = sum(k[j] * P[j]) for j < m. All
+// odd multiple tables are normalized together with a single inversion and
+// the scalars share one doubling chain starting at the longest scalar. The
+// chain uses the public formulas of the curve (affine table entries are the
+// same in any coordinates, so only the result is converted)
+static void _mpECP_straus_vartime(mpECP_t rpt, struct _p_mpECP_t *P, mpz_t *k, int m) {
+    int i, j, nd, ntot, started;
+    int *w, *len, *toff;
+    signed char **naf;
+    mpz_t t;
+    mpECP_t R, Q;
+    struct _p_mpECP_t *T;
+    mpECurve_ptr cvp;
+
+    cvp = P[0].cvp;
+    w = (int *)malloc(m * sizeof(int));
+    len = (int *)malloc(m * sizeof(int));
+    toff = (int *)malloc(m * sizeof(int));
+    naf = (signed char **)malloc(m * sizeof(signed char *));
+    assert((w != NULL) && (len != NULL) && (toff != NULL) && (naf != NULL));
+    mpz_init(t);
+    nd = 0;
+    ntot = 0;
+    for (j = 0; j < m; j++) {
+        mpz_abs(t, k[j]);
+        naf[j] = NULL;
+        len[j] = 0;
+        toff[j] = ntot;
+        if ((mpz_sgn(t) == 0) || (P[j].is_neutral != 0)) {
+            w[j] = 0;
+            continue;
+        }
+        w[j] = _mpECP_wnaf_window_bits(mpz_sizeinbase(t, 2));
+        naf[j] = (signed char *)malloc((mpz_sizeinbase(t, 2) + 1) * sizeof(signed char));
+        assert(naf[j] != NULL);
+        len[j] = _mpECP_wnaf(naf[j], t, w[j]);
+        if (mpz_sgn(k[j]) < 0) {
+            for (i = 0; i < len[j]; i++) {
+                naf[j][i] = -naf[j][i];
             }
-            break;
-        case EQTypeTwistedEdwards: {
-                // 2008 Bernstein–Birkner–Joye–Lange–Peters formula
-                // http://www.hyperelliptic.org/EFD/g1p/auto-twisted-projective.html#addition-add-2008-bbjlp
-                // A = Z1*Z2
-                // B = A**2
-                // C = X1*X2
-                // D = Y1*Y2
-                // E = d*C*D
-                // F = B-E
-                // G = B+E
-                // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
-                // Y3 = A*G*(D-a*C)
-                // Z3 = F*G
-                mpFp_t A, B, C, D, E, F, G;
-#ifdef _MPECP_MPFP_NOMALLOC
-                __local_limb_t lA, lB, lC, lD, lE, lF, lG;
-                A->i->_mp_d = lA; A->i->_mp_size = 0; A->i->_mp_alloc = _MPFP_MAX_LIMBS; A->fp = pt1->cvp->fp;
-                B->i->_mp_d = lB; B->i->_mp_size = 0; B->i->_mp_alloc = _MPFP_MAX_LIMBS; B->fp = pt1->cvp->fp;
-                C->i->_mp_d = lC; C->i->_mp_size = 0; C->i->_mp_alloc = _MPFP_MAX_LIMBS; C->fp = pt1->cvp->fp;
-                D->i->_mp_d = lD; D->i->_mp_size = 0; D->i->_mp_alloc = _MPFP_MAX_LIMBS; D->fp = pt1->cvp->fp;
-                E->i->_mp_d = lE; E->i->_mp_size = 0; E->i->_mp_alloc = _MPFP_MAX_LIMBS; E->fp = pt1->cvp->fp;
-                F->i->_mp_d = lF; F->i->_mp_size = 0; F->i->_mp_alloc = _MPFP_MAX_LIMBS; F->fp = pt1->cvp->fp;
-                G->i->_mp_d = lG; G->i->_mp_size = 0; G->i->_mp_alloc = _MPFP_MAX_LIMBS; G->fp = pt1->cvp->fp;
-#else
-                mpFp_init_fp(A, pt1->cvp->fp);
-                mpFp_init_fp(B, pt1->cvp->fp);
-                mpFp_init_fp(C, pt1->cvp->fp);
-                mpFp_init_fp(D, pt1->cvp->fp);
-                mpFp_init_fp(E, pt1->cvp->fp);
-                mpFp_init_fp(F, pt1->cvp->fp);
-                mpFp_init_fp(G, pt1->cvp->fp);
-#endif
+        }
+        if (len[j] > nd) nd = len[j];
+        ntot += 1 << (w[j] - 2);
+    }
 
-                // A = Z1*Z2
-                mpFp_mul(A, pt1->z, pt2->z);
-                // B = A**2
-                mpFp_mul(B, A, A);
-                // C = X1*X2
-                mpFp_mul(C, pt1->x, pt2->x);
-                // D = Y1*Y2
-                mpFp_mul(D, pt1->y, pt2->y);
-                // E = d*C*D
-                mpFp_mul(E, pt1->cvp->coeff.te.d, C);
-                mpFp_mul(E, E, D);
-                // F = B-E
-                mpFp_sub(F, B, E);
-                // G = B+E
-                mpFp_add(G, B, E);
-                // B, E used as temp below here
-                // X3 = A*F*((X1+Y1)*(X2+Y2)-C-D)
-                mpFp_add(B, pt1->x, pt1->y);
-                mpFp_add(E, pt2->x, pt2->y);
-                mpFp_mul(B, B, E);
-                mpFp_sub(B, B, C);
-                mpFp_sub(B, B, D);
-                mpFp_mul(B, B, F);
-                mpFp_mul(rpt->x, B, A);
-                // Y3 = A*G*(D-a*C)
-                mpFp_mul(C, C, pt1->cvp->coeff.te.a);
-                mpFp_sub(B, D, C);
-                mpFp_mul(B, B, G);
-                mpFp_mul(rpt->y, B, A);
-                // Z3 = F*G
-                mpFp_mul(rpt->z, G, F);
-                mpECurve_set(rpt->cvp, pt1->cvp);
-                rpt->is_neutral = 0;
+    mpECP_init(R, cvp);
+    mpECP_init(Q, cvp);
+    mpECP_set_neutral(R, cvp);
+    T = NULL;
+    if (ntot > 0) {
+        T = (struct _p_mpECP_t *)malloc(ntot * sizeof(struct _p_mpECP_t));
+        assert(T != NULL);
+        for (j = 0; j < m; j++) {
+            if (w[j] == 0) continue;
+            _mpECP_odd_multiples(&T[toff[j]], 1 << (w[j] - 2), &P[j]);
+        }
+        _mpECP_batch_to_affine(T, ntot);
+    }
 
-#ifndef _MPECP_MPFP_NOMALLOC
-                mpFp_clear(G);
-                mpFp_clear(F);
-                mpFp_clear(E);
-                mpFp_clear(D);
-                mpFp_clear(C);
-                mpFp_clear(B);
-                mpFp_clear(A);
-#endif
-                return;
+    started = 0;
+    for (i = nd - 1; i >= 0; i--) {
+        if (started != 0) {
+            _mpECP_double_public(R, R);
+        }
+        for (j = 0; j < m; j++) {
+            int d;
+            if (i >= len[j]) continue;
+            d = naf[j][i];
+            if (d == 0) continue;
+            if (d > 0) {
+                mpECP_set(Q, &T[toff[j] + (d >> 1)]);
+            } else {
+                mpECP_neg(Q, &T[toff[j] + ((-d) >> 1)]);
             }
-            break;
-        default:
-            assert(_known_curve_type(pt1->cvp));
+            if (started == 0) {
+                mpECP_set(R, Q);
+                started = 1;
+            } else {
+                _mpECP_add_mixed_public(R, R, Q);
+            }
+        }
     }
-    assert(0);
+    _mpECP_formulas_leave(R);
+    mpECP_set(rpt, R);
+
+    if (T != NULL) {
+        _mpECP_odd_multiples_clear(T, ntot);
+    }
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    for (j = 0; j < m; j++) {
+        if (naf[j] != NULL) free(naf[j]);
+    }
+    mpz_clear(t);
+    free(naf);
+    free(toff);
+    free(len);
+    free(w);
+    return;
 }
 
-void mpECP_double(mpECP_t rpt, mpECP_t pt) {
-    if (pt->is_neutral != 0) {
-        mpECP_set_neutral(rpt, pt->cvp);
+void mpECP_scalar_mul_vartime(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
+    mpz_t k;
+    // scalar should be modulo the order of the curve
+    assert(mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
+    mpz_init(k);
+    mpz_set_mpFp(k, sc);
+    mpECP_scalar_mul_vartime_mpz(rpt, pt, k);
+    mpz_clear(k);
+    return;
+}
+
+void mpECP_scalar_mul_vartime_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc) {
+    struct _p_mpECP_t P[2];
+    mpz_t k[2];
+
+    if (pt->cvp->glv.enabled != 0) {
+        // prime order (h = 1), so reducing modulo n is safe
+        mpz_init(k[0]);
+        mpz_init(k[1]);
+        mpz_mod(k[1], sc, pt->cvp->n);
+        _mpECurve_glv_decompose(k[0], k[1], k[1], pt->cvp);
+        mpECP_init(&P[0], pt->cvp);
+        mpECP_init(&P[1], pt->cvp);
+        mpECP_set(&P[0], pt);
+        _mpECP_glv_phi(&P[1], pt);
+        _mpECP_straus_vartime(rpt, P, k, 2);
+        mpECP_clear(&P[1]);
+        mpECP_clear(&P[0]);
+        mpz_clear(k[1]);
+        mpz_clear(k[0]);
         return;
     }
-    if (rpt->base_bits != 0) _mpECP_base_pts_cleanup(rpt);
-    switch (pt->cvp->type) {
-        case EQTypeMontgomery:
-            // Montgomery curve point internal representation is short-WS
-        case EQTypeShortWeierstrass:
-            // RCB add is complete... fall through and call add
-#ifndef _MPECP_USE_RCB
-            {
-                // 2007 Bernstein-Lange formula
-                // from : http://www.hyperelliptic.org/EFD/g1p/auto-shortw-jacobian.html#doubling-dbl-2007-bl
-                // XX = X1**2
-                // YY = Y1**2
-                // YYYY = YY**2
-                // ZZ = Z1**2
-                // S = 2*((X1+YY)**2-XX-YYYY)
-                // M = 3*XX+a*ZZ**2
-                // T = M**2-2*S
-                // X3 = T
-                // Y3 = M*(S-T)-8*YYYY
-                // Z3 = (Y1+Z1)**2-YY-ZZ
-                mpFp_t XX, YY, YYYY, ZZ, S, M, T;
-                mpFp_init_fp(XX, pt->cvp->fp);
-                mpFp_init_fp(YY, pt->cvp->fp);
-                mpFp_init_fp(YYYY, pt->cvp->fp);
-                mpFp_init_fp(ZZ, pt->cvp->fp);
-                mpFp_init_fp(S, pt->cvp->fp);
-                mpFp_init_fp(M, pt->cvp->fp);
-                mpFp_init_fp(T, pt->cvp->fp);
-                // XX = X1**2
-                mpFp_pow_ui(XX, pt->x, 2);
-                // YY = Y1**2
-                mpFp_pow_ui(YY, pt->y, 2);
-                // YYYY = YY**2
-                mpFp_pow_ui(YYYY, YY, 2);
-                // ZZ = Z1**2
-                mpFp_pow_ui(ZZ, pt->z, 2);
-                // S = 2*((X1+YY)**2-XX-YYYY)
-                mpFp_add(S, pt->x, YY);
-                mpFp_pow_ui(S, S, 2);
-                mpFp_sub(S, S, XX);
-                mpFp_sub(S, S, YYYY);
-                mpFp_mul_ui(S, S, 2);
-                // M = 3*XX+a*ZZ**2
-                mpFp_pow_ui(M, ZZ, 2);
-                if (pt->cvp->type == EQTypeMontgomery) {
-                    mpFp_mul(M, M, pt->cvp->coeff.mo.ws_a);
-                } else {
-                    mpFp_mul(M, M, pt->cvp->coeff.ws.a);
-                }
-                mpFp_mul_ui(T, XX, 3);
-                mpFp_add(M, M, T);
-                // T = M**2-2*S, XX is temp var from here down
-                mpFp_pow_ui(T, M, 2);
-                mpFp_mul_ui(XX, S, 2);
-                mpFp_sub(T, T, XX);
-                // X3 = T
-                mpFp_set(rpt->x, T);
-                // Y3 = M*(S-T)-8*YYYY
-                mpFp_mul_ui(YYYY, YYYY, 8);
-                mpFp_sub(S, S, T);
-                mpFp_mul(M, M, S);
-                mpFp_sub(S, M, YYYY);
-                // Z3 = (Y1+Z1)**2-YY-ZZ
-                mpFp_add(M, pt->y, pt->z);
-                mpFp_pow_ui(M, M, 2);
-                mpFp_sub(M, M, YY);
-                mpFp_sub(rpt->z, M, ZZ);
-                mpFp_set(rpt->y, S);
-                //
-                // done... clean up temporary variables
-                mpFp_clear(T);
-                mpFp_clear(M);
-                mpFp_clear(S);
-                mpFp_clear(ZZ);
-                mpFp_clear(YYYY);
-                mpFp_clear(YY);
-                mpFp_clear(XX);
-                mpECurve_set(rpt->cvp, pt->cvp);
-                rpt->is_neutral = 0;
-                return;
+    // sc is NOT reduced modulo n, so n*P can be used as a subgroup check
+    mpz_init_set(k[0], sc);
+    mpECP_init(&P[0], pt->cvp);
+    mpECP_set(&P[0], pt);
+    _mpECP_straus_vartime(rpt, P, k, 1);
+    mpECP_clear(&P[0]);
+    mpz_clear(k[0]);
+    return;
+}
+
+// constant time multi scalar multiplication, rpt = sum(sc[j] * pts[j]). All
+// scalars share one doubling chain (joint fixed window, each window costs w
+// doublings and one addition per point). With GLV each scalar is split in
+// two half length scalars, so the chain is half as long
+void mpECP_multi_scalar_mul(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n) {
+    int i, j, m, w, tsz, nbits, glv, neg[2];
+    int *even;
+    mp_size_t nlimbs;
+    mp_limb_t *kl;
+    mp_limb_t **kp;
+    mpz_t k, kk[2];
+    mpECP_t R, Q;
+    struct _p_mpECP_t **T;
+    mpECurve_ptr cvp;
+
+    assert(n > 0);
+    cvp = pts[0]->cvp;
+    glv = (cvp->glv.enabled != 0);
+    if (glv != 0) {
+        w = _mpECP_default_glv_window_bits(cvp);
+        nbits = cvp->glv.bits;
+    } else {
+        w = _mpECP_default_window_bits(cvp);
+        nbits = _mpECP_scalar_bits(cvp);
+    }
+    tsz = 1 << (w - 1);
+    nlimbs = sc[0]->fp->psize;
+    even = (int *)malloc(2 * n * sizeof(int));
+    kl = (mp_limb_t *)malloc(2 * n * nlimbs * sizeof(mp_limb_t));
+    kp = (mp_limb_t **)malloc(2 * n * sizeof(mp_limb_t *));
+    T = (struct _p_mpECP_t **)malloc(2 * n * sizeof(struct _p_mpECP_t *));
+    assert((even != NULL) && (kl != NULL) && (kp != NULL) && (T != NULL));
+    mpECP_init(R, cvp);
+    mpECP_init(Q, cvp);
+    mpz_init(k);
+    mpz_init(kk[0]);
+    mpz_init(kk[1]);
+
+    m = 0;
+    for (j = 0; j < n; j++) {
+        assert(pts[j]->cvp == cvp);
+        // scalar should be modulo the order of the curve
+        assert(mpz_cmp(sc[j]->fp->p, cvp->n) == 0);
+        // which points are neutral is public, skip them
+        if (pts[j]->is_neutral != 0) continue;
+        mpz_set_mpFp(k, sc[j]);
+        mpECP_set(Q, pts[j]);
+        if (glv != 0) {
+            _mpECurve_glv_decompose(kk[0], kk[1], k, cvp);
+            for (i = 0; i < 2; i++) {
+                neg[i] = (mpz_sgn(kk[i]) < 0);
+                mpz_abs(kk[i], kk[i]);
+                assert(mpz_sizeinbase(kk[i], 2) <= cvp->glv.bits);
             }
-            break;
-#endif
-        case EQTypeEdwards:
-        case EQTypeTwistedEdwards: {
-               // Edwards addition law is complete, so can use add for double
-                mpECP_add(rpt, pt, pt);
-                return;
+            _mpECP_cneg(Q, neg[0]);
+        } else {
+            mpz_set(kk[0], k);
+        }
+        kp[m] = kl + (m * nlimbs);
+        even[m] = _mpECP_limbs_odd(kp[m], nlimbs, kk[0]);
+        T[m] = (struct _p_mpECP_t *)malloc(tsz * sizeof(struct _p_mpECP_t));
+        assert(T[m] != NULL);
+        _mpECP_odd_multiples(T[m], tsz, Q);
+        m += 1;
+        if (glv != 0) {
+            // table for phi(P) derived from the table for P
+            kp[m] = kl + (m * nlimbs);
+            even[m] = _mpECP_limbs_odd(kp[m], nlimbs, kk[1]);
+            T[m] = (struct _p_mpECP_t *)malloc(tsz * sizeof(struct _p_mpECP_t));
+            assert(T[m] != NULL);
+            for (i = 0; i < tsz; i++) {
+                mpECP_init(&T[m][i], cvp);
+                _mpECP_glv_phi(&T[m][i], &T[m-1][i]);
+                _mpECP_cneg(&T[m][i], neg[0] ^ neg[1]);
             }
+            m += 1;
+        }
+    }
+
+    if (m == 0) {
+        mpECP_set_neutral(R, cvp);
+    } else {
+        _mpECP_straus_ct(R, T, kp, NULL, nlimbs, m, w, nbits, 0);
+        // scalars were forced odd, remove the extra multiples
+        for (j = 0; j < m; j++) {
+            mpECP_sub(Q, R, &T[j][0]);
+            _mpECP_cmov(R, Q, even[j]);
+        }
+    }
+    mpECP_set(rpt, R);
+
+    for (j = 0; j < m; j++) {
+        _mpECP_odd_multiples_clear(T[j], tsz);
+    }
+    mpz_clear(kk[1]);
+    mpz_clear(kk[0]);
+    mpz_clear(k);
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    free(T);
+    free(kp);
+    free(kl);
+    free(even);
+    return;
+}
+
+// variable time multi scalar multiplication (interleaved wNAF), ONLY for
+// public scalars, e.g. signature verification (u1 * G + u2 * Q)
+void mpECP_multi_scalar_mul_vartime(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n) {
+    int j, m;
+    struct _p_mpECP_t *P;
+    mpz_t *k;
+    mpECurve_ptr cvp;
+
+    assert(n > 0);
+    if (n >= _MPECP_PIPPENGER_MIN_POINTS) {
+        mpECP_multi_scalar_mul_pippenger(rpt, pts, sc, n, 1);
+        return;
+    }
+    cvp = pts[0]->cvp;
+    m = (cvp->glv.enabled != 0) ? 2 * n : n;
+    P = (struct _p_mpECP_t *)malloc(m * sizeof(struct _p_mpECP_t));
+    k = (mpz_t *)malloc(m * sizeof(mpz_t));
+    assert((P != NULL) && (k != NULL));
+    for (j = 0; j < n; j++) {
+        assert(pts[j]->cvp == cvp);
+        // scalar should be modulo the order of the curve
+        assert(mpz_cmp(sc[j]->fp->p, cvp->n) == 0);
+        mpECP_init(&P[j], cvp);
+        mpECP_set(&P[j], pts[j]);
+        mpz_init(k[j]);
+        mpz_set_mpFp(k[j], sc[j]);
+        if (cvp->glv.enabled != 0) {
+            mpECP_init(&P[n + j], cvp);
+            _mpECP_glv_phi(&P[n + j], pts[j]);
+            mpz_init(k[n + j]);
+            _mpECurve_glv_decompose(k[j], k[n + j], k[j], cvp);
+        }
+    }
+    _mpECP_straus_vartime(rpt, P, k, m);
+    for (j = 0; j < m; j++) {
+        mpz_clear(k[j]);
+        mpECP_clear(&P[j]);
+    }
+    free(k);
+    free(P);
+    return;
+}
+
+// Pippenger (bucket method) state shared by the worker threads. Every task
+// is one window of c bits over one part of the points, producing a partial
+// window sum W[task]
+typedef struct {
+    struct _p_mpECP_t *A;   // points, normalized to affine
+    char *skip;             // neutral points (or not affine), ignored
+    mpFp_t *sc;
+    mp_size_t nlimbs;
+    int n;
+    int c;
+    int nwin;
+    int nparts;
+    struct _p_mpECP_t *W;
+    int next;               // next task, claimed atomically
+} _mpECP_pippenger_t;
+
+// signed digit i of k in radix 2**c with digits in (-2**(c-1), 2**(c-1)].
+// The carry into window i is set iff the lower windows exceed 2**(c-1) each
+// (compared most significant window first), so digits can be computed
+// independently per window without storing the full recoding
+static inline int _mpECP_pippenger_digit(mp_limb_t *k, mp_size_t nlimbs, int i, int c) {
+    int j, d, carry;
+    unsigned int u, h;
+
+    h = 1U << (c - 1);
+    carry = 0;
+    for (j = i - 1; j >= 0; j--) {
+        u = _mpECP_limb_bits(k, nlimbs, j * c, c);
+        if (u != h) {
+            carry = (u > h);
             break;
-        default:
-            assert(_known_curve_type(pt->cvp));
+        }
     }
-    assert(0);
+    d = (int)_mpECP_limb_bits(k, nlimbs, i * c, c) + carry;
+    if (d > (int)h) d -= (1 << c);
+    return d;
 }
 
-void mpECP_sub(mpECP_t rpt, mpECP_t pt1, mpECP_t pt2) {
-    assert(mpECurve_cmp(pt1->cvp, pt2->cvp) == 0);
-    if (pt2->is_neutral != 0) {
-        if (pt1->is_neutral != 0) {
-            mpECP_set_neutral(rpt, pt1->cvp);
+static void _mpECP_pippenger_task(_mpECP_pippenger_t *ctx, int task,
+struct _p_mpECP_t *B, mpECP_t Q) {
+    int i, j, d, lo, hi, nb;
+    mpECP_t S, T;
+    mpECurve_ptr cvp;
+
+    cvp = ctx->A[0].cvp;
+    i = task / ctx->nparts;
+    lo = (int)(((int64_t)ctx->n * (task % ctx->nparts)) / ctx->nparts);
+    hi = (int)(((int64_t)ctx->n * ((task % ctx->nparts) + 1)) / ctx->nparts);
+    nb = 1 << (ctx->c - 1);
+    for (j = 0; j < nb; j++) {
+        mpECP_set_neutral(&B[j], cvp);
+    }
+    // accumulate points into buckets B[|d| - 1] (public formulas)
+    for (j = lo; j < hi; j++) {
+        if (ctx->skip[j] != 0) continue;
+        d = _mpECP_pippenger_digit(ctx->sc[j]->i->_mp_d, ctx->nlimbs, i, ctx->c);
+        if (d == 0) continue;
+        if (d > 0) {
+            _mpECP_add_mixed_public(&B[d - 1], &B[d - 1], &ctx->A[j]);
         } else {
-            mpECP_set(rpt, pt1);
+            mpECP_neg(Q, &ctx->A[j]);
+            _mpECP_add_mixed_public(&B[-d - 1], &B[-d - 1], Q);
+        }
+    }
+    for (j = 0; j < nb; j++) {
+        _mpECP_formulas_leave(&B[j]);
+    }
+    // window sum = sum((b + 1) * B[b]) via running sums
+    mpECP_init(S, cvp);
+    mpECP_init(T, cvp);
+    mpECP_set_neutral(S, cvp);
+    mpECP_set_neutral(T, cvp);
+    for (j = nb - 1; j >= 0; j--) {
+        mpECP_add(T, T, &B[j]);
+        mpECP_add(S, S, T);
+    }
+    mpECP_set(&ctx->W[task], S);
+    mpECP_clear(T);
+    mpECP_clear(S);
+    return;
+}
+
+static void *_mpECP_pippenger_worker(void *arg) {
+    int j, nb, ntasks, task;
+    struct _p_mpECP_t *B;
+    mpECP_t Q;
+    _mpECP_pippenger_t *ctx = (_mpECP_pippenger_t *)arg;
+
+    nb = 1 << (ctx->c - 1);
+    ntasks = ctx->nwin * ctx->nparts;
+    B = (struct _p_mpECP_t *)malloc(nb * sizeof(struct _p_mpECP_t));
+    assert(B != NULL);
+    for (j = 0; j < nb; j++) {
+        mpECP_init(&B[j], ctx->A[0].cvp);
+    }
+    mpECP_init(Q, ctx->A[0].cvp);
+    while ((task = __atomic_fetch_add(&(ctx->next), 1, __ATOMIC_RELAXED)) < ntasks) {
+        _mpECP_pippenger_task(ctx, task, B, Q);
+    }
+    mpECP_clear(Q);
+    for (j = 0; j < nb; j++) {
+        mpECP_clear(&B[j]);
+    }
+    free(B);
+    return NULL;
+}
+
+// window size minimizing the number of additions, nwin * (n + 2**c)
+static int _mpECP_pippenger_window_bits(int nbits, int n) {
+    int c, best;
+    double cost, best_cost;
+
+    best = 2;
+    best_cost = 0.0;
+    for (c = 2; c <= 16; c++) {
+        cost = (double)((nbits + c) / c) * ((double)n + (double)(1 << c));
+        if ((c == 2) || (cost < best_cost)) {
+            best = c;
+            best_cost = cost;
         }
+    }
+    return best;
+}
+
+void mpECP_multi_scalar_mul_pippenger(mpECP_t rpt, mpECP_t *pts, mpFp_t *sc, int n, int nthreads) {
+    int i, j, ntasks;
+    long ncpu;
+    pthread_t *th;
+    mpECP_t R;
+    mpECurve_ptr cvp;
+    _mpECP_pippenger_t ctx;
+
+    assert(n > 0);
+    cvp = pts[0]->cvp;
+    if (nthreads <= 0) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (ncpu > 0) ? (int)ncpu : 1;
+    }
+    ctx.n = n;
+    ctx.sc = sc;
+    ctx.nlimbs = sc[0]->fp->psize;
+    ctx.c = _mpECP_pippenger_window_bits(_mpECP_scalar_bits(cvp), n);
+    // one extra bit for the carry out of the top signed digit
+    ctx.nwin = (_mpECP_scalar_bits(cvp) + ctx.c) / ctx.c;
+    // split the points too if there are fewer windows than threads
+    ctx.nparts = (nthreads + ctx.nwin - 1) / ctx.nwin;
+    if (ctx.nparts > (n / (1 << ctx.c))) ctx.nparts = n / (1 << ctx.c);
+    if (ctx.nparts < 1) ctx.nparts = 1;
+    ctx.next = 0;
+    ntasks = ctx.nwin * ctx.nparts;
+    if (nthreads > ntasks) nthreads = ntasks;
+
+    ctx.A = (struct _p_mpECP_t *)malloc(n * sizeof(struct _p_mpECP_t));
+    ctx.skip = (char *)malloc(n * sizeof(char));
+    ctx.W = (struct _p_mpECP_t *)malloc(ntasks * sizeof(struct _p_mpECP_t));
+    assert((ctx.A != NULL) && (ctx.skip != NULL) && (ctx.W != NULL));
+    for (j = 0; j < n; j++) {
+        assert(pts[j]->cvp == cvp);
+        // scalar should be modulo the order of the curve
+        assert(mpz_cmp(sc[j]->fp->p, cvp->n) == 0);
+        mpECP_init(&ctx.A[j], cvp);
+        mpECP_set(&ctx.A[j], pts[j]);
+    }
+    _mpECP_batch_to_affine(ctx.A, n);
+    for (j = 0; j < n; j++) {
+        ctx.skip[j] = (ctx.A[j].is_neutral != 0) || (mpFp_cmp_ui(ctx.A[j].z, 1) != 0);
+    }
+    for (j = 0; j < ntasks; j++) {
+        mpECP_init(&ctx.W[j], cvp);
+    }
+
+    if (nthreads <= 1) {
+        _mpECP_pippenger_worker(&ctx);
     } else {
-        mpECP_t n;
-        mpECP_init(n, pt1->cvp);
-        mpECP_neg(n, pt2);
-        mpECP_add(rpt, pt1, n);
-        mpECP_clear(n);
+        th = (pthread_t *)malloc(nthreads * sizeof(pthread_t));
+        assert(th != NULL);
+        for (i = 0; i < nthreads; i++) {
+            j = pthread_create(&th[i], NULL, _mpECP_pippenger_worker, &ctx);
+            assert(j == 0);
+        }
+        for (i = 0; i < nthreads; i++) {
+            pthread_join(th[i], NULL);
+        }
+        free(th);
+    }
+
+    // R = sum(2**(ic) * W_i), W_i = sum of the partial sums of window i
+    mpECP_init(R, cvp);
+    mpECP_set_neutral(R, cvp);
+    for (i = ctx.nwin - 1; i >= 0; i--) {
+        for (j = 0; j < ctx.c; j++) {
+            mpECP_double(R, R);
+        }
+        for (j = 0; j < ctx.nparts; j++) {
+            mpECP_add(R, R, &ctx.W[(i * ctx.nparts) + j]);
+        }
+    }
+    mpECP_set(rpt, R);
+
+    mpECP_clear(R);
+    for (j = 0; j < ntasks; j++) {
+        mpECP_clear(&ctx.W[j]);
+    }
+    for (j = 0; j < n; j++) {
+        mpECP_clear(&ctx.A[j]);
     }
+    free(ctx.W);
+    free(ctx.skip);
+    free(ctx.A);
     return;
 }
 
-void mpECP_scalar_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
-    int i, b;
-    mpECP_t R0, R1;
-    mpECP_init(R0, pt->cvp);
-    mpECP_init(R1, pt->cvp);
-    mpECP_set_neutral(R0, pt->cvp);
-    mpECP_set(R1, pt);
-    // scalar should be modulo the order of the curve
-    assert(mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
-    for (i = pt->cvp->bits - 1; i >= 0 ; i--) {
-        b = mpFp_tstbit(sc, i);
-        _mpECP_cswap_safe(R0, R1, b);
-        mpECP_add(R1, R1, R0);
-        mpECP_double(R0, R0);
-        _mpECP_cswap_safe(R0, R1, b);
+// build a fixed base table for pt with window w. Returns NULL if any
+// entry cannot be represented in affine form (i.e. pt has small order)
+static _mpECP_base_table_t *_mpECP_base_table_create(mpECP_t pt, int w) {
+    int i, j, d, status;
+    mp_size_t l, psize;
+    mp_limb_t *e;
+    mpECP_t B;
+    struct _p_mpECP_t *T;
+    _mpECP_base_table_t *tbl;
+
+    assert((w >= 2) && (w <= _MPECP_MAX_WINDOW_BITS));
+    tbl = (_mpECP_base_table_t *)malloc(sizeof(_mpECP_base_table_t));
+    assert(tbl != NULL);
+    psize = pt->cvp->fp->psize;
+    tbl->window_bits = w;
+    tbl->levels = (_mpECP_scalar_bits(pt->cvp) + w - 1) / w;
+    tbl->level_size = 1 << (w - 1);
+    tbl->psize = psize;
+    tbl->bytes = (size_t)tbl->levels * tbl->level_size * 2 * psize * sizeof(mp_limb_t);
+    tbl->refcount = 1;
+    tbl->is_static = 0;
+    tbl->map = NULL;
+    tbl->map_bytes = 0;
+    status = posix_memalign((void **)&(tbl->limbs), 64, tbl->bytes);
+    assert(status == 0);
+
+    T = (struct _p_mpECP_t *)malloc(tbl->level_size * sizeof(struct _p_mpECP_t));
+    assert(T != NULL);
+    mpECP_init(B, pt->cvp);
+    mpECP_set(B, pt);
+    e = tbl->limbs;
+    for (i = 0; i < tbl->levels; i++) {
+        // level i = odd multiples of B = 2**(i*w) * P
+        _mpECP_odd_multiples(T, tbl->level_size, B);
+        _mpECP_batch_to_affine(T, tbl->level_size);
+        for (j = 0; j < tbl->level_size; j++) {
+            if ((T[j].is_neutral != 0) || (mpFp_cmp_ui(T[j].z, 1) != 0)) {
+                status = -1;
+            }
+            for (l = 0; l < psize; l++) {
+                e[l] = T[j].x->i->_mp_d[l];
+                e[psize + l] = T[j].y->i->_mp_d[l];
+            }
+            e += 2 * psize;
+            mpECP_clear(&T[j]);
+        }
+        if (status != 0) break;
+        for (d = 0; d < w; d++) {
+            mpECP_double(B, B);
+        }
     }
-    mpECP_set(rpt, R0);
-    mpECP_clear(R1);
-    mpECP_clear(R0);
+    mpECP_clear(B);
+    free(T);
+    if (status != 0) {
+        _mpECP_base_table_free(tbl);
+        return NULL;
+    }
+    return tbl;
+}
+
+// constant time lookup, scans every entry of the level, rpt = entry idx
+static void _mpECP_base_table_lookup(mpECP_t rpt, _mpECP_base_table_t *tbl,
+mpECurve_ptr cvp, int level, unsigned int idx) {
+    int j;
+    mp_size_t l, psize;
+    mp_limb_t mask;
+    mp_limb_t *e, *x, *y;
+
+    psize = tbl->psize;
+    x = rpt->x->i->_mp_d;
+    y = rpt->y->i->_mp_d;
+    for (l = 0; l < psize; l++) {
+        x[l] = 0;
+        y[l] = 0;
+    }
+    e = tbl->limbs + ((size_t)level * tbl->level_size * 2 * psize);
+    for (j = 0; j < tbl->level_size; j++) {
+        mask = ((mp_limb_t)0) - ((mp_limb_t)((unsigned int)j == idx));
+        for (l = 0; l < psize; l++) {
+            x[l] |= mask & e[l];
+            y[l] |= mask & e[psize + l];
+        }
+        e += 2 * psize;
+    }
+    rpt->x->i->_mp_size = psize;
+    rpt->y->i->_mp_size = psize;
+    mpFp_set_ui_fp(rpt->z, 1, cvp->fp);
+    rpt->cvp = cvp;
+    rpt->is_neutral = 0;
     return;
 }
 
-void mpECP_scalar_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t sc) {
-    mpFp_t s;
-    mpFp_init_fp(s, pt->cvp->fp);
-    mpFp_set_mpz(s, sc, pt->cvp->n);
-    mpECP_scalar_mul(rpt, pt, s);
-    mpFp_clear(s);
+// rpt = k * P from the fixed base table of P (constant time). Same regular
+// signed odd digits as mpECP_scalar_mul_window, but digit i is looked up in
+// level i so no doublings are needed, one mixed addition per level
+static void _mpECP_base_table_mul(mpECP_t rpt, _mpECP_base_table_t *tbl,
+mpECurve_ptr cvp, mpFp_t sc) {
+    int i, w, even, neg;
+    unsigned int u, idx;
+    mp_size_t nlimbs;
+    mp_limb_t kl[_MPFP_MAX_LIMBS];
+    mpz_t k;
+    mpECP_t R, Q;
+
+    w = tbl->window_bits;
+    assert((tbl->levels * w) >= _mpECP_scalar_bits(cvp));
+    nlimbs = sc->fp->psize;
+    mpz_init(k);
+    mpz_set_mpFp(k, sc);
+    even = _mpECP_limbs_odd(kl, nlimbs, k);
+    mpECP_init(R, cvp);
+    mpECP_init(Q, cvp);
+    for (i = 0; i < tbl->levels; i++) {
+        if (i < (tbl->levels - 1)) {
+            u = _mpECP_limb_bits(kl, nlimbs, (i * w) + 1, w);
+            neg = 1 - (int)(u >> (w - 1));
+            idx = (u ^ (0U - (unsigned int)neg)) & (tbl->level_size - 1);
+        } else {
+            // most significant digit is always positive
+            idx = _mpECP_limb_bits(kl, nlimbs, (i * w) + 1, w - 1);
+            neg = 0;
+        }
+        if (i == 0) {
+            _mpECP_base_table_lookup(R, tbl, cvp, i, idx);
+            _mpECP_cneg(R, neg);
+        } else {
+            _mpECP_base_table_lookup(Q, tbl, cvp, i, idx);
+            _mpECP_cneg(Q, neg);
+            _mpECP_add_mixed(R, R, Q);
+        }
+    }
+    // k was even, so we calculated (k + 1) * P, level 0 entry 0 is P
+    _mpECP_base_table_lookup(Q, tbl, cvp, 0, 0);
+    _mpECP_cneg(Q, 1);
+    _mpECP_add_mixed(Q, R, Q);
+    _mpECP_cmov(R, Q, even);
+    mpECP_set(rpt, R);
+
+    mpECP_clear(Q);
+    mpECP_clear(R);
+    mpz_clear(k);
     return;
 }
 
+// window of the generator table, measured (cv->base_bits, see
+// mpECP_tune_load) or _MPECP_BASE_BITS
+static inline int _mpECP_base_bits(mpECurve_ptr cvp) {
+    if (cvp->base_bits != 0) return cvp->base_bits;
+    return _MPECP_BASE_BITS;
+}
+
+size_t mpECP_scalar_base_mul_table_size(mpECurve_t cv, int window_bits) {
+    size_t levels;
+    if (window_bits == 0) window_bits = _mpECP_base_bits(cv);
+    if ((window_bits < 2) || (window_bits > _MPECP_MAX_WINDOW_BITS)) return 0;
+    levels = (_mpECP_scalar_bits(cv) + window_bits - 1) / window_bits;
+    return sizeof(_mpECP_base_table_t) + (levels * (((size_t)1) << (window_bits - 1)) *
+        2 * cv->fp->psize * sizeof(mp_limb_t));
+}
+
+size_t mpECP_scalar_base_mul_table_bytes(mpECP_t pt) {
+    if (pt->base_bits == 0) return 0;
+    return sizeof(_mpECP_base_table_t) + pt->base_tbl->bytes;
+}
+
+// is pt the curve generator G? (projective compare against affine G)
+static int _mpECP_is_generator(mpECP_t pt) {
+    int r;
+    mpECP_t G;
+    if (pt->is_neutral != 0) return 0;
+    mpECP_init(G, pt->cvp);
+    mpECP_set_mpz(G, pt->cvp->G[0], pt->cvp->G[1], pt->cvp);
+    r = (mpECP_cmp(pt, G) == 0);
+    mpECP_clear(G);
+    return r;
+}
+
+// shared default table for the generator of cvp, built on first use. The
+// table is kept on the canonical curve so every instance of a curve shares
+// it. An instance tuned to a different window (see mpECP_tune_load) keeps
+// its own table
+static _mpECP_base_table_t *_mpECP_curve_base_table(mpECurve_ptr cvp) {
+    _mpECP_base_table_t *tbl;
+    mpECurve_ptr c;
+    int w;
+
+    w = _mpECP_base_bits(cvp);
+    c = (cvp->canon != NULL) ? cvp->canon : cvp;
+    tbl = __atomic_load_n(&(c->base_tbl), __ATOMIC_ACQUIRE);
+    if ((tbl != NULL) && (tbl->window_bits != w)) {
+        c = cvp;
+        tbl = __atomic_load_n(&(c->base_tbl), __ATOMIC_ACQUIRE);
+    }
+    if (tbl != NULL) return tbl;
+    pthread_mutex_lock(&_mpECP_base_table_lock);
+    tbl = c->base_tbl;
+    if ((tbl != NULL) && (tbl->window_bits != w)) {
+        // another instance set the canonical table meanwhile
+        c = cvp;
+        tbl = c->base_tbl;
+    }
+    if ((tbl == NULL) && (cvp->name != NULL)) {
+        // precomputed at build time?
+        tbl = _mpECP_static_base_table(cvp->name);
+        if ((tbl != NULL) && ((tbl->window_bits != w) ||
+            (tbl->psize != cvp->fp->psize) ||
+            ((tbl->levels * tbl->window_bits) < _mpECP_scalar_bits(cvp)))) {
+            tbl = NULL;
+        }
+        if (tbl != NULL) {
+            __atomic_store_n(&(c->base_tbl), tbl, __ATOMIC_RELEASE);
+        }
+    }
+    if (tbl == NULL) {
+        mpECP_t G;
+        mpECP_init(G, cvp);
+        mpECP_set_mpz(G, cvp->G[0], cvp->G[1], cvp);
+        tbl = _mpECP_base_table_create(G, w);
+        mpECP_clear(G);
+        assert(tbl != NULL);
+        __atomic_store_n(&(c->base_tbl), tbl, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&_mpECP_base_table_lock);
+    return tbl;
+}
+
+int mpECP_scalar_base_mul_setup_ex(mpECP_t pt, int window_bits, size_t max_bytes) {
+    int w;
+    if (window_bits == 0) {
+        // default window for the generator uses the curve table
+        if ((pt->base_bits == 0) && ((max_bytes == 0) ||
+            (mpECP_scalar_base_mul_table_size(pt->cvp, 0) <= max_bytes)) &&
+            (_mpECP_is_generator(pt) != 0)) {
+            pt->base_tbl = _mpECP_base_table_ref(_mpECP_curve_base_table(pt->cvp));
+            pt->base_bits = pt->base_tbl->window_bits;
+            return 0;
+        }
+        window_bits = _mpECP_base_bits(pt->cvp);
+    }
+    if ((window_bits < 2) || (window_bits > _MPECP_MAX_WINDOW_BITS)) return -1;
+    // largest window (up to window_bits) which fits within max_bytes
+    for (w = window_bits; w >= 2; w--) {
+        if ((max_bytes == 0) ||
+            (mpECP_scalar_base_mul_table_size(pt->cvp, w) <= max_bytes)) {
+            break;
+        }
+    }
+    if (w < 2) return -1;
+    if (pt->base_bits == w) {
+        // already set up... 
+        return 0;
+    }
+    if (pt->base_bits != 0) _mpECP_base_pts_cleanup(pt);
+    assert(pt->base_tbl == NULL);
+    if (pt->is_neutral != 0) return -1;
+    pt->base_tbl = _mpECP_base_table_create(pt, w);
+    if (pt->base_tbl == NULL) return -1;
+    pt->base_bits = pt->base_tbl->window_bits;
+    return 0;
+}
+
 void mpECP_scalar_base_mul_setup(mpECP_t pt) {
-    int i, j, npts, nlevels, levelsz;
-    mpECP_t a, b;
-    struct _p_mpECP_t *level_pt;
-    struct _p_mpECP_t *base_pt;
     if (pt->base_bits != 0) {
         // already set up... 
         return;
     }
-    mpECP_init(a, pt->cvp);
-    mpECP_init(b, pt->cvp);
-    assert(pt->base_bits == 0);
-    pt->base_bits = _MPECP_BASE_BITS;
-    npts = _mpECP_n_base_pts(pt);
-    base_pt = (struct _p_mpECP_t *)malloc(npts * sizeof(struct _p_mpECP_t));
-    for (i = 0; i < npts; i++) {
-        mpECP_init(&base_pt[i], pt->cvp);
-    }
-    level_pt = (struct _p_mpECP_t *)malloc(pt->base_bits * sizeof(struct _p_mpECP_t));
-    for (i = 0; i < pt->base_bits; i++) {
-        mpECP_init(&(level_pt[i]), pt->cvp);
-    }
-    nlevels = _mpECP_n_base_pt_levels(pt);
-    levelsz = _mpECP_n_base_pt_level_size(pt);
-    // printf("setup: levels = %d, levelsz = %d\n", nlevels, levelsz);
-    mpECP_set(a, pt);
-    for (j = 0; j < nlevels; j++) {
-        mpECP_set_neutral(b, pt->cvp);
-        for (i = 0; i < levelsz; i++) {
-            mpECP_set(&base_pt[(j * levelsz) + i], b);
-            mpECP_add(b, b, a);
-        }
-        mpECP_set(a, b);
-    }
-    pt->base_pt = base_pt;
-    mpECP_clear(b);
-    mpECP_clear(a);
+    mpECP_scalar_base_mul_setup_ex(pt, 0, 0);
+    return;
+}
+
+// on disk table format, header followed by the limb arena (host byte order)
+#define _MPECP_TABLE_MAGIC      "ECCBTBL"
+#define _MPECP_TABLE_VERSION    (2)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t limb_bits;
+    uint32_t psize;
+    uint32_t window_bits;
+    uint32_t levels;
+    uint32_t level_size;
+    uint64_t curve_hash;
+    uint64_t point_hash;
+    uint64_t bytes;
+    uint64_t checksum;
+} _mpECP_table_file_hdr_t;
+
+// header size keeps the mapped arena 64 byte aligned
+typedef char _mpECP_table_file_hdr_size_check[(sizeof(_mpECP_table_file_hdr_t) == 64) ? 1 : -1];
+
+// FNV-1a, not cryptographic
+static uint64_t _mpECP_point_hash(mpECP_t pt) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    mpz_t c;
+    mpz_init(c);
+    mpz_set_mpECP_affine_x(c, pt);
+    h = _mpECurve_fnv1a_mpz(h, c);
+    mpz_set_mpECP_affine_y(c, pt);
+    h = _mpECurve_fnv1a_mpz(h, c);
+    mpz_clear(c);
+    return h;
+}
+
+static void _mpECP_table_file_hdr(_mpECP_table_file_hdr_t *hdr, mpECP_t pt, int w) {
+    memset(hdr, 0, sizeof(*hdr));
+    memcpy(hdr->magic, _MPECP_TABLE_MAGIC, sizeof(_MPECP_TABLE_MAGIC));
+    hdr->version = _MPECP_TABLE_VERSION;
+    hdr->limb_bits = GMP_NUMB_BITS;
+    hdr->psize = (uint32_t)pt->cvp->fp->psize;
+    hdr->window_bits = (uint32_t)w;
+    hdr->levels = (uint32_t)((_mpECP_scalar_bits(pt->cvp) + w - 1) / w);
+    hdr->level_size = ((uint32_t)1) << (w - 1);
+    hdr->bytes = (uint64_t)hdr->levels * hdr->level_size * 2 * hdr->psize * sizeof(mp_limb_t);
+    hdr->curve_hash = _mpECurve_hash(pt->cvp);
+    hdr->point_hash = _mpECP_point_hash(pt);
     return;
 }
 
+int mpECP_scalar_base_mul_table_save(mpECP_t pt, char *path) {
+    _mpECP_table_file_hdr_t hdr;
+    FILE *f;
+    int status;
+
+    if (pt->base_bits == 0) return -1;
+    _mpECP_table_file_hdr(&hdr, pt, pt->base_tbl->window_bits);
+    assert(hdr.bytes == pt->base_tbl->bytes);
+    hdr.checksum = _mpECurve_fnv1a(0xcbf29ce484222325ULL, pt->base_tbl->limbs,
+        pt->base_tbl->bytes);
+    f = fopen(path, "wb");
+    if (f == NULL) return -1;
+    status = 0;
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) status = -1;
+    if ((status == 0) &&
+        (fwrite(pt->base_tbl->limbs, pt->base_tbl->bytes, 1, f) != 1)) {
+        status = -1;
+    }
+    if (fclose(f) != 0) status = -1;
+    return status;
+}
+
+int mpECP_scalar_base_mul_table_load(mpECP_t pt, char *path) {
+    _mpECP_table_file_hdr_t hdr;
+    _mpECP_table_file_hdr_t *fhdr;
+    _mpECP_base_table_t *tbl;
+    struct stat st;
+    void *map;
+    size_t map_bytes;
+    int fd, w;
+
+    if (pt->is_neutral != 0) return -1;
+    fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    if ((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(hdr))) {
+        close(fd);
+        return -1;
+    }
+    map_bytes = (size_t)st.st_size;
+    map = mmap(NULL, map_bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    // validate header against what setup would produce for pt
+    fhdr = (_mpECP_table_file_hdr_t *)map;
+    w = (int)fhdr->window_bits;
+    if ((memcmp(fhdr->magic, _MPECP_TABLE_MAGIC, sizeof(_MPECP_TABLE_MAGIC)) != 0) ||
+        (fhdr->version != _MPECP_TABLE_VERSION) ||
+        (w < 2) || (w > _MPECP_MAX_WINDOW_BITS)) {
+        munmap(map, map_bytes);
+        return -1;
+    }
+    _mpECP_table_file_hdr(&hdr, pt, w);
+    hdr.checksum = fhdr->checksum;
+    if ((memcmp(&hdr, fhdr, sizeof(hdr)) != 0) ||
+        (map_bytes != (sizeof(hdr) + hdr.bytes)) ||
+        (_mpECurve_fnv1a(0xcbf29ce484222325ULL, (char *)map + sizeof(hdr),
+            hdr.bytes) != hdr.checksum)) {
+        munmap(map, map_bytes);
+        return -1;
+    }
+
+    tbl = (_mpECP_base_table_t *)malloc(sizeof(_mpECP_base_table_t));
+    assert(tbl != NULL);
+    tbl->window_bits = w;
+    tbl->levels = (int)hdr.levels;
+    tbl->level_size = (int)hdr.level_size;
+    tbl->psize = pt->cvp->fp->psize;
+    tbl->limbs = (mp_limb_t *)((char *)map + sizeof(hdr));
+    tbl->bytes = (size_t)hdr.bytes;
+    tbl->refcount = 1;
+    tbl->is_static = 0;
+    tbl->map = map;
+    tbl->map_bytes = map_bytes;
+    if (pt->base_bits != 0) _mpECP_base_pts_cleanup(pt);
+    pt->base_tbl = tbl;
+    pt->base_bits = w;
+    return 0;
+}
+
 void mpECP_scalar_base_mul(mpECP_t rpt, mpECP_t pt, mpFp_t sc) {
-    int j, k, nlevels, levelsz;
-    mpz_t s, kmpz;
-    mpECP_t a;
     assert (mpz_cmp(sc->fp->p, pt->cvp->n) == 0);
     if (pt->base_bits == 0) {
         mpECP_scalar_base_mul_setup(pt);
     }
-    mpz_init(s);
-    mpz_init(kmpz);
-    mpECP_init(a, pt->cvp);
-    mpECP_set_neutral(a, pt->cvp);
-    mpz_set_mpFp(s, sc);
-    nlevels = _mpECP_n_base_pt_levels(pt);
-    levelsz = _mpECP_n_base_pt_level_size(pt);
-    for (j = 0; j < nlevels; j++) {
-        mpz_mod_ui(kmpz, s, levelsz);
-        k = mpz_get_ui(kmpz);
-        mpECP_add(a, a, &pt->base_pt[(j * levelsz) + k]);
-        mpz_tdiv_q_ui(s, s, levelsz);
+    if (pt->base_bits == 0) {
+        // no table (neutral or small order point)
+        mpECP_scalar_mul(rpt, pt, sc);
+        return;
     }
-    mpECP_set(rpt, a);
-    mpECP_clear(a);
-    mpz_clear(kmpz);
-    mpz_clear(s);
+    _mpECP_base_table_mul(rpt, pt->base_tbl, pt->cvp, sc);
     return;
 }
 
@@ -1419,13 +5583,30 @@ void mpECP_scalar_base_mul_mpz(mpECP_t rpt, mpECP_t pt, mpz_t s) {
 
 void mpECP_urandom(mpECP_t rpt, mpECurve_t cv) {
     mpFp_t a;
-    mpECP_t g;
-    mpFp_init_fp(a, cv->fp);
-    mpECP_init(g, cv);
-    mpECP_set_mpz(g, cv->G[0], cv->G[1], cv);
-    mpFp_urandom(a, cv->n);
-    mpECP_scalar_mul(rpt, g, a);
-    mpECP_clear(g);
+    mpFp_init(a, cv->n);
+    mpECP_keypair_generate(a, rpt, cv);
     mpFp_clear(a);
     return;
 }
+
+void mpECP_keypair_generate(mpFp_t priv, mpECP_t pub, mpECurve_t cv) {
+    _mpECP_base_table_t *tbl;
+    assert(mpz_cmp(priv->fp->p, cv->n) == 0);
+    // uniform in [1, n-1]
+    do {
+        mpFp_urandom(priv, cv->n);
+    } while (mpFp_cmp_ui(priv, 0) == 0);
+    tbl = _mpECP_curve_base_table(cv);
+    _mpECP_base_table_mul(pub, tbl, cv, priv);
+    return;
+}
+
+void mpECP_keypair_generate_batch(mpFp_t *priv, mpECP_t *pub, int n, mpECurve_t cv) {
+    int i;
+    for (i = 0; i < n; i++) {
+        mpECP_keypair_generate(priv[i], pub[i], cv);
+    }
+    // public keys are usually exported next, one inversion for all
+    mpECP_batch_to_affine(pub, n);
+    return;
+}
@@ -29,9 +29,12 @@
 //OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <assert.h>
+#include <ecpoint.h>
 #include <ecurve.h>
 #include <field.h>
 #include <gmp.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -689,6 +692,7 @@ static void _mpECurve_init_coeff(mpECurve_t cv) {
             assert(cv->fp != NULL);
             mpFp_init_fp(cv->coeff.ws.a, cv->fp);
             mpFp_init_fp(cv->coeff.ws.b, cv->fp);
+            mpFp_init_fp(cv->coeff.ws.b3, cv->fp);
             break;
         case EQTypeEdwards:
             assert(cv->fp != NULL);
@@ -702,7 +706,7 @@ static void _mpECurve_init_coeff(mpECurve_t cv) {
             mpFp_init_fp(cv->coeff.mo.ws_a, cv->fp);
             mpFp_init_fp(cv->coeff.mo.ws_b, cv->fp);
             mpFp_init_fp(cv->coeff.mo.Binv, cv->fp);
-            mpFp_init_fp(cv->coeff.mo.Adiv3, cv->fp);
+            mpFp_init_fp(cv->coeff.mo.a24, cv->fp);
             break;
         case EQTypeTwistedEdwards:
             assert(cv->fp != NULL);
@@ -722,6 +726,7 @@ static void _mpECurve_clear_coeff(mpECurve_t cv) {
         case EQTypeShortWeierstrass:
             mpFp_clear(cv->coeff.ws.a);
             mpFp_clear(cv->coeff.ws.b);
+            mpFp_clear(cv->coeff.ws.b3);
             break;
         case EQTypeEdwards:
             mpFp_clear(cv->coeff.ed.c);
@@ -733,7 +738,7 @@ static void _mpECurve_clear_coeff(mpECurve_t cv) {
             mpFp_clear(cv->coeff.mo.ws_a);
             mpFp_clear(cv->coeff.mo.ws_b);
             mpFp_clear(cv->coeff.mo.Binv);
-            mpFp_clear(cv->coeff.mo.Adiv3);
+            mpFp_clear(cv->coeff.mo.a24);
             break;
         case EQTypeTwistedEdwards:
             mpFp_clear(cv->coeff.te.a);
@@ -745,6 +750,443 @@ static void _mpECurve_clear_coeff(mpECurve_t cv) {
             assert(_known_curve_type(cv));
     }
     cv->type = EQTypeUninitialized;
+    cv->ops = NULL;
+    cv->formulas[0] = NULL;
+    cv->formulas[1] = NULL;
+    cv->ws_a = NULL;
+    cv->ws_b = NULL;
+    cv->ws_b3 = NULL;
+    return;
+}
+
+static void _mpECurve_glv_init(mpECurve_t cv) {
+    cv->glv.enabled = 0;
+    mpz_init(cv->glv.lambda);
+    mpz_init(cv->glv.a1);
+    mpz_init(cv->glv.b1);
+    mpz_init(cv->glv.a2);
+    mpz_init(cv->glv.b2);
+    cv->glv.bits = 0;
+    return;
+}
+
+static void _mpECurve_glv_disable(mpECurve_t cv) {
+    if (cv->glv.enabled != 0) {
+        mpFp_clear(cv->glv.beta);
+        cv->glv.enabled = 0;
+    }
+    return;
+}
+
+static void _mpECurve_glv_clear(mpECurve_t cv) {
+    _mpECurve_glv_disable(cv);
+    mpz_clear(cv->glv.b2);
+    mpz_clear(cv->glv.a2);
+    mpz_clear(cv->glv.b1);
+    mpz_clear(cv->glv.a1);
+    mpz_clear(cv->glv.lambda);
+    return;
+}
+
+static void _mpECurve_glv_set(mpECurve_t rop, mpECurve_t op) {
+    if (rop == op) return;
+    _mpECurve_glv_disable(rop);
+    if (op->glv.enabled == 0) return;
+    mpFp_init_fp(rop->glv.beta, op->fp);
+    mpFp_set(rop->glv.beta, op->glv.beta);
+    mpz_set(rop->glv.lambda, op->glv.lambda);
+    mpz_set(rop->glv.a1, op->glv.a1);
+    mpz_set(rop->glv.b1, op->glv.b1);
+    mpz_set(rop->glv.a2, op->glv.a2);
+    mpz_set(rop->glv.b2, op->glv.b2);
+    rop->glv.bits = op->glv.bits;
+    rop->glv.enabled = 1;
+    return;
+}
+
+// curve parameters changed, drop the generator table (if any)
+static void _mpECurve_canon_reset(mpECurve_t cv) {
+    if ((cv->canon != NULL) && (cv->canon != cv)) {
+        mpECurve_release(cv->canon);
+    }
+    cv->canon = NULL;
+    return;
+}
+
+// drop state derived from the previous curve parameters
+static void _mpECurve_derived_reset(mpECurve_t cv) {
+    // canonical curves are shared, so never modified in place
+    assert(cv->interned == 0);
+    _mpECP_base_table_release(cv->base_tbl);
+    cv->base_tbl = NULL;
+    cv->name = NULL;
+    cv->window_bits = 0;
+    cv->base_bits = 0;
+    _mpECurve_canon_reset(cv);
+    _mpECP_curve_ops_select(cv);
+    return;
+}
+
+// find a nontrivial cube root of unity modulo prime m (m = 1 mod 3)
+static void _mpz_cube_root_of_unity(mpz_t r, mpz_t m) {
+    mpz_t e, g;
+    mpz_init(e);
+    mpz_init(g);
+    mpz_sub_ui(e, m, 1);
+    mpz_divexact_ui(e, e, 3);
+    mpz_set_ui(g, 2);
+    while (1) {
+        mpz_powm(r, g, e, m);
+        if (mpz_cmp_ui(r, 1) != 0) break;
+        mpz_add_ui(g, g, 1);
+    }
+    mpz_clear(g);
+    mpz_clear(e);
+    return;
+}
+
+static unsigned int _mpz_max_bits(unsigned int b, mpz_t v) {
+    unsigned int vb;
+    vb = mpz_sizeinbase(v, 2);
+    return (vb > b) ? vb : b;
+}
+
+// detect and precompute the GLV endomorphism for j-invariant 0 curves, i.e.
+// y**2 = x**3 + b with p = 1 mod 3 and n = 1 mod 3. Restricted to prime
+// order curves (h = 1) so that phi(P) = lambda * P for every point
+static void _mpECurve_glv_setup(mpECurve_t cv) {
+    mpz_t beta, u, r0, r1, r2, t0, t1, t2, q, sqrtn, l, m;
+    mpECP_t G, lG;
+    int i, found;
+
+    _mpECurve_glv_disable(cv);
+    if (cv->type != EQTypeShortWeierstrass) return;
+    if (mpFp_cmp_ui(cv->coeff.ws.a, 0) != 0) return;
+    if (mpz_cmp_ui(cv->h, 1) != 0) return;
+    if (mpz_fdiv_ui(cv->fp->p, 3) != 1) return;
+    if (mpz_fdiv_ui(cv->n, 3) != 1) return;
+
+    mpz_init(beta);
+    mpz_init(u);
+    _mpz_cube_root_of_unity(beta, cv->fp->p);
+    _mpz_cube_root_of_unity(cv->glv.lambda, cv->n);
+
+    // pair lambda with beta, i.e. lambda * G = (beta * Gx, Gy), else
+    // lambda**2 (the other nontrivial root) is the eigenvalue for beta
+    mpz_init(l);
+    mpECP_init(G, cv);
+    mpECP_init(lG, cv);
+    mpECP_set_mpz(G, cv->G[0], cv->G[1], cv);
+    mpz_mul(l, beta, cv->G[0]);
+    mpz_mod(l, l, cv->fp->p);
+    found = 0;
+    for (i = 0; i < 2; i++) {
+        mpECP_scalar_mul_vartime_mpz(lG, G, cv->glv.lambda);
+        mpz_set_mpECP_affine_x(u, lG);
+        if (mpz_cmp(u, l) == 0) {
+            found = 1;
+            break;
+        }
+        mpz_powm_ui(cv->glv.lambda, cv->glv.lambda, 2, cv->n);
+    }
+    mpECP_clear(lG);
+    mpECP_clear(G);
+    if (found == 0) {
+        mpz_clear(l);
+        mpz_clear(u);
+        mpz_clear(beta);
+        return;
+    }
+
+    // short lattice basis via extended Euclid on (n, lambda), see
+    // Gallant-Lambert-Vanstone 2001, Guide to ECC Algorithm 3.74
+    mpz_init_set(r0, cv->n);
+    mpz_init_set(r1, cv->glv.lambda);
+    mpz_init_set_ui(t0, 0);
+    mpz_init_set_ui(t1, 1);
+    mpz_init(r2);
+    mpz_init(t2);
+    mpz_init(q);
+    mpz_init(sqrtn);
+    mpz_init(m);
+    mpz_sqrt(sqrtn, cv->n);
+    while (mpz_cmp(r1, sqrtn) >= 0) {
+        mpz_tdiv_qr(q, r2, r0, r1);
+        mpz_mul(t2, q, t1);
+        mpz_sub(t2, t0, t2);
+        mpz_swap(r0, r1);
+        mpz_swap(r1, r2);
+        mpz_swap(t0, t1);
+        mpz_swap(t1, t2);
+    }
+    // r0 >= sqrt(n) > r1
+    mpz_set(cv->glv.a1, r1);
+    mpz_neg(cv->glv.b1, t1);
+    mpz_tdiv_qr(q, r2, r0, r1);
+    mpz_mul(t2, q, t1);
+    mpz_sub(t2, t0, t2);
+    // (a2, b2) is the shorter of (r0, -t0) and (r2, -t2)
+    mpz_mul(l, r0, r0);
+    mpz_addmul(l, t0, t0);
+    mpz_mul(m, r2, r2);
+    mpz_addmul(m, t2, t2);
+    if (mpz_cmp(l, m) <= 0) {
+        mpz_set(cv->glv.a2, r0);
+        mpz_neg(cv->glv.b2, t0);
+    } else {
+        mpz_set(cv->glv.a2, r2);
+        mpz_neg(cv->glv.b2, t2);
+    }
+    cv->glv.bits = _mpz_max_bits(0, cv->glv.a1);
+    cv->glv.bits = _mpz_max_bits(cv->glv.bits, cv->glv.b1);
+    cv->glv.bits = _mpz_max_bits(cv->glv.bits, cv->glv.a2);
+    cv->glv.bits = _mpz_max_bits(cv->glv.bits, cv->glv.b2);
+    cv->glv.bits += 1;
+
+    mpFp_init_fp(cv->glv.beta, cv->fp);
+    mpFp_set_mpz_fp(cv->glv.beta, beta, cv->fp);
+    cv->glv.enabled = 1;
+
+    mpz_clear(m);
+    mpz_clear(l);
+    mpz_clear(sqrtn);
+    mpz_clear(q);
+    mpz_clear(t2);
+    mpz_clear(r2);
+    mpz_clear(t1);
+    mpz_clear(t0);
+    mpz_clear(r1);
+    mpz_clear(r0);
+    mpz_clear(u);
+    mpz_clear(beta);
+    return;
+}
+
+// round(a / n) for n > 0
+static void _mpz_round_div(mpz_t r, mpz_t a, mpz_t n) {
+    mpz_t d;
+    mpz_init(d);
+    mpz_mul_2exp(r, a, 1);
+    mpz_add(r, r, n);
+    mpz_mul_2exp(d, n, 1);
+    mpz_fdiv_q(r, r, d);
+    mpz_clear(d);
+    return;
+}
+
+void _mpECurve_glv_decompose(mpz_t k1, mpz_t k2, mpz_t k, mpECurve_t cv) {
+    mpz_t c1, c2, t;
+    assert(cv->glv.enabled != 0);
+    mpz_init(c1);
+    mpz_init(c2);
+    mpz_init(t);
+    // c1 = round(b2 * k / n), c2 = round(-b1 * k / n)
+    mpz_mul(t, cv->glv.b2, k);
+    _mpz_round_div(c1, t, cv->n);
+    mpz_mul(t, cv->glv.b1, k);
+    mpz_neg(t, t);
+    _mpz_round_div(c2, t, cv->n);
+    // k1 = k - c1 * a1 - c2 * a2, k2 = -c1 * b1 - c2 * b2
+    mpz_set(t, k);
+    mpz_submul(t, c1, cv->glv.a1);
+    mpz_submul(t, c2, cv->glv.a2);
+    mpz_mul(k2, c1, cv->glv.b1);
+    mpz_addmul(k2, c2, cv->glv.b2);
+    mpz_neg(k2, k2);
+    mpz_set(k1, t);
+    mpz_clear(t);
+    mpz_clear(c2);
+    mpz_clear(c1);
+    return;
+}
+
+// curve registry: equal curves intern to a single canonical copy so curve
+// equality, which is checked on every point operation, is a pointer compare.
+// Reference counts are only modified while holding the registry lock
+
+typedef struct __mpECurve_intern_list_t {
+    mpECurve_ptr cv;
+    struct __mpECurve_intern_list_t *next;
+} _mpECurve_intern_list_t;
+
+static _mpECurve_intern_list_t *_static_curve_list = NULL;
+static pthread_mutex_t _mpECurve_intern_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int _mpECurve_cmp_params(mpECurve_t op1, mpECurve_t op2);
+
+uint64_t _mpECurve_fnv1a(uint64_t h, const void *buf, size_t len) {
+    const unsigned char *b = (const unsigned char *)buf;
+    size_t i;
+    for (i = 0; i < len; i++) {
+        h ^= (uint64_t)b[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+uint64_t _mpECurve_fnv1a_mpz(uint64_t h, mpz_t z) {
+    size_t i, sz;
+    mp_limb_t l;
+    sz = mpz_size(z);
+    h = _mpECurve_fnv1a(h, &sz, sizeof(sz));
+    for (i = 0; i < sz; i++) {
+        l = mpz_getlimbn(z, i);
+        h = _mpECurve_fnv1a(h, &l, sizeof(l));
+    }
+    return h;
+}
+
+uint64_t _mpECurve_hash(mpECurve_t cv) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    int t;
+    if (cv->canon != NULL) return cv->canon->hash;
+    t = (int)cv->type;
+    h = _mpECurve_fnv1a(h, &t, sizeof(t));
+    h = _mpECurve_fnv1a_mpz(h, cv->fp->p);
+    h = _mpECurve_fnv1a_mpz(h, cv->n);
+    h = _mpECurve_fnv1a_mpz(h, cv->h);
+    h = _mpECurve_fnv1a_mpz(h, cv->G[0]);
+    h = _mpECurve_fnv1a_mpz(h, cv->G[1]);
+    switch (cv->type) {
+        case EQTypeShortWeierstrass:
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.ws.a->i);
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.ws.b->i);
+            break;
+        case EQTypeEdwards:
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.ed.c->i);
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.ed.d->i);
+            break;
+        case EQTypeMontgomery:
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.mo.B->i);
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.mo.A->i);
+            break;
+        case EQTypeTwistedEdwards:
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.te.a->i);
+            h = _mpECurve_fnv1a_mpz(h, cv->coeff.te.d->i);
+            break;
+        default:
+            assert(_known_curve_type(cv));
+    }
+    return h;
+}
+
+// canonical curve equal to cv (or NULL), requires the registry lock
+static mpECurve_ptr _mpECurve_intern_find(mpECurve_t cv, uint64_t h) {
+    _mpECurve_intern_list_t *l;
+    if (cv->canon != NULL) return cv->canon;
+    for (l = _static_curve_list; l != NULL; l = l->next) {
+        if ((l->cv->hash == h) && (_mpECurve_cmp_params(l->cv, cv) == 0)) {
+            return l->cv;
+        }
+    }
+    return NULL;
+}
+
+mpECurve_ptr mpECurve_intern(mpECurve_t cv) {
+    _mpECurve_intern_list_t *l;
+    mpECurve_ptr c;
+    uint64_t h;
+
+    assert(_known_curve_type(cv));
+    h = _mpECurve_hash(cv);
+    pthread_mutex_lock(&_mpECurve_intern_lock);
+    c = _mpECurve_intern_find(cv, h);
+    if (c != NULL) {
+        c->refcount += 1;
+        pthread_mutex_unlock(&_mpECurve_intern_lock);
+        return c;
+    }
+    c = (mpECurve_ptr)malloc(sizeof(_mpECurve_t));
+    assert(c != NULL);
+    mpECurve_init(c);
+    mpECurve_set(c, cv);
+    c->canon = c;
+    c->hash = h;
+    c->refcount = 1;
+    c->interned = 1;
+    l = (_mpECurve_intern_list_t *)malloc(sizeof(_mpECurve_intern_list_t));
+    assert(l != NULL);
+    l->cv = c;
+    l->next = _static_curve_list;
+    _static_curve_list = l;
+    pthread_mutex_unlock(&_mpECurve_intern_lock);
+    return c;
+}
+
+void mpECurve_release(mpECurve_ptr cv) {
+    _mpECurve_intern_list_t **l;
+    _mpECurve_intern_list_t *l_this;
+
+    if (cv == NULL) return;
+    assert(cv->interned != 0);
+    pthread_mutex_lock(&_mpECurve_intern_lock);
+    assert(cv->refcount > 0);
+    cv->refcount -= 1;
+    if (cv->refcount > 0) {
+        pthread_mutex_unlock(&_mpECurve_intern_lock);
+        return;
+    }
+    l = &_static_curve_list;
+    while (*l != NULL) {
+        l_this = *l;
+        if (l_this->cv == cv) {
+            *l = l_this->next;
+            free(l_this);
+            break;
+        }
+        l = &(l_this->next);
+    }
+    pthread_mutex_unlock(&_mpECurve_intern_lock);
+    cv->interned = 0;
+    cv->canon = NULL;
+    mpECurve_clear(cv);
+    free(cv);
+    return;
+}
+
+// GLV parameters are derived once per curve. If the curve is already
+// interned they are copied from the canonical curve (which got them from the
+// first instance), skipping the cube root search and the check multiplies
+static void _mpECurve_glv_setup_shared(mpECurve_t cv) {
+    mpECurve_ptr c;
+    uint64_t h;
+
+    h = _mpECurve_hash(cv);
+    pthread_mutex_lock(&_mpECurve_intern_lock);
+    c = _mpECurve_intern_find(cv, h);
+    if (c != NULL) {
+        c->refcount += 1;
+    }
+    pthread_mutex_unlock(&_mpECurve_intern_lock);
+    if (c == NULL) {
+        _mpECurve_glv_setup(cv);
+        return;
+    }
+    // canonical curves are immutable, no lock needed to read them
+    _mpECurve_glv_set(cv, c);
+    mpECurve_release(c);
+    return;
+}
+
+// intern a successfully configured curve
+static int _mpECurve_canon_setup(mpECurve_t cv, int status) {
+    if (status == 0) {
+        cv->canon = mpECurve_intern(cv);
+    }
+    return status;
+}
+
+// standard curve names are shared with the canonical copy (the name selects
+// the precomputed generator table)
+static void _mpECurve_set_name(mpECurve_t cv, const char *name) {
+    cv->name = name;
+    if (cv->canon != NULL) {
+        pthread_mutex_lock(&_mpECurve_intern_lock);
+        if (cv->canon->name == NULL) cv->canon->name = name;
+        pthread_mutex_unlock(&_mpECurve_intern_lock);
+    }
+    // tuning is recorded per standard curve name
+    _mpECP_tune_apply(cv);
     return;
 }
 
@@ -760,20 +1202,43 @@ void mpECurve_init(mpECurve_t c) {
     mpz_init(c->G[0]);
     mpz_init(c->G[1]);
     c->bits = 0;
+    _mpECurve_glv_init(c);
+    c->base_tbl = NULL;
+    c->name = NULL;
+    c->canon = NULL;
+    c->hash = 0;
+    c->refcount = 0;
+    c->interned = 0;
+    c->ops = NULL;
+    c->formulas[0] = NULL;
+    c->formulas[1] = NULL;
+    c->ws_a = NULL;
+    c->ws_b = NULL;
+    c->ws_b3 = NULL;
+    c->window_bits = 0;
+    c->base_bits = 0;
     return;
 }
 
 void mpECurve_clear(mpECurve_t c) {
+    // canonical curves are freed by mpECurve_release
+    assert(c->interned == 0);
+    _mpECurve_canon_reset(c);
     _mpECurve_clear_coeff(c);
     c->fp = NULL;
     mpz_clear(c->n);
     mpz_clear(c->h);
     mpz_clear(c->G[0]);
     mpz_clear(c->G[1]);
+    _mpECurve_glv_clear(c);
+    _mpECP_base_table_release(c->base_tbl);
+    c->base_tbl = NULL;
     return;
 }
 
 void mpECurve_set(mpECurve_t rop, mpECurve_t op){
+    if (rop == op) return;
+    assert(rop->interned == 0);
     rop->fp = op->fp;
     if (rop->type != op->type) {
         _mpECurve_clear_coeff(rop);
@@ -795,7 +1260,7 @@ void mpECurve_set(mpECurve_t rop, mpECurve_t op){
             mpFp_set(rop->coeff.mo.ws_a, op->coeff.mo.ws_a);
             mpFp_set(rop->coeff.mo.ws_b, op->coeff.mo.ws_b);
             mpFp_set(rop->coeff.mo.Binv, op->coeff.mo.Binv);
-            mpFp_set(rop->coeff.mo.Adiv3, op->coeff.mo.Adiv3);
+            mpFp_set(rop->coeff.mo.a24, op->coeff.mo.a24);
             break;
         case EQTypeTwistedEdwards:
             mpFp_set(rop->coeff.te.a, op->coeff.te.a);
@@ -809,6 +1274,25 @@ void mpECurve_set(mpECurve_t rop, mpECurve_t op){
     mpz_set(rop->G[0], op->G[0]);
     mpz_set(rop->G[1], op->G[1]);
     rop->bits = op->bits;
+    _mpECurve_glv_set(rop, op);
+    // equal curves have the same generator, so share the table
+    _mpECP_base_table_release(rop->base_tbl);
+    rop->base_tbl = op->base_tbl;
+    if ((rop->base_tbl != NULL) && (rop->base_tbl->is_static == 0)) {
+        __atomic_add_fetch(&(rop->base_tbl->refcount), 1, __ATOMIC_RELAXED);
+    }
+    rop->name = op->name;
+    _mpECP_curve_ops_select(rop);
+    // keep formula sets selected at runtime on op
+    rop->formulas[0] = op->formulas[0];
+    rop->formulas[1] = op->formulas[1];
+    rop->window_bits = op->window_bits;
+    rop->base_bits = op->base_bits;
+    // equal curves also share the canonical copy
+    _mpECurve_canon_reset(rop);
+    if (op->canon != NULL) {
+        rop->canon = mpECurve_intern(op);
+    }
     return;
 }
 
@@ -837,9 +1321,15 @@ char *h, char *Gx, char *Gy, unsigned int bits){
     mpz_set_str(cv->G[0], Gx, 0);
     mpz_set_str(cv->G[1], Gy, 0);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
+    if (status == 0) {
+        _mpECurve_glv_setup_shared(cv);
+    } else {
+        _mpECurve_glv_disable(cv);
+    }
     mpz_clear(t);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_str_ed(mpECurve_t cv, char *p, char *c, char *d, char *n,
@@ -866,9 +1356,11 @@ char *h, char *Gx, char *Gy, unsigned int bits){
     mpz_set_str(cv->G[0], Gx, 0);
     mpz_set_str(cv->G[1], Gy, 0);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
+    _mpECurve_glv_disable(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
     mpz_clear(t);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_str_mo(mpECurve_t cv, char *p, char *B, char *A, char *n,
@@ -928,9 +1420,11 @@ char *h, char *Gx, char *Gy, unsigned int bits){
     mpz_set_str(cv->G[0], Gx, 0);
     mpz_set_str(cv->G[1], Gy, 0);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
+    _mpECurve_glv_disable(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
     mpz_clear(t);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_mpz_ws(mpECurve_t cv, mpz_t p, mpz_t a, mpz_t b, mpz_t n,
@@ -952,8 +1446,14 @@ mpz_t h, mpz_t Gx, mpz_t Gy, unsigned int bits){
     mpz_set(cv->G[0], Gx);
     mpz_set(cv->G[1], Gy);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
-    return status;
+    if (status == 0) {
+        _mpECurve_glv_setup_shared(cv);
+    } else {
+        _mpECurve_glv_disable(cv);
+    }
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_mpz_ed(mpECurve_t cv, mpz_t p, mpz_t c, mpz_t d, mpz_t n,
@@ -975,8 +1475,10 @@ mpz_t h, mpz_t Gx, mpz_t Gy, unsigned int bits){
     mpz_set(cv->G[0], Gx);
     mpz_set(cv->G[1], Gy);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
+    _mpECurve_glv_disable(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_mpz_mo(mpECurve_t cv, mpz_t p, mpz_t B, mpz_t A, mpz_t n,
@@ -991,26 +1493,27 @@ mpz_t h, mpz_t Gx, mpz_t Gy, unsigned int bits){
     _mpECurve_init_coeff(cv);
     mpFp_set_mpz_fp(cv->coeff.mo.B, B, cv->fp);
     mpFp_set_mpz_fp(cv->coeff.mo.A, A, cv->fp);
-    // internal representation of Montgomery curve points is ws
-    // to facilitate add/double (not differential)
-    // transform is :
+    // points are kept in Montgomery coordinates. The equivalent short
+    // Weierstrass curve, with transform :
     // x = Bu-A/3, y = Bv
     // ws_a = (3-A^2)/(3B^2) and ws_b = (2A^3-9A)/(27B^3)
     // resulting equation:
     // v^2 = u^3 + ws_a * u + ws_b
     // reverse transform:
     // u = x/B + A/3, v = y/B
+    // is only computed for reference (e.g. the language bindings)
     {
         mpFp_t a, b, s, t;
         mpFp_init_fp(a, cv->fp);
         mpFp_init_fp(b, cv->fp);
         mpFp_init_fp(s, cv->fp);
         mpFp_init_fp(t, cv->fp);
-        // precalculate A/3 and 1/B
-        mpFp_set_ui_fp(t, 3, cv->fp);
-        mpFp_inv(t, t);
-        mpFp_mul(cv->coeff.mo.Adiv3, cv->coeff.mo.A, t);
+        // precalculate 1/B and (A - 2)/4
         mpFp_inv(cv->coeff.mo.Binv, cv->coeff.mo.B);
+        mpFp_set_ui_fp(t, 4, cv->fp);
+        mpFp_inv(t, t);
+        mpFp_sub_ui(s, cv->coeff.mo.A, 2);
+        mpFp_mul(cv->coeff.mo.a24, s, t);
         // calculate short Weierstrass curve coefficients
         // ws_a
         mpFp_mul(b, cv->coeff.mo.B, cv->coeff.mo.B);
@@ -1039,8 +1542,10 @@ mpz_t h, mpz_t Gx, mpz_t Gy, unsigned int bits){
     mpz_set(cv->G[0], Gx);
     mpz_set(cv->G[1], Gy);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
+    _mpECurve_glv_disable(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 int mpECurve_set_mpz_te(mpECurve_t cv, mpz_t p, mpz_t a, mpz_t d, mpz_t n,
@@ -1062,8 +1567,10 @@ mpz_t h, mpz_t Gx, mpz_t Gy, unsigned int bits){
     mpz_set(cv->G[0], Gx);
     mpz_set(cv->G[1], Gy);
     cv->bits = bits;
+    _mpECurve_derived_reset(cv);
+    _mpECurve_glv_disable(cv);
     status = (mpECurve_point_check(cv, cv->G[0], cv->G[1]) == 0);
-    return status;
+    return _mpECurve_canon_setup(cv, status);
 }
 
 // note, assert used to check status here... since we're using a table
@@ -1079,6 +1586,7 @@ int mpECurve_set_named(mpECurve_t cv, char *name) {
                 _std_ws_curve[i].b,_std_ws_curve[i].n,_std_ws_curve[i].h,
                 _std_ws_curve[i].Gx,_std_ws_curve[i].Gy,_std_ws_curve[i].bits);
             assert (status == 0);
+            _mpECurve_set_name(cv, _std_ws_curve[i].name);
             return 0;
         }
     }
@@ -1089,6 +1597,7 @@ int mpECurve_set_named(mpECurve_t cv, char *name) {
                 _std_ed_curve[i].d,_std_ed_curve[i].n,_std_ed_curve[i].h,
                 _std_ed_curve[i].Gx,_std_ed_curve[i].Gy,_std_ed_curve[i].bits);
             assert (status == 0);
+            _mpECurve_set_name(cv, _std_ed_curve[i].name);
             return 0;
         }
     }
@@ -1099,6 +1608,7 @@ int mpECurve_set_named(mpECurve_t cv, char *name) {
                 _std_mo_curve[i].A,_std_mo_curve[i].n,_std_mo_curve[i].h,
                 _std_mo_curve[i].Gx,_std_mo_curve[i].Gy,_std_mo_curve[i].bits);
             assert (status == 0);
+            _mpECurve_set_name(cv, _std_mo_curve[i].name);
             return 0;
         }
     }
@@ -1109,6 +1619,7 @@ int mpECurve_set_named(mpECurve_t cv, char *name) {
                 _std_te_curve[i].d,_std_te_curve[i].n,_std_te_curve[i].h,
                 _std_te_curve[i].Gx,_std_te_curve[i].Gy,_std_te_curve[i].bits);
             assert (status == 0);
+            _mpECurve_set_name(cv, _std_te_curve[i].name);
             return 0;
         }
     }
@@ -1187,12 +1698,22 @@ int mpECurve_point_check(mpECurve_t cv, mpz_t Px, mpz_t Py) {
 }
 
 int mpECurve_cmp(mpECurve_t op1, mpECurve_t op2) {
+    if (op1 == op2) return 0;
+    // interned curves are equal exactly when they share the canonical copy
+    if ((op1->canon != NULL) && (op2->canon != NULL)) {
+        return (op1->canon == op2->canon) ? 0 : -1;
+    }
+    return _mpECurve_cmp_params(op1, op2);
+}
+
+static int _mpECurve_cmp_params(mpECurve_t op1, mpECurve_t op2) {
     int r;
     if (op1 == op2) return 0;
     //printf("not the same pointer\n");
     if (op1->type != op2->type) return -1;
     //printf("same type\n");
-    r = (op1->fp == op2->fp) ; if (r != 1) return r;
+    // fields are unique per prime (see _mpFp_field_lookup)
+    if (op1->fp != op2->fp) return -1;
     //printf("same field\n");
     switch (op1->type) {
         case EQTypeShortWeierstrass:
@@ -28,8 +28,14 @@
 //OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 //OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+// the exported operations keep the checks of the inline versions
+#ifndef _EC_FIELD_PARANOID
+#define _EC_FIELD_PARANOID
+#endif
+
 #include <assert.h>
 #include <field.h>
+#include <field_inline.h>
 #include <gmp.h>
 #include <mpzurandom.h>
 #include <stdio.h>
@@ -48,6 +54,544 @@
 #define PARANOID_ASSERT(X)
 #endif
 
+// field multiplication kernels (the 2 * psize limb product, reduction is
+// done by the callers). The backend is selected once at load time from the
+// cpu features and can be forced with the ECC_FIELD_BACKEND environment
+// variable ("gmp" or "adx") or mpFp_backend_set, e.g. for A/B benchmarks
+
+typedef struct {
+    const char *name;
+    void (*mul_n)(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp, mp_size_t n);
+    void (*sqr)(mp_limb_t *rp, const mp_limb_t *ap, mp_size_t n);
+} _mpFp_backend_t;
+
+static void _mpFp_mul_n_gmp(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp, mp_size_t n) {
+    mpn_mul_n(rp, ap, bp, n);
+}
+
+static void _mpFp_sqr_gmp(mp_limb_t *rp, const mp_limb_t *ap, mp_size_t n) {
+    mpn_sqr(rp, ap, n);
+}
+
+static const _mpFp_backend_t _mpFp_backend_gmp = {
+    .name = "gmp",
+    .mul_n = _mpFp_mul_n_gmp,
+    .sqr = _mpFp_sqr_gmp
+};
+
+#if defined(__x86_64__) && defined(__GNUC__) && (GMP_NUMB_BITS == 64)
+#define _MPFP_HAVE_ADX_KERNELS
+#include <cpuid.h>
+
+// fully unrolled products for the common field sizes (256, 384 and 448
+// bit) using mulx and the two independent carry chains of adcx/adox. Row i
+// adds a * b[i] into a rotating window of psize + 1 accumulator registers,
+// the low limb of the window is complete after each row
+
+static void _mpFp_mul_4_adx(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+    mp_limb_t h;
+    __asm__ volatile (
+        "movq 0(%[b]), %%rdx\n\t"
+        "mulxq 0(%[a]), %%r8, %%r9\n\t"
+        "mulxq 8(%[a]), %%rax, %%r10\n\t"
+        "addq %%rax, %%r9\n\t"
+        "mulxq 16(%[a]), %%rax, %%r11\n\t"
+        "adcq %%rax, %%r10\n\t"
+        "mulxq 24(%[a]), %%rax, %%r12\n\t"
+        "adcq %%rax, %%r11\n\t"
+        "adcq $0, %%r12\n\t"
+        "movq %%r8, 0(%[r])\n\t"
+        "movq 8(%[b]), %%rdx\n\t"
+        "xorl %%r8d, %%r8d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "adcq $0, %%r8\n\t"
+        "movq %%r9, 8(%[r])\n\t"
+        "movq 16(%[b]), %%rdx\n\t"
+        "xorl %%r9d, %%r9d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "adcq $0, %%r9\n\t"
+        "movq %%r10, 16(%[r])\n\t"
+        "movq 24(%[b]), %%rdx\n\t"
+        "xorl %%r10d, %%r10d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "adcq $0, %%r10\n\t"
+        "movq %%r11, 24(%[r])\n\t"
+        "movq %%r12, 32(%[r])\n\t"
+        "movq %%r8, 40(%[r])\n\t"
+        "movq %%r9, 48(%[r])\n\t"
+        "movq %%r10, 56(%[r])\n\t"
+        : [h] "=&r" (h)
+        : [r] "r" (rp), [a] "r" (ap), [b] "r" (bp)
+        : "r8", "r9", "r10", "r11", "r12", "rax", "rdx", "cc", "memory");
+}
+
+static void _mpFp_mul_6_adx(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+    mp_limb_t h;
+    __asm__ volatile (
+        "movq 0(%[b]), %%rdx\n\t"
+        "mulxq 0(%[a]), %%r8, %%r9\n\t"
+        "mulxq 8(%[a]), %%rax, %%r10\n\t"
+        "addq %%rax, %%r9\n\t"
+        "mulxq 16(%[a]), %%rax, %%r11\n\t"
+        "adcq %%rax, %%r10\n\t"
+        "mulxq 24(%[a]), %%rax, %%r12\n\t"
+        "adcq %%rax, %%r11\n\t"
+        "mulxq 32(%[a]), %%rax, %%r13\n\t"
+        "adcq %%rax, %%r12\n\t"
+        "mulxq 40(%[a]), %%rax, %%r14\n\t"
+        "adcq %%rax, %%r13\n\t"
+        "adcq $0, %%r14\n\t"
+        "movq %%r8, 0(%[r])\n\t"
+        "movq 8(%[b]), %%rdx\n\t"
+        "xorl %%r8d, %%r8d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "adcq $0, %%r8\n\t"
+        "movq %%r9, 8(%[r])\n\t"
+        "movq 16(%[b]), %%rdx\n\t"
+        "xorl %%r9d, %%r9d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "adcq $0, %%r9\n\t"
+        "movq %%r10, 16(%[r])\n\t"
+        "movq 24(%[b]), %%rdx\n\t"
+        "xorl %%r10d, %%r10d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "adcq $0, %%r10\n\t"
+        "movq %%r11, 24(%[r])\n\t"
+        "movq 32(%[b]), %%rdx\n\t"
+        "xorl %%r11d, %%r11d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "adcq $0, %%r11\n\t"
+        "movq %%r12, 32(%[r])\n\t"
+        "movq 40(%[b]), %%rdx\n\t"
+        "xorl %%r12d, %%r12d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "adcq $0, %%r12\n\t"
+        "movq %%r13, 40(%[r])\n\t"
+        "movq %%r14, 48(%[r])\n\t"
+        "movq %%r8, 56(%[r])\n\t"
+        "movq %%r9, 64(%[r])\n\t"
+        "movq %%r10, 72(%[r])\n\t"
+        "movq %%r11, 80(%[r])\n\t"
+        "movq %%r12, 88(%[r])\n\t"
+        : [h] "=&r" (h)
+        : [r] "r" (rp), [a] "r" (ap), [b] "r" (bp)
+        : "r8", "r9", "r10", "r11", "r12", "r13", "r14", "rax", "rdx", "cc", "memory");
+}
+
+static void _mpFp_mul_7_adx(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp) {
+    mp_limb_t h;
+    __asm__ volatile (
+        "movq 0(%[b]), %%rdx\n\t"
+        "mulxq 0(%[a]), %%r8, %%r9\n\t"
+        "mulxq 8(%[a]), %%rax, %%r10\n\t"
+        "addq %%rax, %%r9\n\t"
+        "mulxq 16(%[a]), %%rax, %%r11\n\t"
+        "adcq %%rax, %%r10\n\t"
+        "mulxq 24(%[a]), %%rax, %%r12\n\t"
+        "adcq %%rax, %%r11\n\t"
+        "mulxq 32(%[a]), %%rax, %%r13\n\t"
+        "adcq %%rax, %%r12\n\t"
+        "mulxq 40(%[a]), %%rax, %%r14\n\t"
+        "adcq %%rax, %%r13\n\t"
+        "mulxq 48(%[a]), %%rax, %%r15\n\t"
+        "adcq %%rax, %%r14\n\t"
+        "adcq $0, %%r15\n\t"
+        "movq %%r8, 0(%[r])\n\t"
+        "movq 8(%[b]), %%rdx\n\t"
+        "xorl %%r8d, %%r8d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "adcq $0, %%r8\n\t"
+        "movq %%r9, 8(%[r])\n\t"
+        "movq 16(%[b]), %%rdx\n\t"
+        "xorl %%r9d, %%r9d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "adcq $0, %%r9\n\t"
+        "movq %%r10, 16(%[r])\n\t"
+        "movq 24(%[b]), %%rdx\n\t"
+        "xorl %%r10d, %%r10d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "adcq $0, %%r10\n\t"
+        "movq %%r11, 24(%[r])\n\t"
+        "movq 32(%[b]), %%rdx\n\t"
+        "xorl %%r11d, %%r11d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "adcq $0, %%r11\n\t"
+        "movq %%r12, 32(%[r])\n\t"
+        "movq 40(%[b]), %%rdx\n\t"
+        "xorl %%r12d, %%r12d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r13\n\t"
+        "adoxq %[h], %%r14\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "adcq $0, %%r12\n\t"
+        "movq %%r13, 40(%[r])\n\t"
+        "movq 48(%[b]), %%rdx\n\t"
+        "xorl %%r13d, %%r13d\n\t"
+        "mulxq 0(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r14\n\t"
+        "adoxq %[h], %%r15\n\t"
+        "mulxq 8(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r15\n\t"
+        "adoxq %[h], %%r8\n\t"
+        "mulxq 16(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r8\n\t"
+        "adoxq %[h], %%r9\n\t"
+        "mulxq 24(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r9\n\t"
+        "adoxq %[h], %%r10\n\t"
+        "mulxq 32(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r10\n\t"
+        "adoxq %[h], %%r11\n\t"
+        "mulxq 40(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r11\n\t"
+        "adoxq %[h], %%r12\n\t"
+        "mulxq 48(%[a]), %%rax, %[h]\n\t"
+        "adcxq %%rax, %%r12\n\t"
+        "adoxq %[h], %%r13\n\t"
+        "adcq $0, %%r13\n\t"
+        "movq %%r14, 48(%[r])\n\t"
+        "movq %%r15, 56(%[r])\n\t"
+        "movq %%r8, 64(%[r])\n\t"
+        "movq %%r9, 72(%[r])\n\t"
+        "movq %%r10, 80(%[r])\n\t"
+        "movq %%r11, 88(%[r])\n\t"
+        "movq %%r12, 96(%[r])\n\t"
+        "movq %%r13, 104(%[r])\n\t"
+        : [h] "=&r" (h)
+        : [r] "r" (rp), [a] "r" (ap), [b] "r" (bp)
+        : "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15", "rax", "rdx", "cc", "memory");
+}
+
+static void _mpFp_mul_n_adx(mp_limb_t *rp, const mp_limb_t *ap, const mp_limb_t *bp, mp_size_t n) {
+    switch (n) {
+        case 4:
+            _mpFp_mul_4_adx(rp, ap, bp);
+            return;
+        case 6:
+            _mpFp_mul_6_adx(rp, ap, bp);
+            return;
+        case 7:
+            _mpFp_mul_7_adx(rp, ap, bp);
+            return;
+        default:
+            mpn_mul_n(rp, ap, bp, n);
+    }
+}
+
+// the unrolled products beat GMP's squaring for these sizes
+static void _mpFp_sqr_adx(mp_limb_t *rp, const mp_limb_t *ap, mp_size_t n) {
+    _mpFp_mul_n_adx(rp, ap, ap, n);
+}
+
+static const _mpFp_backend_t _mpFp_backend_adx = {
+    .name = "adx",
+    .mul_n = _mpFp_mul_n_adx,
+    .sqr = _mpFp_sqr_adx
+};
+
+static int _mpFp_cpu_has_adx(void) {
+    unsigned int a, b, c, d;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) == 0) return 0;
+    // BMI2 (mulx) is bit 8, ADX (adcx/adox) bit 19 of ebx
+    return ((b & (1U << 8)) != 0) && ((b & (1U << 19)) != 0);
+}
+#endif
+
+static const _mpFp_backend_t *_mpFp_backend = &_mpFp_backend_gmp;
+
+int mpFp_backend_set(const char *name) {
+    if ((strcmp(name, "gmp") == 0) || (strcmp(name, "generic") == 0)) {
+        _mpFp_backend = &_mpFp_backend_gmp;
+        return 0;
+    }
+#ifdef _MPFP_HAVE_ADX_KERNELS
+    if ((strcmp(name, "adx") == 0) && _mpFp_cpu_has_adx()) {
+        _mpFp_backend = &_mpFp_backend_adx;
+        return 0;
+    }
+#endif
+    return -1;
+}
+
+const char *mpFp_backend_name(void) {
+    return _mpFp_backend->name;
+}
+
+#ifndef _MPECP_TUNE_FILE
+#define _MPECP_TUNE_FILE    "/etc/ecc-tune.conf"
+#endif
+
+// the "backend=<name>" setting of the tuning file (see mpECP_tune_load),
+// copied to name. Nonzero if there is none
+static int _mpFp_backend_tuned(char *name, size_t len) {
+    FILE *f;
+    char line[256];
+    char *path, *tok, *save;
+    int found;
+
+    path = getenv("ECC_TUNE_FILE");
+    if (path == NULL) path = _MPECP_TUNE_FILE;
+    if (path[0] == 0) return -1;
+    f = fopen(path, "r");
+    if (f == NULL) return -1;
+    found = 0;
+    while ((found == 0) && (fgets(line, sizeof(line), f) != NULL)) {
+        tok = strchr(line, '#');
+        if (tok != NULL) *tok = 0;
+        tok = strtok_r(line, " \t\r\n", &save);
+        // global settings are on lines without a curve name
+        if ((tok == NULL) || (strchr(tok, '=') == NULL)) continue;
+        while (tok != NULL) {
+            if ((strncmp(tok, "backend=", 8) == 0) && (strlen(tok + 8) < len)) {
+                strcpy(name, tok + 8);
+                found = 1;
+            }
+            tok = strtok_r(NULL, " \t\r\n", &save);
+        }
+    }
+    fclose(f);
+    return (found != 0) ? 0 : -1;
+}
+
+// the backend is only chosen here, before any other thread can be running
+// field operations (mpFp_backend_set is not thread safe)
+__attribute__((constructor))
+static void _mpFp_backend_init(void) {
+    char *name;
+    char tuned[32];
+#ifdef _MPFP_HAVE_ADX_KERNELS
+    if (_mpFp_cpu_has_adx()) {
+        _mpFp_backend = &_mpFp_backend_adx;
+    }
+#endif
+    // an unknown or unsupported override keeps the default, as does a
+    // backend tuned on another host
+    name = getenv("ECC_FIELD_BACKEND");
+    if (name == NULL) {
+        if (_mpFp_backend_tuned(tuned, sizeof(tuned)) == 0) {
+            mpFp_backend_set(tuned);
+        }
+    } else if (strcmp(name, "auto") != 0) {
+        mpFp_backend_set(name);
+    }
+    return;
+}
+
 void mpFp_field_init(mpFp_field field) {
     mpz_init(field->p);
     mpz_init(field->pc);
@@ -223,18 +767,7 @@ int mpFp_cmp(mpFp_t a, mpFp_t b) {
 }
 
 int mpFp_cmp_ui(mpFp_t a, unsigned long b) {
-    mpFp_field_ptr fp;
-    mp_limb_t b_limb;
-    int cmp;
-    int i;
-    fp = a->fp;
-    b_limb = b;
-
-    cmp = !(b_limb == a->i->_mp_d[0]);
-    for (i = 1; i < fp->psize; i++) {
-        cmp |= !(0 == a->i->_mp_d[i]);
-    }
-    return cmp;
+    return _mpFp_cmp_ui_inline(a, b);
 }
 
 int mpFp_cmp_mpz(mpFp_t a, mpz_t b) {
@@ -261,51 +794,12 @@ int mpFp_cmp_mpz(mpFp_t a, mpz_t b) {
 }
 
 void mpFp_neg(mpFp_t c, mpFp_t a) {
-    mpFp_field_ptr fp;
-    mp_limb_t borrow;
-    int i;
-    c->fp = a->fp;
-    fp = a->fp;
-    //mpz_realloc(c->i, fp->p2size);
-    mpFp_realloc(c);
-
-    // -0 = 0, need to detect 0
-    borrow = 0;
-    for (i = 0; i < a->fp->psize; i++) {
-        borrow |= a->i->_mp_d[i];
-    }
-
-    if (__GMP_UNLIKELY(borrow == 0)) {
-        for (i = 0; i < a->fp->psize; i++) {
-            c->i->_mp_d[i] = 0;
-        }
-    } else {
-        borrow = mpn_sub_n(c->i->_mp_d, fp->p->_mp_d, a->i->_mp_d, fp->psize);
-        PARANOID_ASSERT(borrow == 0);
-    }
-
-    c->i->_mp_size = fp->psize;
-    //c->fp = fp;
+    _mpFp_neg_inline(c, a);
     return;
 }
 
 void mpFp_add(mpFp_t c, mpFp_t a, mpFp_t b) {
-    mpFp_field_ptr fp;
-    mp_limb_t carry, borrow;
-    PARANOID_ASSERT(a->fp == b->fp);
-    c->fp = a->fp;
-    fp = a->fp;
-    //mpz_realloc(c->i, fp->p2size);
-    mpFp_realloc(c);
-
-    carry = mpn_add_n(c->i->_mp_d, a->i->_mp_d, b->i->_mp_d, fp->psize);
-    if ((carry != 0) || (mpn_cmp(c->i->_mp_d, fp->p->_mp_d, fp->psize) >= 0)) {
-        borrow = mpn_sub_n(c->i->_mp_d, c->i->_mp_d, fp->p->_mp_d, fp->psize);
-        PARANOID_ASSERT(borrow == carry);
-    }
-
-    c->i->_mp_size = fp->psize;
-    //c->fp = fp;
+    _mpFp_add_inline(c, a, b);
     return;
 }
 
@@ -334,22 +828,7 @@ void mpFp_add_ui(mpFp_t c, mpFp_t a, unsigned long int b) {
 }
 
 void mpFp_sub(mpFp_t c, mpFp_t a, mpFp_t b) {
-    mpFp_field_ptr fp;
-    mp_limb_t carry, borrow;
-    PARANOID_ASSERT(a->fp == b->fp);
-    c->fp = a->fp;
-    fp = a->fp;
-    //mpz_realloc(c->i, fp->p2size);
-    mpFp_realloc(c);
-
-    borrow = mpn_sub_n(c->i->_mp_d, a->i->_mp_d, b->i->_mp_d, fp->psize);
-    if (borrow != 0) {
-        carry = mpn_add_n(c->i->_mp_d, fp->p->_mp_d, c->i->_mp_d, fp->psize);
-        PARANOID_ASSERT(carry == 1);
-    }
-
-    c->i->_mp_size = fp->psize;
-    //c->fp = fp;
+    _mpFp_sub_inline(c, a, b);
     return;
 }
 
@@ -427,7 +906,7 @@ void mpFp_mul(mpFp_t c, mpFp_t a, mpFp_t b) {
     c->fp = a->fp;
     mpFp_realloc(c);
 
-    mpn_mul_n(tl, a->i->_mp_d, b->i->_mp_d, fp->psize);
+    _mpFp_backend->mul_n(tl, a->i->_mp_d, b->i->_mp_d, fp->psize);
     t->_mp_d = tl;
     t->_mp_size = fp->p2size;
     t->_mp_alloc = fp->p2size;
@@ -486,7 +965,7 @@ void mpFp_sqr(mpFp_t c, mpFp_t a) {
     c->fp = a->fp;
     mpFp_realloc(c);
 
-    mpn_sqr(tl, a->i->_mp_d, fp->psize);
+    _mpFp_backend->sqr(tl, a->i->_mp_d, fp->psize);
     t->_mp_d = tl;
     t->_mp_size = fp->p2size;
     t->_mp_alloc = fp->p2size;
@@ -561,25 +1040,22 @@ void mpFp_swap(mpFp_t a, mpFp_t b) {
 }
 
 void mpFp_cswap(mpFp_t a, mpFp_t b, int swap) {
+    _mpFp_cswap_inline(a, b, swap);
+    return;
+}
+
+void mpFp_cmov(mpFp_t c, mpFp_t a, int move) {
     mpFp_field_ptr fp;
     int i;
-    mp_limb_t tl[2][_MPFP_MAX_LIMBS*2];
+    mp_limb_t mask;
     fp = a->fp;
     PARANOID_ASSERT(fp != NULL);
-    PARANOID_ASSERT(fp->psize <= _MPFP_MAX_LIMBS);
-    PARANOID_ASSERT(a->fp == b->fp);
-    swap = (swap != 0);
-    assert(swap >= 0);
-    assert(swap < 2);
-
-    for (i = 0; i < fp->psize; i++) {
-        tl[0][i] = a->i->_mp_d[i];
-        tl[1][i] = b->i->_mp_d[i];
-    }
+    PARANOID_ASSERT(c->fp == a->fp);
+    // mask is all ones if move, else zero
+    mask = ((mp_limb_t)0) - ((mp_limb_t)(move != 0));
 
     for (i = 0; i < fp->psize; i++) {
-        a->i->_mp_d[i] = tl[0+swap][i];
-        b->i->_mp_d[i] = tl[1-swap][i];
+        c->i->_mp_d[i] ^= mask & (c->i->_mp_d[i] ^ a->i->_mp_d[i]);
     }
     return;
 }
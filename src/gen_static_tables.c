@@ -0,0 +1,143 @@
+//BSD 3-Clause License
+//
+//Copyright (c) 2018, jadeblaquiere
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions are met:
+//
+//* Redistributions of source code must retain the above copyright notice, this
+//  list of conditions and the following disclaimer.
+//
+//* Redistributions in binary form must reproduce the above copyright notice,
+//  this list of conditions and the following disclaimer in the documentation
+//  and/or other materials provided with the distribution.
+//
+//* Neither the name of the copyright holder nor the names of its
+//  contributors may be used to endorse or promote products derived from
+//  this software without specific prior written permission.
+//
+//THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <assert.h>
+#include <ecpoint.h>
+#include <ecurve.h>
+#include <gmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// gen_static_tables writes (to stdout) a C source file which contains the
+// affine fixed-base tables for the generator of each selected named curve as
+// read only data, and _mpECP_static_base_table() to look them up by name.
+//
+// usage: gen_static_tables <curve[,curve...]|all|none>
+//
+// The tables depend on the limb size of the build host (GMP_NUMB_BITS), so
+// the generated file is only valid for a native build.
+
+static int _curve_selected(char *name, char *list) {
+    char *s;
+    size_t len;
+
+    if (strcmp(list, "all") == 0) return 1;
+    len = strlen(name);
+    s = list;
+    while (*s != 0) {
+        if ((strncmp(s, name, len) == 0) && ((s[len] == 0) || (s[len] == ','))) {
+            return 1;
+        }
+        s = strchr(s, ',');
+        if (s == NULL) break;
+        s++;
+    }
+    return 0;
+}
+
+static void _print_table(int id, _mpECP_base_table_t *tbl) {
+    size_t i, nlimbs;
+
+    nlimbs = tbl->bytes / sizeof(mp_limb_t);
+    printf("static const mp_limb_t _static_limbs_%d[%zu] __attribute__((aligned(64))) = {", id, nlimbs);
+    for (i = 0; i < nlimbs; i++) {
+        if ((i % 4) == 0) printf("\n   ");
+        printf(" (mp_limb_t)0x%0*llxULL,", (int)(GMP_NUMB_BITS / 4),
+            (unsigned long long)tbl->limbs[i]);
+    }
+    printf("\n};\n\n");
+    printf("static _mpECP_base_table_t _static_table_%d = {\n", id);
+    printf("    %d, %d, %d, %ld,\n", tbl->window_bits, tbl->levels,
+        tbl->level_size, (long)tbl->psize);
+    printf("    (mp_limb_t *)_static_limbs_%d, sizeof(_static_limbs_%d), 1, 1\n", id, id);
+    printf("};\n\n");
+}
+
+int main(int argc, char **argv) {
+    int i, n, status;
+    char **clist;
+    char **names;
+    mpECurve_t cv;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <curve[,curve...]|all|none>\n", argv[0]);
+        return 1;
+    }
+
+    printf("// generated by gen_static_tables, do not edit\n\n");
+    printf("#include <ecpoint.h>\n");
+    printf("#include <gmp.h>\n");
+    printf("#include <stdlib.h>\n");
+    printf("#include <string.h>\n\n");
+    printf("#if GMP_NUMB_BITS != %d\n", (int)GMP_NUMB_BITS);
+    printf("#error \"static tables were generated for %d bit limbs\"\n", (int)GMP_NUMB_BITS);
+    printf("#endif\n\n");
+
+    mpECurve_init(cv);
+    clist = _mpECurve_list_standard_curves();
+    n = 0;
+    while (clist[n] != NULL) n++;
+    names = (char **)malloc((n + 1) * sizeof(char *));
+    assert(names != NULL);
+
+    n = 0;
+    for (i = 0; clist[i] != NULL; i++) {
+        mpECP_t G;
+
+        if (_curve_selected(clist[i], argv[1]) == 0) continue;
+        status = mpECurve_set_named(cv, clist[i]);
+        assert(status == 0);
+        mpECP_init(G, cv);
+        mpECP_set_mpz(G, cv->G[0], cv->G[1], cv);
+        status = mpECP_scalar_base_mul_setup_ex(G, 0, 0);
+        assert(status == 0);
+        assert(G->base_tbl != NULL);
+        _print_table(n, G->base_tbl);
+        mpECP_clear(G);
+        names[n] = clist[i];
+        n++;
+    }
+
+    printf("_mpECP_base_table_t *_mpECP_static_base_table(const char *name) {\n");
+    for (i = 0; i < n; i++) {
+        printf("    if (strcmp(name, \"%s\") == 0) return &_static_table_%d;\n", names[i], i);
+    }
+    printf("    return NULL;\n");
+    printf("}\n");
+
+    for (i = 0; clist[i] != NULL; i++) {
+        free(clist[i]);
+    }
+    free(clist);
+    free(names);
+    mpECurve_clear(cv);
+    return 0;
+}
@@ -32,9 +32,13 @@
 #include <check.h>
 #include <ecurve.h>
 #include <gmp.h>
+#include <mpzurandom.h>
 #include <ecpoint.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 START_TEST(test_mpECP_create)
     int error;
@@ -617,6 +621,942 @@ START_TEST(test_mpECP_scalar_mul)
     mpECurve_clear(cv);
 END_TEST
 
+START_TEST(test_mpECP_scalar_mul_window)
+    int error, i, w, ncurves;
+    char *test_curve[] = {"secp160k1", "secp256k1", "Curve25519", "Curve41417", "Ed25519", "E-521"};
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        int j;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        printf("window scalar multiply curve %s (default w = %d)\n",
+            test_curve[i], mpECP_scalar_mul_window_bits(cv));
+        for (j = 0; j < 8; j++) {
+            mpECP_urandom(a, cv);
+            mpFp_urandom(k, cv->n);
+            // include small, even and n - 1 scalars
+            if (j == 0) mpFp_set_ui(k, 0, cv->n);
+            if (j == 1) mpFp_set_ui(k, 1, cv->n);
+            if (j == 2) mpFp_set_ui(k, 2, cv->n);
+            if (j == 3) {
+                mpFp_set_ui(k, 1, cv->n);
+                mpFp_neg(k, k);
+            }
+            mpECP_scalar_mul_ladder(b, a, k);
+            for (w = 2; w <= 7; w++) {
+                mpECP_scalar_mul_window(c, a, k, w);
+                assert(mpECP_cmp(b, c) == 0);
+            }
+            mpECP_scalar_mul(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_mul_vartime)
+    int error, i, ncurves;
+    char *test_curve[] = {"secp160k1", "secp256k1", "Curve25519", "Curve41417", "Ed25519", "E-521"};
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpz_t kz;
+    mpECurve_init(cv);
+    mpz_init(kz);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        int j;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        printf("vartime scalar multiply curve %s\n", test_curve[i]);
+        for (j = 0; j < 16; j++) {
+            mpECP_urandom(a, cv);
+            mpFp_urandom(k, cv->n);
+            // small scalars use narrower windows
+            if (j < 4) mpFp_set_ui(k, j, cv->n);
+            if (j == 4) mpFp_set_ui(k, 0x12345, cv->n);
+            if (j == 5) {
+                mpFp_set_ui(k, 1, cv->n);
+                mpFp_neg(k, k);
+            }
+            mpECP_scalar_mul_ladder(b, a, k);
+            mpECP_scalar_mul_vartime(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        // unreduced scalar, n * P is neutral for P in the subgroup
+        mpz_set(kz, cv->n);
+        mpECP_scalar_mul_vartime_mpz(b, a, kz);
+        mpECP_set_neutral(c, cv);
+        assert(mpECP_cmp(b, c) == 0);
+        // negative scalar
+        mpz_set_si(kz, -3);
+        mpECP_scalar_mul_vartime_mpz(b, a, kz);
+        mpECP_scalar_mul_mpz(c, a, kz);
+        assert(mpECP_cmp(b, c) == 0);
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpz_clear(kz);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_mul_glv)
+    int error, i, w, ncurves;
+    char *test_curve[] = {"secp160k1", "secp192k1", "secp224k1", "secp256k1", "secp256r1"};
+    int has_glv[] = {1, 1, 1, 1, 0};
+    mpECurve_t cv, cv2;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpECurve_init(cv);
+    mpECurve_init(cv2);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        int j;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        assert((cv->glv.enabled != 0) == has_glv[i]);
+        // later instances reuse the parameters of the canonical curve
+        error = mpECurve_set_named(cv2, test_curve[i]);
+        assert(error == 0);
+        assert(cv2->glv.enabled == cv->glv.enabled);
+        if (cv->glv.enabled != 0) {
+            assert(mpFp_cmp(cv2->glv.beta, cv->glv.beta) == 0);
+            assert(mpz_cmp(cv2->glv.lambda, cv->glv.lambda) == 0);
+            assert(mpz_cmp(cv2->glv.a1, cv->glv.a1) == 0);
+            assert(mpz_cmp(cv2->glv.b2, cv->glv.b2) == 0);
+            assert(cv2->glv.bits == cv->glv.bits);
+        }
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        printf("GLV scalar multiply curve %s (enabled = %d)\n", test_curve[i],
+            cv->glv.enabled);
+        for (j = 0; j < 8; j++) {
+            mpECP_urandom(a, cv);
+            mpFp_urandom(k, cv->n);
+            if (j == 0) mpFp_set_ui(k, 0, cv->n);
+            if (j == 1) mpFp_set_ui(k, 1, cv->n);
+            if (j == 2) mpFp_set_ui(k, 2, cv->n);
+            if (j == 3) {
+                mpFp_set_ui(k, 1, cv->n);
+                mpFp_neg(k, k);
+            }
+            mpECP_scalar_mul_ladder(b, a, k);
+            for (w = 2; w <= 6; w++) {
+                mpECP_scalar_mul_glv(c, a, k, w);
+                assert(mpECP_cmp(b, c) == 0);
+            }
+            mpECP_scalar_mul(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_scalar_mul_vartime(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv2);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_multi_scalar_mul)
+    int error, i, j, n, ncurves;
+    char *test_curve[] = {"secp192r1", "secp256k1", "Ed25519", "Curve25519", "E-222"};
+    mpECurve_t cv;
+    mpECP_t pts[4];
+    mpFp_t sc[4];
+    mpECP_t a, b, c;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        for (j = 0; j < 4; j++) {
+            mpECP_init(pts[j], cv);
+            mpFp_init(sc[j], cv->n);
+        }
+        printf("multi scalar multiply curve %s\n", test_curve[i]);
+        for (n = 1; n <= 4; n++) {
+            for (j = 0; j < n; j++) {
+                mpECP_urandom(pts[j], cv);
+                mpFp_urandom(sc[j], cv->n);
+            }
+            // zero scalars, repeated and neutral points
+            if (n == 2) mpFp_set_ui(sc[1], 0, cv->n);
+            if (n == 3) mpECP_set(pts[2], pts[0]);
+            if (n == 4) mpECP_set_neutral(pts[3], cv);
+            mpECP_set_neutral(b, cv);
+            for (j = 0; j < n; j++) {
+                mpECP_scalar_mul_ladder(a, pts[j], sc[j]);
+                mpECP_add(b, b, a);
+            }
+            mpECP_multi_scalar_mul(c, pts, sc, n);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_multi_scalar_mul_vartime(c, pts, sc, n);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        // aP - aP
+        mpECP_neg(pts[1], pts[0]);
+        mpFp_set(sc[1], sc[0]);
+        mpECP_set_neutral(b, cv);
+        mpECP_multi_scalar_mul(c, pts, sc, 2);
+        assert(mpECP_cmp(b, c) == 0);
+        mpECP_multi_scalar_mul_vartime(c, pts, sc, 2);
+        assert(mpECP_cmp(b, c) == 0);
+        for (j = 0; j < 4; j++) {
+            mpFp_clear(sc[j]);
+            mpECP_clear(pts[j]);
+        }
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_multi_scalar_mul_pippenger)
+    int error, i, j, n, ncurves;
+    char *test_curve[] = {"secp256k1", "Ed25519", "Curve25519"};
+    mpECurve_t cv;
+    mpECP_t pts[200];
+    mpFp_t sc[200];
+    mpECP_t a, b, c;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpECP_urandom(a, cv);
+        for (j = 0; j < 200; j++) {
+            mpECP_init(pts[j], cv);
+            if (j == 0) {
+                mpECP_set(pts[j], a);
+            } else {
+                mpECP_add(pts[j], pts[j-1], a);
+            }
+            mpFp_init(sc[j], cv->n);
+            mpFp_urandom(sc[j], cv->n);
+        }
+        // zero and -1 scalars, neutral and repeated points
+        mpFp_set_ui(sc[3], 0, cv->n);
+        mpFp_set_ui(sc[4], 1, cv->n);
+        mpFp_neg(sc[4], sc[4]);
+        mpECP_set_neutral(pts[5], cv);
+        mpECP_set(pts[6], pts[7]);
+        printf("pippenger multi scalar multiply curve %s\n", test_curve[i]);
+        for (n = 1; n <= 40; n += 13) {
+            mpECP_multi_scalar_mul_vartime(b, pts, sc, n);
+            mpECP_multi_scalar_mul_pippenger(c, pts, sc, n, 1);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_multi_scalar_mul_pippenger(c, pts, sc, n, 3);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        // large n uses the bucket method
+        mpECP_set_neutral(b, cv);
+        for (j = 0; j < 200; j++) {
+            mpECP_scalar_mul_vartime(a, pts[j], sc[j]);
+            mpECP_add(b, b, a);
+        }
+        mpECP_multi_scalar_mul_vartime(c, pts, sc, 200);
+        assert(mpECP_cmp(b, c) == 0);
+        mpECP_multi_scalar_mul_pippenger(c, pts, sc, 200, 0);
+        assert(mpECP_cmp(b, c) == 0);
+        for (j = 0; j < 200; j++) {
+            mpFp_clear(sc[j]);
+            mpECP_clear(pts[j]);
+        }
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_curve_ops)
+    int error, i, j, len;
+    char **clist;
+    mpECurve_t cv;
+    mpECP_t a, b, c, d;
+    mpFp_t k;
+    unsigned char *buf;
+    mpECurve_init(cv);
+
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while (clist[i] != NULL) {
+        error = mpECurve_set_named(cv, clist[i]);
+        assert(error == 0);
+        assert(cv->ops != NULL);
+        printf("curve ops %s : %s (%s, %s)\n", clist[i], cv->ops->name,
+            mpECP_formulas_name(cv, MPECP_FORMULAS_SECRET),
+            mpECP_formulas_name(cv, MPECP_FORMULAS_PUBLIC));
+        // a = 0 curves get specialized formulas
+        if ((cv->type == EQTypeShortWeierstrass) &&
+            (mpFp_cmp_ui(cv->coeff.ws.a, 0) == 0)) {
+            assert(strcmp(mpECP_formulas_name(cv, MPECP_FORMULAS_SECRET), "rcb-a0") == 0);
+        }
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpECP_init(d, cv);
+        // Montgomery points are stored as (u : v : 1), not mapped to WS
+        if (cv->type == EQTypeMontgomery) {
+            assert(strcmp(mpECP_formulas_name(cv, MPECP_FORMULAS_SECRET), "montgomery") == 0);
+            mpECP_set_mpz(a, cv->G[0], cv->G[1], cv);
+            mpFp_init_fp(k, cv->fp);
+            mpFp_set_mpz_fp(k, cv->G[0], cv->fp);
+            assert(mpFp_cmp(a->x, k) == 0);
+            mpFp_clear(k);
+        }
+        mpECP_urandom(a, cv);
+        for (j = 0; j < 20; j++) {
+            // double agrees with add, also in place
+            mpECP_double(b, a);
+            mpECP_add(c, a, a);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_set(d, a);
+            mpECP_double(d, d);
+            assert(mpECP_cmp(b, d) == 0);
+            // 3a - a = 2a, a - a = 0
+            mpECP_add(c, b, a);
+            mpECP_sub(d, c, a);
+            assert(mpECP_cmp(d, b) == 0);
+            mpECP_neg(d, a);
+            mpECP_add(d, d, a);
+            mpECP_set_neutral(b, cv);
+            assert(mpECP_cmp(d, b) == 0);
+            // compressed encoding round trip (solve_y)
+            len = mpECP_out_bytelen(c, 1);
+            buf = (unsigned char *)malloc(len);
+            assert(buf != NULL);
+            mpECP_out_bytes(buf, c, 1);
+            error = mpECP_set_bytes(d, buf, len, cv);
+            assert(error == 0);
+            assert(mpECP_cmp(c, d) == 0);
+            free(buf);
+            mpECP_set(a, c);
+        }
+        // ladder (ladder_step) and mixed add (vartime) paths agree
+        mpFp_init(k, cv->n);
+        mpFp_urandom(k, cv->n);
+        mpECP_scalar_mul_ladder(b, a, k);
+        mpECP_scalar_mul_vartime(c, a, k);
+        assert(mpECP_cmp(b, c) == 0);
+        mpECP_scalar_mul(c, a, k);
+        assert(mpECP_cmp(b, c) == 0);
+        mpFp_clear(k);
+        mpECP_clear(d);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        free(clist[i]);
+        i++;
+    }
+    free(clist);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_mul_coz)
+    int error, i, j;
+    char **clist;
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpz_t e;
+    mpECurve_init(cv);
+    mpz_init(e);
+
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while (clist[i] != NULL) {
+        error = mpECurve_set_named(cv, clist[i]);
+        assert(error == 0);
+        if ((cv->type != EQTypeShortWeierstrass) &&
+            (cv->type != EQTypeMontgomery)) {
+            free(clist[i]);
+            i++;
+            continue;
+        }
+        printf("co-Z ladder %s\n", clist[i]);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        mpECP_urandom(a, cv);
+        for (j = 0; j < 20; j++) {
+            // random scalars, then 0, 1, 2 and n-1, n-2
+            if (j < 15) {
+                mpFp_urandom(k, cv->n);
+            } else {
+                if (j < 18) {
+                    mpz_set_ui(e, j - 15);
+                } else {
+                    mpz_sub_ui(e, cv->n, j - 17);
+                }
+                mpFp_set_mpz(k, e, cv->n);
+            }
+            mpECP_scalar_mul_ladder(b, a, k);
+            mpECP_scalar_mul_coz(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+            // in place
+            mpECP_set(c, a);
+            mpECP_scalar_mul_coz(c, c, k);
+            assert(mpECP_cmp(b, c) == 0);
+            mpECP_add(a, a, b);
+        }
+        // neutral input
+        mpECP_set_neutral(a, cv);
+        mpECP_scalar_mul_coz(c, a, k);
+        assert(mpECP_cmp(a, c) == 0);
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        free(clist[i]);
+        i++;
+    }
+    free(clist);
+    mpz_clear(e);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_mul_x)
+    int error, i, j, len, bytes, twist;
+    char **clist;
+    mpECurve_t cv;
+    mpECP_t a, b;
+    mpFp_t k, x, rx, t;
+    unsigned char *buf, *rbuf;
+    mpECurve_init(cv);
+
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while (clist[i] != NULL) {
+        error = mpECurve_set_named(cv, clist[i]);
+        assert(error == 0);
+        if ((cv->type != EQTypeShortWeierstrass) &&
+            (cv->type != EQTypeMontgomery)) {
+            free(clist[i]);
+            i++;
+            continue;
+        }
+        printf("x-only ladder %s\n", clist[i]);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpFp_init(k, cv->n);
+        mpFp_init_fp(x, cv->fp);
+        mpFp_init_fp(rx, cv->fp);
+        mpFp_init_fp(t, cv->fp);
+        bytes = (cv->bits + 7) >> 3;
+        len = mpECP_out_bytelen(a, 0);
+        buf = (unsigned char *)malloc(len);
+        rbuf = (unsigned char *)malloc(len);
+        assert((buf != NULL) && (rbuf != NULL));
+        mpECP_urandom(a, cv);
+        for (j = 0; j < 10; j++) {
+            mpFp_urandom(k, cv->n);
+            mpECP_scalar_mul(b, a, k);
+            mpFp_set_mpECP_affine_x(x, a);
+            error = mpECP_scalar_mul_x(rx, x, k, cv);
+            assert(error == 0);
+            mpFp_set_mpECP_affine_x(t, b);
+            assert(mpFp_cmp(rx, t) == 0);
+            // compressed and uncompressed input
+            mpECP_out_bytes(rbuf, b, 1);
+            mpECP_out_bytes(buf, a, 1);
+            error = mpECP_scalar_mul_x_bytes(buf, buf, 1 + bytes, k, cv);
+            assert(error == 0);
+            assert(memcmp(buf, rbuf + 1, bytes) == 0);
+            mpECP_out_bytes(buf, a, 0);
+            error = mpECP_scalar_mul_x_bytes(buf, buf, len, k, cv);
+            assert(error == 0);
+            assert(memcmp(buf, rbuf + 1, bytes) == 0);
+            mpECP_add(a, a, b);
+        }
+        // k = 0 has no x
+        mpFp_set_ui(k, 0, cv->n);
+        error = mpECP_scalar_mul_x(rx, x, k, cv);
+        assert(error != 0);
+        // x coordinates on the twist are rejected
+        twist = 0;
+        for (j = 0; j < 100; j++) {
+            mpFp_urandom(x, cv->fp->p);
+            if (cv->type == EQTypeMontgomery) {
+                mpFp_add(t, x, cv->coeff.mo.A);
+                mpFp_mul(t, t, x);
+                mpFp_add_ui(t, t, 1);
+                mpFp_mul(t, t, x);
+                mpFp_mul(t, t, cv->coeff.mo.Binv);
+            } else {
+                mpFp_sqr(t, x);
+                mpFp_add(t, t, cv->coeff.ws.a);
+                mpFp_mul(t, t, x);
+                mpFp_add(t, t, cv->coeff.ws.b);
+            }
+            if (mpFp_sqrt(t, t) != 0) {
+                mpFp_urandom(k, cv->n);
+                error = mpECP_scalar_mul_x(rx, x, k, cv);
+                assert(error != 0);
+                twist += 1;
+            }
+        }
+        assert(twist > 0);
+        free(rbuf);
+        free(buf);
+        mpFp_clear(t);
+        mpFp_clear(rx);
+        mpFp_clear(x);
+        mpFp_clear(k);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        free(clist[i]);
+        i++;
+    }
+    free(clist);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_formulas)
+    int error, i, j, c, f, nf;
+    char **clist;
+    const char *names[16];
+    mpECurve_t cv;
+    mpECP_t a, b, c1, c2;
+    mpECP_t *pts;
+    mpFp_t k;
+    mpFp_t *sc;
+    mpECurve_init(cv);
+
+    clist = _mpECurve_list_standard_curves();
+    i = 0;
+    while (clist[i] != NULL) {
+        error = mpECurve_set_named(cv, clist[i]);
+        assert(error == 0);
+        // variable time sets are never used for secret data
+        nf = mpECP_formulas_list(cv, MPECP_FORMULAS_SECRET, names, 16);
+        assert((nf > 0) && (nf <= 16));
+        for (f = 0; f < nf; f++) {
+            assert(strncmp(names[f], "jacobian", 8) != 0);
+        }
+        if (cv->type == EQTypeShortWeierstrass) {
+            assert(mpECP_formulas_set(cv, MPECP_FORMULAS_SECRET, "jacobian") != 0);
+            assert(mpECP_formulas_set(cv, MPECP_FORMULAS_PUBLIC, "jacobian") == 0);
+        }
+        assert(mpECP_formulas_set(cv, MPECP_FORMULAS_PUBLIC, "no-such-formulas") != 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c1, cv);
+        mpECP_init(c2, cv);
+        mpFp_init(k, cv->n);
+        pts = (mpECP_t *)malloc(3 * sizeof(mpECP_t));
+        sc = (mpFp_t *)malloc(3 * sizeof(mpFp_t));
+        assert((pts != NULL) && (sc != NULL));
+        for (j = 0; j < 3; j++) {
+            mpECP_init(pts[j], cv);
+            mpECP_urandom(pts[j], cv);
+            mpFp_init(sc[j], cv->n);
+            mpFp_urandom(sc[j], cv->n);
+        }
+        mpECP_urandom(a, cv);
+        mpFp_urandom(k, cv->n);
+        // reference results with the default formulas
+        mpECP_scalar_mul_ladder(b, a, k);
+        mpECP_multi_scalar_mul(c1, pts, sc, 3);
+        for (c = 0; c < 2; c++) {
+            nf = mpECP_formulas_list(cv, c, names, 16);
+            for (f = 0; f < nf; f++) {
+                printf("formulas %s : %s %s\n", clist[i],
+                    (c == MPECP_FORMULAS_SECRET) ? "secret" : "public", names[f]);
+                error = mpECP_formulas_set(cv, c, names[f]);
+                assert(error == 0);
+                assert(strcmp(mpECP_formulas_name(cv, c), names[f]) == 0);
+                if (c == MPECP_FORMULAS_SECRET) {
+                    mpECP_scalar_mul_ladder(c2, a, k);
+                    assert(mpECP_cmp(b, c2) == 0);
+                    mpECP_scalar_mul_window(c2, a, k, 4);
+                    assert(mpECP_cmp(b, c2) == 0);
+                } else {
+                    mpECP_scalar_mul_vartime(c2, a, k);
+                    assert(mpECP_cmp(b, c2) == 0);
+                    mpECP_multi_scalar_mul_vartime(c2, pts, sc, 3);
+                    assert(mpECP_cmp(c1, c2) == 0);
+                    // n * P == 0 exercises the exceptional cases of the
+                    // incomplete (short-WS) formulas
+                    if ((cv->type == EQTypeShortWeierstrass) ||
+                        (cv->type == EQTypeMontgomery)) {
+                        mpECP_scalar_mul_vartime_mpz(c2, a, cv->n);
+                        assert(c2->is_neutral != 0);
+                    }
+                }
+            }
+            // restore the default
+            assert(mpECP_formulas_set(cv, c, names[0]) == 0);
+        }
+        for (j = 0; j < 3; j++) {
+            mpFp_clear(sc[j]);
+            mpECP_clear(pts[j]);
+        }
+        free(sc);
+        free(pts);
+        mpFp_clear(k);
+        mpECP_clear(c2);
+        mpECP_clear(c1);
+        mpECP_clear(b);
+        mpECP_clear(a);
+        free(clist[i]);
+        i++;
+    }
+    free(clist);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_batch_out_bytes)
+    int error, i, j, c, ncurves, len;
+    char *test_curve[] = {"secp256k1", "Ed25519", "Curve25519", "E-222"};
+    mpECurve_t cv;
+    mpECP_t pts[20];
+    mpECP_t a, b;
+    unsigned char *buf, *one;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_urandom(a, cv);
+        // projective points (Z != 1), one neutral
+        for (j = 0; j < 20; j++) {
+            mpECP_init(pts[j], cv);
+            mpECP_double(a, a);
+            mpECP_add(pts[j], a, a);
+        }
+        mpECP_set_neutral(pts[7], cv);
+        for (c = 0; c < 2; c++) {
+            len = mpECP_out_bytelen(pts[0], c);
+            buf = (unsigned char *)malloc(20 * (len + 3));
+            one = (unsigned char *)malloc(len);
+            assert((buf != NULL) && (one != NULL));
+            mpECP_batch_out_bytes(buf, len + 3, pts, 20, c);
+            for (j = 0; j < 20; j++) {
+                if (j != 7) assert(mpFp_cmp_ui(pts[j]->z, 1) == 0);
+                mpECP_set(b, pts[j]);
+                mpECP_out_bytes(one, b, c);
+                assert(memcmp(one, buf + (j * (len + 3)), len) == 0);
+                if (j == 7) continue;
+                error = mpECP_set_bytes(b, buf + (j * (len + 3)), len, cv);
+                assert(error == 0);
+                assert(mpECP_cmp(b, pts[j]) == 0);
+            }
+            free(one);
+            free(buf);
+        }
+        // batch normalization keeps the value of the points
+        mpECP_set(b, pts[3]);
+        mpECP_add(pts[3], pts[3], pts[3]);
+        mpECP_double(b, b);
+        mpECP_batch_to_affine(pts, 20);
+        assert(mpFp_cmp_ui(pts[3]->z, 1) == 0);
+        assert(mpECP_cmp(b, pts[3]) == 0);
+        for (j = 0; j < 20; j++) {
+            mpECP_clear(pts[j]);
+        }
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_batch_set_bytes)
+    int error, i, j, c, n, ncurves, len, stride;
+    char *test_curve[] = {"secp256k1", "Ed25519", "Curve25519", "E-222", "Ed448-Goldilocks"};
+    mpECurve_t cv;
+    mpECP_t *pts, *rpts;
+    mpECP_t a, b;
+    unsigned char *buf;
+    int *status;
+    mpECurve_init(cv);
+
+    n = 2100;
+    pts = (mpECP_t *)malloc(n * sizeof(mpECP_t));
+    rpts = (mpECP_t *)malloc(n * sizeof(mpECP_t));
+    status = (int *)malloc(n * sizeof(int));
+    assert((pts != NULL) && (rpts != NULL) && (status != NULL));
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        printf("batch import curve %s\n", test_curve[i]);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_urandom(a, cv);
+        for (j = 0; j < n; j++) {
+            mpECP_init(pts[j], cv);
+            mpECP_init(rpts[j], cv);
+            if (j == 0) {
+                mpECP_set(pts[j], a);
+            } else {
+                mpECP_add(pts[j], pts[j-1], a);
+            }
+        }
+        mpECP_set_neutral(pts[5], cv);
+        for (c = 0; c < 2; c++) {
+            len = mpECP_out_bytelen(pts[0], c);
+            stride = len + 1;
+            buf = (unsigned char *)malloc(n * stride);
+            assert(buf != NULL);
+            mpECP_batch_out_bytes(buf, stride, pts, n, c);
+            error = mpECP_batch_set_bytes(rpts, status, buf, stride, len, n, cv, 1);
+            assert(error == 0);
+            for (j = 0; j < n; j++) {
+                assert(status[j] == 0);
+                assert(mpECP_cmp(rpts[j], pts[j]) == 0);
+            }
+            // invalid prefix, coordinate >= p, off curve (or no root)
+            buf[stride * 7] = 5;
+            memset(&buf[(stride * 8) + 1], 0xFF, len - 1);
+            buf[(stride * 9) + len - 1] ^= 0x01;
+            error = mpECP_batch_set_bytes(rpts, status, buf, stride, len, n, cv, 0);
+            for (j = 0; j < n; j++) {
+                if ((j == 7) || (j == 8)) {
+                    assert(status[j] != 0);
+                } else if (j != 9) {
+                    assert(status[j] == 0);
+                    assert(mpECP_cmp(rpts[j], pts[j]) == 0);
+                }
+                // a compressed x may still be valid, with another y
+                if ((j == 9) && (status[j] == 0)) {
+                    mpECP_set(b, rpts[j]);
+                    assert(mpECP_cmp(b, pts[j]) != 0);
+                }
+            }
+            assert(error == (2 + (status[9] != 0)));
+            if (c == 0) assert(status[9] != 0);
+            // wrong length
+            error = mpECP_batch_set_bytes(rpts, status, buf, stride, len - 1, 4, cv, 2);
+            assert(error == 4);
+            free(buf);
+        }
+        for (j = 0; j < n; j++) {
+            mpECP_clear(rpts[j]);
+            mpECP_clear(pts[j]);
+        }
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+    free(status);
+    free(rpts);
+    free(pts);
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_cache_set_bytes)
+    int error, i, len;
+    mpECurve_t cv, cv2;
+    mpECP_t pts[5];
+    mpECP_t a, b;
+    unsigned char buf[5][64];
+    uint64_t hits, misses;
+    mpECP_cache_t cache, cache2;
+    mpECurve_init(cv);
+    mpECurve_init(cv2);
+
+    error = mpECurve_set_named(cv, "Ed25519");
+    assert(error == 0);
+    error = mpECurve_set_named(cv2, "secp256k1");
+    assert(error == 0);
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    len = mpECP_out_bytelen(a, 1);
+    for (i = 0; i < 5; i++) {
+        mpECP_init(pts[i], cv);
+        mpECP_urandom(pts[i], cv);
+        mpECP_out_bytes(buf[i], pts[i], 1);
+    }
+    mpECP_cache_init(cache, 4);
+
+    for (i = 0; i < 4; i++) {
+        error = mpECP_cache_set_bytes(a, cache, buf[i], len, cv);
+        assert(error == 0);
+        assert(mpECP_cmp(a, pts[i]) == 0);
+    }
+    // hit returns the same point, refreshes buf[0]
+    error = mpECP_cache_set_bytes(a, cache, buf[0], len, cv);
+    assert(error == 0);
+    assert(mpECP_cmp(a, pts[0]) == 0);
+    mpECP_cache_stats(cache, &hits, &misses);
+    assert((hits == 1) && (misses == 4));
+    // buf[4] evicts buf[1] (least recently used)
+    error = mpECP_cache_set_bytes(a, cache, buf[4], len, cv);
+    assert(error == 0);
+    error = mpECP_cache_set_bytes(a, cache, buf[0], len, cv);
+    assert(error == 0);
+    error = mpECP_cache_set_bytes(b, cache, buf[1], len, cv);
+    assert(error == 0);
+    assert(mpECP_cmp(b, pts[1]) == 0);
+    mpECP_cache_stats(cache, &hits, &misses);
+    assert((hits == 2) && (misses == 6));
+    assert(cache->count == 4);
+    // keys are bound to the curve, invalid encodings are not cached
+    mpECP_clear(b);
+    mpECP_init(b, cv2);
+    error = mpECP_cache_set_bytes(b, cache, buf[0], mpECP_out_bytelen(b, 1), cv2);
+    buf[2][0] = 5;
+    assert(mpECP_cache_set_bytes(a, cache, buf[2], len, cv) != 0);
+    assert(mpECP_cache_set_bytes(a, cache, buf[2], len, cv) != 0);
+    mpECP_cache_stats(cache, &hits, &misses);
+    assert((hits == 2) && (misses == 9));
+    mpECP_cache_clear(cache);
+
+    // each cache draws its own bucket hash key
+    mpECP_cache_init(cache, 4);
+    mpECP_cache_init(cache2, 4);
+    assert((cache->key[0] != cache2->key[0]) || (cache->key[1] != cache2->key[1]));
+    mpECP_cache_clear(cache2);
+    mpECP_cache_clear(cache);
+    for (i = 0; i < 5; i++) {
+        mpECP_clear(pts[i]);
+    }
+    mpECP_clear(b);
+    mpECP_clear(a);
+    mpECurve_clear(cv2);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_mul_precomp)
+    int error, i, j, w, ncurves;
+    char *test_curve[] = {"secp192r1", "secp256k1", "Ed25519", "Curve25519", "E-222"};
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpECP_precomp_t pc;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        printf("precomputed scalar multiply curve %s\n", test_curve[i]);
+        mpECP_urandom(a, cv);
+        for (w = 0; w <= 6; w += 2) {
+            mpECP_precomp_init(pc, a, w);
+            for (j = 0; j < 8; j++) {
+                mpFp_urandom(k, cv->n);
+                if (j == 0) mpFp_set_ui(k, 0, cv->n);
+                if (j == 1) mpFp_set_ui(k, 1, cv->n);
+                if (j == 2) mpFp_set_ui(k, 2, cv->n);
+                if (j == 3) {
+                    mpFp_set_ui(k, 1, cv->n);
+                    mpFp_neg(k, k);
+                }
+                mpECP_scalar_mul_ladder(b, a, k);
+                mpECP_scalar_mul_precomp(c, pc, k);
+                assert(mpECP_cmp(b, c) == 0);
+            }
+            mpECP_precomp_clear(pc);
+            if (w == 0) w = 1;
+        }
+        // neutral point
+        mpECP_set_neutral(b, cv);
+        mpECP_precomp_init(pc, b, 0);
+        mpECP_scalar_mul_precomp(c, pc, k);
+        assert(mpECP_cmp(b, c) == 0);
+        mpECP_precomp_clear(pc);
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_keypair_generate)
+    int error, i, j, ncurves;
+    char *test_curve[] = {"secp112r1", "secp256k1", "Ed25519", "Curve25519", "E-222"};
+    mpECurve_t cv;
+    mpECP_t g, b;
+    mpECP_t pub[8];
+    mpFp_t priv[8];
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(g, cv);
+        mpECP_init(b, cv);
+        mpECP_set_mpz(g, cv->G[0], cv->G[1], cv);
+        for (j = 0; j < 8; j++) {
+            mpECP_init(pub[j], cv);
+            mpFp_init(priv[j], cv->n);
+        }
+        mpECP_keypair_generate(priv[0], pub[0], cv);
+        assert(mpFp_cmp_ui(priv[0], 0) != 0);
+        mpECP_scalar_mul_ladder(b, g, priv[0]);
+        assert(mpECP_cmp(b, pub[0]) == 0);
+        mpECP_keypair_generate_batch(priv, pub, 8, cv);
+        for (j = 0; j < 8; j++) {
+            assert(mpFp_cmp_ui(priv[j], 0) != 0);
+            assert(mpFp_cmp_ui(pub[j]->z, 1) == 0);
+            mpECP_scalar_mul_ladder(b, g, priv[j]);
+            assert(mpECP_cmp(b, pub[j]) == 0);
+        }
+        assert(mpFp_cmp(priv[0], priv[1]) != 0);
+        for (j = 0; j < 8; j++) {
+            mpFp_clear(priv[j]);
+            mpECP_clear(pub[j]);
+        }
+        mpECP_clear(b);
+        mpECP_clear(g);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
 START_TEST(test_mpECP_scalar_base_mul)
     int error, i, npoints;
     mpECurve_t cv;
@@ -678,6 +1618,398 @@ START_TEST(test_mpECP_scalar_base_mul)
     mpECurve_clear(cv);
 END_TEST
 
+START_TEST(test_mpECP_scalar_base_mul_random)
+    int error, i, ncurves;
+    char *test_curve[] = {"secp112r2", "secp256k1", "P521", "Curve25519", "Ed448-Goldilocks", "Ed25519"};
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpECurve_init(cv);
+
+    ncurves = sizeof(test_curve) / sizeof(test_curve[0]);
+    for (i = 0 ; i < ncurves; i++) {
+        int j;
+        error = mpECurve_set_named(cv, test_curve[i]);
+        assert(error == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpFp_init(k, cv->n);
+        mpECP_urandom(a, cv);
+        mpECP_scalar_base_mul_setup(a);
+        assert(a->base_bits != 0);
+        printf("fixed base multiply curve %s (%zu table bytes)\n", test_curve[i],
+            a->base_tbl->bytes);
+        for (j = 0; j < 16; j++) {
+            mpFp_urandom(k, cv->n);
+            if (j == 0) mpFp_set_ui(k, 0, cv->n);
+            if (j == 1) mpFp_set_ui(k, 1, cv->n);
+            if (j == 2) mpFp_set_ui(k, 2, cv->n);
+            if (j == 3) {
+                mpFp_set_ui(k, 1, cv->n);
+                mpFp_neg(k, k);
+            }
+            mpECP_scalar_mul_ladder(b, a, k);
+            mpECP_scalar_base_mul(c, a, k);
+            assert(mpECP_cmp(b, c) == 0);
+        }
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_base_mul_setup_ex)
+    int error, w;
+    size_t sz, last;
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    mpECurve_init(cv);
+
+    error = mpECurve_set_named(cv, "P256");
+    assert(error == 0);
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    mpECP_init(c, cv);
+    mpFp_init(k, cv->n);
+    mpECP_urandom(a, cv);
+    mpFp_urandom(k, cv->n);
+    mpECP_scalar_mul(b, a, k);
+    assert(mpECP_scalar_base_mul_table_bytes(a) == 0);
+    last = 0;
+    for (w = 2; w <= 8; w++) {
+        error = mpECP_scalar_base_mul_setup_ex(a, w, 0);
+        assert(error == 0);
+        assert(a->base_bits == w);
+        sz = mpECP_scalar_base_mul_table_bytes(a);
+        printf("P256 window %d table bytes = %zu\n", w, sz);
+        assert(sz == mpECP_scalar_base_mul_table_size(cv, w));
+        assert(sz > last);
+        last = sz;
+        mpECP_scalar_base_mul(c, a, k);
+        assert(mpECP_cmp(b, c) == 0);
+    }
+    // memory limit selects a smaller window
+    sz = mpECP_scalar_base_mul_table_size(cv, 5);
+    error = mpECP_scalar_base_mul_setup_ex(a, 8, sz);
+    assert(error == 0);
+    assert(a->base_bits == 5);
+    assert(mpECP_scalar_base_mul_table_bytes(a) <= sz);
+    mpECP_scalar_base_mul(c, a, k);
+    assert(mpECP_cmp(b, c) == 0);
+    // too small for any table, existing table is retained
+    error = mpECP_scalar_base_mul_setup_ex(a, 8, 64);
+    assert(error != 0);
+    assert(a->base_bits == 5);
+    error = mpECP_scalar_base_mul_setup_ex(a, 1, 0);
+    assert(error != 0);
+
+    mpFp_clear(k);
+    mpECP_clear(c);
+    mpECP_clear(b);
+    mpECP_clear(a);
+    mpECurve_clear(cv);
+END_TEST
+
+typedef struct {
+    mpECurve_ptr cvp;
+    mpz_t k;
+    mpECP_t r;
+    _mpECP_base_table_t *tbl;
+} _test_shared_base_t;
+
+static void *_test_shared_base_thread(void *arg) {
+    _test_shared_base_t *t = (_test_shared_base_t *)arg;
+    mpECP_t g;
+    mpECP_init(g, t->cvp);
+    mpECP_set_mpz(g, t->cvp->G[0], t->cvp->G[1], t->cvp);
+    mpECP_scalar_base_mul_mpz(t->r, g, t->k);
+    t->tbl = g->base_tbl;
+    mpECP_clear(g);
+    return NULL;
+}
+
+START_TEST(test_mpECP_scalar_base_mul_shared)
+    int error, i;
+    mpECurve_t cv, cv2;
+    mpECP_t a, b, c;
+    mpz_t k;
+    pthread_t th[4];
+    _test_shared_base_t targ[4];
+    mpECurve_init(cv);
+    mpECurve_init(cv2);
+    mpz_init(k);
+
+    error = mpECurve_set_named(cv, "secp256k1");
+    assert(error == 0);
+    assert(cv->canon->base_tbl == NULL);
+    // concurrent first use builds a single table
+    for (i = 0; i < 4; i++) {
+        targ[i].cvp = cv;
+        mpz_init(targ[i].k);
+        mpz_set_ui(targ[i].k, 1000 + i);
+        mpECP_init(targ[i].r, cv);
+        error = pthread_create(&th[i], NULL, _test_shared_base_thread, &targ[i]);
+        assert(error == 0);
+    }
+    for (i = 0; i < 4; i++) {
+        pthread_join(th[i], NULL);
+    }
+    assert(cv->canon->base_tbl != NULL);
+    assert((cv->canon->base_tbl->is_static != 0) || (cv->canon->base_tbl->refcount == 1));
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    mpECP_init(c, cv);
+    mpECP_set_mpz(a, cv->G[0], cv->G[1], cv);
+    for (i = 0; i < 4; i++) {
+        assert(targ[i].tbl == cv->canon->base_tbl);
+        mpECP_scalar_mul_mpz(b, a, targ[i].k);
+        assert(mpECP_cmp(b, targ[i].r) == 0);
+        mpECP_clear(targ[i].r);
+        mpz_clear(targ[i].k);
+    }
+    // generator points (even in projective form) share the curve table
+    mpECP_add(b, a, a);
+    mpECP_sub(b, b, a);
+    mpECP_scalar_base_mul_setup(a);
+    mpECP_scalar_base_mul_setup(b);
+    assert(a->base_tbl == cv->canon->base_tbl);
+    assert(b->base_tbl == cv->canon->base_tbl);
+    assert((cv->canon->base_tbl->is_static != 0) || (cv->canon->base_tbl->refcount == 3));
+    // other points get their own table
+    mpECP_double(c, a);
+    mpECP_scalar_base_mul_setup(c);
+    assert(c->base_tbl != cv->canon->base_tbl);
+    // the table is shared through the canonical curve, so a copy or a
+    // curve set by name again use it too, table outlives the curves
+    mpECurve_set(cv2, cv);
+    assert(cv2->canon->base_tbl == cv->canon->base_tbl);
+    error = mpECurve_set_named(cv2, "secp256k1");
+    assert(error == 0);
+    assert(cv2->canon == cv->canon);
+    mpECP_clear(c);
+    mpECP_init(c, cv2);
+    mpECP_set_mpz(c, cv2->G[0], cv2->G[1], cv2);
+    mpECP_scalar_base_mul_setup(c);
+    assert(c->base_tbl == cv->canon->base_tbl);
+    mpECurve_clear(cv2);
+    mpz_set_ui(k, 12345);
+    mpECP_scalar_base_mul_mpz(c, b, k);
+    mpECP_scalar_mul_mpz(b, a, k);
+    assert(mpECP_cmp(b, c) == 0);
+
+    mpz_clear(k);
+    mpECP_clear(c);
+    mpECP_clear(b);
+    mpECP_clear(a);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_base_mul_static)
+    int error, i;
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    char *names[] = {"secp256k1", "P256", "Ed25519", "Curve25519", NULL};
+    mpECurve_init(cv);
+
+    // named curves may use tables precomputed at build time, results must
+    // match either way and static tables are never released
+    for (i = 0; names[i] != NULL; i++) {
+        error = mpECurve_set_named(cv, names[i]);
+        assert(error == 0);
+        assert(strcmp(cv->name, names[i]) == 0);
+        mpECP_init(a, cv);
+        mpECP_init(b, cv);
+        mpECP_init(c, cv);
+        mpECP_set_mpz(a, cv->G[0], cv->G[1], cv);
+        mpECP_scalar_base_mul_setup(a);
+        assert(a->base_tbl == cv->canon->base_tbl);
+        mpFp_init(k, cv->n);
+        mpFp_urandom(k, cv->n);
+        mpECP_scalar_base_mul(b, a, k);
+        mpECP_scalar_mul(c, a, k);
+        assert(mpECP_cmp(b, c) == 0);
+        mpFp_clear(k);
+        mpECP_clear(c);
+        mpECP_clear(b);
+        mpECP_clear(a);
+    }
+
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_scalar_base_mul_table_file)
+    int error, fd;
+    mpECurve_t cv;
+    mpECP_t a, b, c, d;
+    mpz_t k;
+    FILE *f;
+    char path[] = "/tmp/test_ecpoint_tblXXXXXX";
+    mpECurve_init(cv);
+    mpz_init(k);
+
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    error = mpECurve_set_named(cv, "Ed25519");
+    assert(error == 0);
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    mpECP_init(c, cv);
+    mpECP_init(d, cv);
+    mpECP_urandom(a, cv);
+    mpECP_set(b, a);
+    // no table, nothing to save
+    assert(mpECP_scalar_base_mul_table_save(a, path) != 0);
+    error = mpECP_scalar_base_mul_setup_ex(a, 5, 0);
+    assert(error == 0);
+    error = mpECP_scalar_base_mul_table_save(a, path);
+    assert(error == 0);
+
+    // mapped table gives the same results as the heap table
+    error = mpECP_scalar_base_mul_table_load(b, path);
+    assert(error == 0);
+    assert(b->base_bits == 5);
+    assert(mpECP_scalar_base_mul_table_bytes(b) == mpECP_scalar_base_mul_table_bytes(a));
+    mpz_urandom(k, cv->n);
+    mpECP_scalar_base_mul_mpz(c, a, k);
+    mpECP_scalar_base_mul_mpz(d, b, k);
+    assert(mpECP_cmp(c, d) == 0);
+    mpECP_clear(b);
+
+    // tables are bound to the point
+    mpECP_double(c, a);
+    assert(mpECP_scalar_base_mul_table_load(c, path) != 0);
+    assert(c->base_bits == 0);
+
+    // corrupt arena fails the checksum
+    f = fopen(path, "r+b");
+    assert(f != NULL);
+    fseek(f, 100, SEEK_SET);
+    fputc(fgetc(f) ^ 0x01, f);
+    fclose(f);
+    mpECP_init(b, cv);
+    mpECP_set(b, a);
+    assert(mpECP_scalar_base_mul_table_load(b, path) != 0);
+    assert(mpECP_scalar_base_mul_table_load(b, "/nonexistent/table") != 0);
+    assert(b->base_bits == 0);
+
+    unlink(path);
+    mpECP_clear(d);
+    mpECP_clear(c);
+    mpECP_clear(b);
+    mpECP_clear(a);
+    mpz_clear(k);
+    mpECurve_clear(cv);
+END_TEST
+
+START_TEST(test_mpECP_tune)
+    int error, fd, dflt_p256, dflt_k1;
+    mpECurve_t cv;
+    mpECP_t a, b, c;
+    mpFp_t k;
+    FILE *f;
+    char path[] = "/tmp/test_ecpoint_tuneXXXXXX";
+    char backend[16];
+
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    strncpy(backend, mpFp_backend_name(), sizeof(backend) - 1);
+    backend[sizeof(backend) - 1] = 0;
+
+    // built in defaults, without any tuning entries
+    mpECP_tune_reset();
+    mpECurve_init(cv);
+    assert(mpECurve_set_named(cv, "P256") == 0);
+    dflt_p256 = mpECP_scalar_mul_window_bits(cv);
+    assert(mpECurve_set_named(cv, "secp256k1") == 0);
+    dflt_k1 = mpECP_scalar_mul_window_bits(cv);
+
+    f = fopen(path, "w");
+    assert(f != NULL);
+    fprintf(f, "# test tuning\n");
+    fprintf(f, "backend=gmp\n");
+    fprintf(f, "secp256k1 window=3 base=4 secret=rcb public=jacobian\n");
+    // rcb-a0 does not apply to P256 (a = -3), so the default is kept
+    fprintf(f, "P256 window=1 secret=rcb-a0 # co-Z ladder\n");
+    fprintf(f, "Ed25519 window=2 base=3 unknown=1\n");
+    fclose(f);
+    error = mpECP_tune_load(path);
+    assert(error == 0);
+    // the backend line only applies when the library is loaded
+    assert(strcmp(mpFp_backend_name(), backend) == 0);
+
+    assert(mpECurve_set_named(cv, "secp256k1") == 0);
+    assert(cv->window_bits == 3);
+    assert(cv->base_bits == 4);
+    assert(mpECP_scalar_mul_window_bits(cv) == 3);
+    assert(strcmp(mpECP_formulas_name(cv, MPECP_FORMULAS_SECRET), "rcb") == 0);
+    assert(strcmp(mpECP_formulas_name(cv, MPECP_FORMULAS_PUBLIC), "jacobian") == 0);
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    mpECP_init(c, cv);
+    mpFp_init(k, cv->n);
+    mpECP_set_mpz(a, cv->G[0], cv->G[1], cv);
+    mpFp_urandom(k, cv->n);
+    mpECP_scalar_mul_ladder(b, a, k);
+    mpECP_scalar_mul(c, a, k);
+    assert(mpECP_cmp(b, c) == 0);
+    // the shared generator table uses the tuned window
+    mpECP_scalar_base_mul_setup(a);
+    assert(a->base_bits == 4);
+    mpECP_scalar_base_mul(c, a, k);
+    assert(mpECP_cmp(b, c) == 0);
+    mpFp_clear(k);
+    mpECP_clear(c);
+    mpECP_clear(b);
+    mpECP_clear(a);
+
+    assert(mpECurve_set_named(cv, "P256") == 0);
+    assert(mpECP_scalar_mul_window_bits(cv) == 1);
+    assert(strcmp(mpECP_formulas_name(cv, MPECP_FORMULAS_SECRET), "rcb-a3") == 0);
+    mpECP_init(a, cv);
+    mpECP_init(b, cv);
+    mpECP_init(c, cv);
+    mpFp_init(k, cv->n);
+    mpECP_urandom(a, cv);
+    mpFp_urandom(k, cv->n);
+    mpECP_scalar_mul_ladder(b, a, k);
+    mpECP_scalar_mul(c, a, k);
+    assert(mpECP_cmp(b, c) == 0);
+    mpFp_clear(k);
+    mpECP_clear(c);
+    mpECP_clear(b);
+    mpECP_clear(a);
+
+    // malformed files (and missing files) leave no entries
+    f = fopen(path, "w");
+    assert(f != NULL);
+    fprintf(f, "P256 window=x\n");
+    fclose(f);
+    assert(mpECP_tune_load(path) != 0);
+    assert(mpECurve_set_named(cv, "P256") == 0);
+    assert(mpECP_scalar_mul_window_bits(cv) == dflt_p256);
+    assert(mpECP_tune_load("/nonexistent/ecc-tune.conf") != 0);
+    f = fopen(path, "w");
+    assert(f != NULL);
+    fprintf(f, "secp256k1 window=3\nP256 base=1\n");
+    fclose(f);
+    assert(mpECP_tune_load(path) != 0);
+    assert(mpECurve_set_named(cv, "secp256k1") == 0);
+    assert(mpECP_scalar_mul_window_bits(cv) == dflt_k1);
+    assert(cv->base_bits == 0);
+
+    unlink(path);
+    mpECurve_clear(cv);
+END_TEST
+
 static Suite *mpECP_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -694,8 +2026,29 @@ static Suite *mpECP_test_suite(void) {
     tcase_add_test(tc, test_mpECP_double);
     tcase_add_test(tc, test_mpECP_add_mul);
     tcase_add_test(tc, test_mpECP_scalar_mul);
+    tcase_add_test(tc, test_mpECP_scalar_mul_window);
+    tcase_add_test(tc, test_mpECP_scalar_mul_vartime);
+    tcase_add_test(tc, test_mpECP_scalar_mul_glv);
     tcase_add_test(tc, test_mpECP_urandom);
+    tcase_add_test(tc, test_mpECP_multi_scalar_mul);
+    tcase_add_test(tc, test_mpECP_multi_scalar_mul_pippenger);
+    tcase_add_test(tc, test_mpECP_curve_ops);
+    tcase_add_test(tc, test_mpECP_scalar_mul_coz);
+    tcase_add_test(tc, test_mpECP_scalar_mul_x);
+    tcase_add_test(tc, test_mpECP_formulas);
+    tcase_add_test(tc, test_mpECP_tune);
+    tcase_add_test(tc, test_mpECP_batch_out_bytes);
+    tcase_add_test(tc, test_mpECP_batch_set_bytes);
+    tcase_add_test(tc, test_mpECP_cache_set_bytes);
+    tcase_add_test(tc, test_mpECP_scalar_mul_precomp);
+    tcase_add_test(tc, test_mpECP_keypair_generate);
     tcase_add_test(tc, test_mpECP_scalar_base_mul);
+    tcase_add_test(tc, test_mpECP_scalar_base_mul_random);
+    tcase_add_test(tc, test_mpECP_scalar_base_mul_setup_ex);
+    tcase_add_test(tc, test_mpECP_scalar_base_mul_shared);
+    tcase_add_test(tc, test_mpECP_scalar_base_mul_static);
+    tcase_add_test(tc, test_mpECP_scalar_base_mul_table_file);
+    tcase_set_timeout(tc, 0.0);
     suite_add_tcase(s, tc);
     return s;
 }
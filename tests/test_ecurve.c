@@ -202,6 +202,63 @@ START_TEST(test_mpECurve_all_named)
     mpECurve_clear(a);
 END_TEST
 
+START_TEST(test_mpECurve_intern)
+    int error, refs;
+    mpECurve_t a, b, c;
+    mpECurve_ptr ca, cb;
+    mpECurve_init(a);
+    mpECurve_init(b);
+    mpECurve_init(c);
+
+    // equal curves share the canonical copy
+    error = mpECurve_set_named(a,"secp256k1");
+    assert(error == 0);
+    error = mpECurve_set_named(b,"secp256k1");
+    assert(error == 0);
+    assert(a->canon != NULL);
+    assert(a->canon == b->canon);
+    assert(a->canon->interned != 0);
+    refs = a->canon->refcount;
+    assert(refs >= 2);
+    assert(mpECurve_cmp(a, b) == 0);
+
+    ca = mpECurve_intern(a);
+    assert(ca == a->canon);
+    assert(ca->canon == ca);
+    assert(ca->refcount == refs + 1);
+    assert(mpECurve_cmp(ca, b) == 0);
+    assert(mpz_cmp(ca->n, a->n) == 0);
+
+    mpECurve_set(c, a);
+    assert(c->canon == ca);
+    assert(ca->refcount == refs + 2);
+
+    // different curves do not
+    error = mpECurve_set_named(b,"secp256r1");
+    assert(error == 0);
+    assert(b->canon != ca);
+    assert(ca->refcount == refs + 1);
+    assert(mpECurve_cmp(a, b) != 0);
+    assert(mpECurve_cmp(ca, b) != 0);
+
+    cb = mpECurve_intern(b);
+    assert(cb == b->canon);
+    mpECurve_release(cb);
+
+    // the canonical copy outlives the curves it was interned from
+    mpECurve_clear(a);
+    mpECurve_clear(c);
+    assert(ca->refcount == refs - 1);
+    mpECurve_init(a);
+    error = mpECurve_set_named(a,"secp256k1");
+    assert(error == 0);
+    assert(a->canon == ca);
+    mpECurve_release(ca);
+
+    mpECurve_clear(b);
+    mpECurve_clear(a);
+END_TEST
+
 static Suite *mpECurve_test_suite(void) {
     Suite *s;
     TCase *tc;
@@ -213,6 +270,7 @@ static Suite *mpECurve_test_suite(void) {
     tcase_add_test(tc, test_mpECurve_cmp);
     tcase_add_test(tc, test_mpECurve_named);
     tcase_add_test(tc, test_mpECurve_all_named);
+    tcase_add_test(tc, test_mpECurve_intern);
     suite_add_tcase(s, tc);
     return s;
 }
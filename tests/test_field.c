@@ -37,6 +37,7 @@
 #include <check.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 typedef struct {
@@ -855,6 +856,69 @@ START_TEST(test_mpFp_mul_extended)
     mpz_clear(aa);
 END_TEST
 
+START_TEST(test_mpFp_backend)
+    int i, j, k, nfields;
+    char *backends[] = {"gmp", "adx"};
+    const char *saved;
+    mpFp_t a, b, c;
+    mpz_t aa, bb, d, p;
+
+    mpz_init(aa);
+    mpz_init(bb);
+    mpz_init(d);
+    mpz_init(p);
+    saved = mpFp_backend_name();
+    printf("default field backend %s\n", saved);
+    assert(mpFp_backend_set("no-such-backend") != 0);
+    assert(strcmp(mpFp_backend_name(), saved) == 0);
+
+    nfields = sizeof(test_prime_fields)/sizeof(test_prime_fields[0]);
+    for (k = 0; k < sizeof(backends)/sizeof(backends[0]); k++) {
+        if (mpFp_backend_set(backends[k]) != 0) {
+            printf("field backend %s not supported, skipped\n", backends[k]);
+            continue;
+        }
+        assert(strcmp(mpFp_backend_name(), backends[k]) == 0);
+        for (j = 0 ; j < nfields; j++) {
+            mpz_set_str(p, test_prime_fields[j], 0);
+            mpFp_init(a, p);
+            mpFp_init(b, p);
+            mpFp_init(c, p);
+            for (i = 0; i < 1000; i++) {
+                mpFp_urandom(a, p);
+                mpFp_urandom(b, p);
+                // include p - 1 (all limbs set for most fields)
+                if (i == 0) mpFp_set_ui(a, 0, p);
+                if (i < 2) mpFp_sub_ui(b, a, 1);
+                mpz_set_mpFp(aa, a);
+                mpz_set_mpFp(bb, b);
+                mpFp_mul(c, a, b);
+                mpz_mul(d, aa, bb);
+                mpz_mod(d, d, p);
+                assert(mpFp_cmp_mpz(c, d) == 0);
+                mpFp_sqr(c, b);
+                mpz_mul(d, bb, bb);
+                mpz_mod(d, d, p);
+                assert(mpFp_cmp_mpz(c, d) == 0);
+                // in place
+                mpFp_mul(a, a, a);
+                mpz_mul(d, aa, aa);
+                mpz_mod(d, d, p);
+                assert(mpFp_cmp_mpz(a, d) == 0);
+            }
+            mpFp_clear(c);
+            mpFp_clear(b);
+            mpFp_clear(a);
+        }
+    }
+    assert(mpFp_backend_set(saved) == 0);
+
+    mpz_clear(p);
+    mpz_clear(d);
+    mpz_clear(bb);
+    mpz_clear(aa);
+END_TEST
+
 START_TEST(test_mpFp_pow_basic)
     mpFp_t a, b, c;
     mpz_t p, d, e;
@@ -1318,6 +1382,33 @@ START_TEST(test_mpFp_swap_cswap)
     mpFp_clear(a);
 END_TEST
 
+START_TEST(test_mpFp_cmov)
+    mpFp_t a, b, c;
+    mpz_t p;
+    mpz_init(p);
+
+    mpz_set_str(p, "0xFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEFFFFFC2F", 0);
+
+    mpFp_init(a, p);
+    mpFp_init(b, p);
+    mpFp_init(c, p);
+
+    mpFp_urandom(a, p);
+    mpFp_urandom(b, p);
+    mpFp_set(c, a);
+    mpFp_cmov(c, b, 0);
+    assert(mpFp_cmp(c, a) == 0);
+    mpFp_cmov(c, b, 1);
+    assert(mpFp_cmp(c, b) == 0);
+    mpFp_cmov(c, a, 7);
+    assert(mpFp_cmp(c, a) == 0);
+
+    mpz_clear(p);
+    mpFp_clear(c);
+    mpFp_clear(b);
+    mpFp_clear(a);
+END_TEST
+
 START_TEST(test_mpFp_cswap_extended)
     int i, j, ii;
     int nfields;
@@ -1745,8 +1836,10 @@ static Suite *mpFp_test_suite(void) {
     tcase_add_test(tc, test_mpFp_sub_extended);
     tcase_add_test(tc, test_mpFp_swap_cswap);
     tcase_add_test(tc, test_mpFp_cswap_extended);
+    tcase_add_test(tc, test_mpFp_cmov);
     tcase_add_test(tc, test_mpFp_mul_basic);
     tcase_add_test(tc, test_mpFp_mul_extended);
+    tcase_add_test(tc, test_mpFp_backend);
     tcase_add_test(tc, test_mpFp_pow_basic);
     tcase_add_test(tc, test_mpFp_pow_extended);
     tcase_add_test(tc, test_mpFp_sqr_extended);